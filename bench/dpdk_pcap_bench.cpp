@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rte_cycles.h>
+#include <rte_eal.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_net.h>
+#include <rte_pause.h>
+#include <rte_ring.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk/dpdk_flow_cache.h"
+#include "dpdk/dpdk_flow_distributor.h"
+#include "dpdk/dpdk_frag_table.h"
+#include "dpdk/dpdk_flow_key.h"
+#include "dpdk/dpdk_packet_filter.h"
+#include "dpdk/dpdk_packet_parser.h"
+#include "dpdk/dpdk_pcap_reader.h"
+#include "dpdk/dpdk_rate_limiter.h"
+
+// Offline replay of a pcap capture through the same parse_burst / classify_burst
+// code the workers run. Starts a minimal in-memory EAL (the rte_acl stage allocates
+// from the DPDK heap) but needs no hugepages, NIC or root.
+//
+//   dpdk-fastdrop-bench <capture.pcap> [block_list.json] [iterations] [rtc|pipeline] [classifier lcores]
+//
+// "rtc" classifies on the main lcore, like run_loop_worker. "pipeline" mirrors the agent's
+// pipeline topology with flow distribution: the main lcore hashes each burst onto one ring per
+// classifier through dpdk_flow_distributor (RX stage), fragments on L3 only so every fragment
+// of a datagram meets the same frag table, classifier lcores verdict them and forward allowed
+// packets into an MP/SC ring, and the main lcore drains that ring (TX stage). Latency is per packet, from injection to leaving the classifier
+// (rtc) or to being dequeued by the TX stage (pipeline).
+// rtc mode also times parse_burst alone, once from packet bytes and once from NIC-style
+// packet_type metadata, which rte_net_get_ptype fills in for the captured frames.
+
+namespace {
+    constexpr uint16_t burst_size = 32;
+    constexpr size_t max_latency_samples = 1 << 22;
+
+    typedef struct VerdictCounts {
+        uint64_t allowed_by_rule;
+        uint64_t allowed_default;
+        uint64_t blocked;
+        uint64_t rate_limited;
+        uint64_t parse_failed;
+    } VerdictCounts_t;
+
+    // Per-lcore classification state, the bench's stand-in for dpdk_worker_context
+    typedef struct Classifier {
+        const dpdk_packet_filter* filter = nullptr;
+        dpdk_packet_parser parser;
+        dpdk_flow_cache flow_cache;
+        dpdk_frag_table frag_table;
+        dpdk_rate_limiter rate_limiter;
+        FlowKeyBurst_t keys{};
+        TunnelKeyBurst_t tunnels{};
+        uint32_t results[FLOW_KEY_BURST_MAX]{};
+        VerdictCounts_t verdicts{};
+
+        // Pipeline mode only
+        rte_ring* rx_ring = nullptr;        // this classifier's own ring, filled by the distributor
+        rte_ring* tx_ring = nullptr;
+        const std::atomic<bool>* running = nullptr;
+        std::atomic<uint64_t> processed{0};
+    } Classifier_t;
+
+    bool initialize_eal(unsigned lcores) {
+        const std::string lcore_list = lcores > 1 ? "0-" + std::to_string(lcores - 1) : "0";
+        const char* eal_args[] = {
+            "dpdk-fastdrop-bench",
+            "-l", lcore_list.c_str(),
+            "--no-huge",
+            "--no-pci",
+            "--in-memory",
+            "--log-level=4"
+        };
+        constexpr int eal_argc = std::size(eal_args);
+        return rte_eal_init(eal_argc, const_cast<char**>(eal_args)) >= 0;
+    }
+
+    // Calibrate against the wall clock rather than trusting rte_get_tsc_hz() on a no-huge EAL
+    uint64_t calibrate_tsc_hz() {
+        const auto wall_start = std::chrono::steady_clock::now();
+        const uint64_t tsc_start = rte_rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const uint64_t tsc_end = rte_rdtsc();
+        const auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - wall_start).count();
+        return static_cast<uint64_t>((tsc_end - tsc_start) * 1e9 / wall_ns);
+    }
+
+    bool init_classifier(Classifier_t& classifier, const dpdk_packet_filter& filter, unsigned index) {
+        classifier.filter = &filter;
+        // Never ages out during a run: a replayed capture is one long burst of known flows
+        return classifier.rate_limiter.init(16384, SOCKET_ID_ANY) &&
+               classifier.flow_cache.init("bench_flow_cache_" + std::to_string(index), 65536, UINT64_MAX, SOCKET_ID_ANY) &&
+               classifier.frag_table.init("bench_frag_table_" + std::to_string(index), 4096,
+                                          rte_get_tsc_hz() * 3600, SOCKET_ID_ANY);
+    }
+
+    // Same steps as run_loop_worker; returns the results in classifier.results
+    void classify(Classifier_t& classifier, rte_mbuf** pkts, uint16_t count) {
+        FlowKeyBurst_t& keys = classifier.keys;
+        uint32_t* results = classifier.results;
+
+        classifier.parser.parse_burst(pkts, count, keys, &classifier.tunnels);
+        const dpdk_rule_set* rule_set = classifier.filter->active_rule_set();
+        if (rule_set) {
+            const uint64_t now = rte_rdtsc();
+            classifier.flow_cache.classify_burst(*rule_set, keys, results, now);
+            rule_set->lookup_tunnels(classifier.tunnels, results);
+            classifier.frag_table.apply_burst(keys, results, now);
+            classifier.rate_limiter.police_burst(*rule_set, pkts, keys, results, now);
+        } else {
+            std::fill(results, results + count, dpdk_rule_classifier::NO_MATCH);
+        }
+
+        VerdictCounts_t& verdicts = classifier.verdicts;
+        for (uint16_t i = 0; i < count; i++) {
+            if (keys.status[i] != ParseStatus::OK) {
+                verdicts.parse_failed++;
+            } else if (results[i] != dpdk_rule_classifier::NO_MATCH &&
+                       dpdk_rule_classifier::action(results[i]) == RuleAction::RATE_EXCEEDED) {
+                verdicts.rate_limited++;
+            } else if (!dpdk_packet_filter::is_allowed(results[i])) {
+                verdicts.blocked++;
+            } else if (results[i] == dpdk_rule_classifier::NO_MATCH) {
+                verdicts.allowed_default++;
+            } else {
+                verdicts.allowed_by_rule++;
+            }
+        }
+    }
+
+    inline bool is_forwarded(const Classifier_t& classifier, uint16_t i) {
+        return classifier.keys.status[i] == ParseStatus::OK && dpdk_packet_filter::is_allowed(classifier.results[i]);
+    }
+
+    void replay_rtc(dpdk_pcap_reader& reader, Classifier_t& classifier, std::vector<uint64_t>* latencies) {
+        rte_mbuf** packets = reader.packets();
+        const size_t total = reader.count();
+
+        for (size_t offset = 0; offset < total; offset += burst_size) {
+            const auto count = static_cast<uint16_t>(std::min<size_t>(burst_size, total - offset));
+            const uint64_t start = rte_rdtsc();
+            classify(classifier, packets + offset, count);
+
+            // Every packet of a burst is done when the burst is
+            if (latencies && latencies->size() + count <= max_latency_samples) {
+                latencies->insert(latencies->end(), count, rte_rdtsc() - start);
+            }
+        }
+    }
+
+    int run_classifier_lcore(void* arg) {
+        auto* classifier = static_cast<Classifier_t*>(arg);
+        rte_mbuf* bufs[burst_size];
+        rte_mbuf* forward[burst_size];
+
+        while (classifier->running->load(std::memory_order_relaxed)) {
+            const unsigned count = rte_ring_sc_dequeue_burst(classifier->rx_ring, reinterpret_cast<void**>(bufs),
+                                                             burst_size, nullptr);
+            if (count == 0) {
+                rte_pause();
+                continue;
+            }
+
+            classify(*classifier, bufs, static_cast<uint16_t>(count));
+
+            unsigned forwarded = 0;
+            for (unsigned i = 0; i < count; i++) {
+                if (is_forwarded(*classifier, static_cast<uint16_t>(i))) {
+                    forward[forwarded++] = bufs[i];
+                }
+            }
+            // The capture's mbufs are reused every iteration, so nothing may be dropped here
+            for (unsigned sent = 0; sent < forwarded;) {
+                sent += rte_ring_mp_enqueue_burst(classifier->tx_ring, reinterpret_cast<void* const*>(forward + sent),
+                                                  forwarded - sent, nullptr);
+            }
+            classifier->processed.fetch_add(count, std::memory_order_release);
+        }
+        return 0;
+    }
+
+    // Drains the TX ring and records injection-to-TX latency; returns the number of packets drained
+    size_t drain_tx(rte_ring* tx_ring, rte_mbuf* const* first, const std::vector<uint64_t>& inject_tsc,
+                    std::vector<uint64_t>* latencies) {
+        rte_mbuf* bufs[burst_size];
+        const unsigned count = rte_ring_sc_dequeue_burst(tx_ring, reinterpret_cast<void**>(bufs), burst_size, nullptr);
+        if (count > 0 && latencies && latencies->size() + count <= max_latency_samples) {
+            const uint64_t now = rte_rdtsc();
+            for (unsigned i = 0; i < count; i++) {
+                latencies->push_back(now - inject_tsc[bufs[i] - *first]);
+            }
+        }
+        return count;
+    }
+
+    void replay_pipeline(dpdk_pcap_reader& reader, std::vector<std::unique_ptr<Classifier_t>>& classifiers,
+                         dpdk_flow_distributor& distributor, rte_ring* tx_ring, std::vector<uint64_t>& inject_tsc,
+                         std::vector<uint64_t>* latencies) {
+        rte_mbuf** packets = reader.packets();
+        const size_t total = reader.count();
+
+        uint64_t target = 0;
+        for (const auto& classifier : classifiers) {
+            target += classifier->processed.load(std::memory_order_acquire);
+        }
+        target += total;
+
+        for (size_t offset = 0; offset < total; offset += burst_size) {
+            const auto count = static_cast<uint16_t>(std::min<size_t>(burst_size, total - offset));
+            const uint64_t now = rte_rdtsc();
+            for (uint16_t i = 0; i < count; i++) {
+                inject_tsc[offset + i] = now;
+            }
+            distributor.distribute(packets + offset, count);
+            drain_tx(tx_ring, packets, inject_tsc, latencies);
+        }
+
+        // A packet is in flight at most once, so wait for this iteration before reusing the mbufs
+        for (;;) {
+            uint64_t processed = 0;
+            for (const auto& classifier : classifiers) {
+                processed += classifier->processed.load(std::memory_order_acquire);
+            }
+            if (drain_tx(tx_ring, packets, inject_tsc, latencies) == 0 && processed >= target) {
+                break;
+            }
+        }
+    }
+
+    void report(const dpdk_pcap_reader& reader, int iterations, uint64_t tsc_hz, uint64_t cycles, double wall_ns,
+                const VerdictCounts_t& verdicts, std::vector<uint64_t>& latencies) {
+        const double packets = static_cast<double>(reader.count()) * iterations;
+        spdlog::info("Throughput   : {:.2f} Mpps ({:.2f} Gbps of captured bytes)",
+                     packets / wall_ns * 1e3, reader.total_bytes() * 8.0 * iterations / wall_ns);
+        spdlog::info("Per packet   : {:.1f} ns, {:.1f} cycles (TSC {:.2f} GHz)",
+                     wall_ns / packets, cycles / packets, tsc_hz / 1e9);
+        spdlog::info("Verdicts     : allowed by rule {}, allowed (no match) {}, blocked {}, rate limited {}, parse failed {}",
+                     verdicts.allowed_by_rule / iterations, verdicts.allowed_default / iterations,
+                     verdicts.blocked / iterations, verdicts.rate_limited / iterations, verdicts.parse_failed / iterations);
+
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile_us = [&](double p) {
+                const auto index = static_cast<size_t>(p * (latencies.size() - 1));
+                return latencies[index] * 1e6 / tsc_hz;
+            };
+            spdlog::info("Latency      : p50 {:.2f} us, p99 {:.2f} us, max {:.2f} us ({} samples)",
+                         percentile_us(0.50), percentile_us(0.99), percentile_us(1.0), latencies.size());
+        }
+    }
+
+    // Parse stage alone, both ways: the byte walk and the packet_type fast path
+    void report_parse_cost(dpdk_pcap_reader& reader, int iterations) {
+        rte_mbuf** packets = reader.packets();
+        const size_t total = reader.count();
+        for (size_t i = 0; i < total; i++) {
+            packets[i]->packet_type = rte_net_get_ptype(packets[i], nullptr, RTE_PTYPE_ALL_MASK);
+        }
+
+        dpdk_packet_parser parsers[2];
+        parsers[1].set_rx_metadata(true, false);
+        FlowKeyBurst_t keys{};
+        uint64_t cycles[2] = {0, 0};
+        uint64_t from_ptype = 0;
+        for (int way = 0; way < 2; way++) {
+            const uint64_t tsc_start = rte_rdtsc();
+            for (int iter = 0; iter < iterations; iter++) {
+                for (size_t offset = 0; offset < total; offset += burst_size) {
+                    const auto count = static_cast<uint16_t>(std::min<size_t>(burst_size, total - offset));
+                    const uint16_t parsed = parsers[way].parse_burst(&packets[offset], count, keys);
+                    if (iter == 0) {
+                        from_ptype += parsed;
+                    }
+                }
+            }
+            cycles[way] = rte_rdtsc() - tsc_start;
+        }
+
+        for (size_t i = 0; i < total; i++) {
+            packets[i]->packet_type = 0;
+        }
+
+        const double packets_parsed = static_cast<double>(total) * iterations;
+        spdlog::info("Parse only   : {:.1f} cycles/packet from packet bytes, {:.1f} with packet_type ({:.1f}% of packets)",
+                     cycles[0] / packets_parsed, cycles[1] / packets_parsed, 100.0 * from_ptype / total);
+    }
+
+    void add_verdicts(VerdictCounts_t& total, const VerdictCounts_t& counts) {
+        total.allowed_by_rule += counts.allowed_by_rule;
+        total.allowed_default += counts.allowed_default;
+        total.blocked += counts.blocked;
+        total.rate_limited += counts.rate_limited;
+        total.parse_failed += counts.parse_failed;
+    }
+
+    // Everything allocated from the DPDK heap lives in here, so it is released before rte_eal_cleanup
+    int run(dpdk_pcap_reader& reader, const std::string& rule_path, int iterations, bool pipeline) {
+        dpdk_packet_filter filter;
+        if (!filter.load_rules(rule_path)) {
+            return EXIT_FAILURE;
+        }
+        const uint64_t tsc_hz = calibrate_tsc_hz();
+        std::vector<uint64_t> latencies;
+        latencies.reserve(std::min<size_t>(max_latency_samples, reader.count() * iterations));
+
+        if (!pipeline) {
+            Classifier_t classifier;
+            if (!init_classifier(classifier, filter, 0)) {
+                return EXIT_FAILURE;
+            }
+
+            // Warm caches and branch predictors once, then measure
+            replay_rtc(reader, classifier, nullptr);
+            classifier.verdicts = VerdictCounts_t{};
+
+            const auto wall_start = std::chrono::steady_clock::now();
+            const uint64_t tsc_start = rte_rdtsc();
+            for (int iter = 0; iter < iterations; iter++) {
+                replay_rtc(reader, classifier, &latencies);
+            }
+            const uint64_t cycles = rte_rdtsc() - tsc_start;
+            const double wall_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start).count();
+
+            spdlog::info("==== pcap replay (run to completion): {} packets x {} iterations ====", reader.count(), iterations);
+            report(reader, iterations, tsc_hz, cycles, wall_ns, classifier.verdicts, latencies);
+
+            const FlowCacheStats_t& cache = classifier.flow_cache.stats();
+            const uint64_t lookups = cache.hits + cache.misses;
+            spdlog::info("Flow cache   : {} flows, {:.1f}% hits ({} hits, {} misses, {} closed, {} not cached)",
+                         classifier.flow_cache.size(), lookups ? 100.0 * cache.hits / lookups : 0.0,
+                         cache.hits, cache.misses, cache.closed, cache.full);
+            report_parse_cost(reader, iterations);
+            return EXIT_SUCCESS;
+        }
+
+        // Pipeline: the TX ring only needs to hold one capture's worth of bursts in flight. The
+        // distributor frees what does not fit a classifier ring, and the capture's mbufs are
+        // reused every iteration, so each classifier ring holds a whole capture.
+        const unsigned classifier_ring_size = rte_align32pow2(static_cast<uint32_t>(reader.count()) + 1);
+        rte_ring* tx_ring = rte_ring_create("bench_tx", 4096, SOCKET_ID_ANY, RING_F_SC_DEQ);
+        if (!tx_ring) {
+            spdlog::error("Failed to create pipeline rings");
+            return EXIT_FAILURE;
+        }
+
+        std::atomic<bool> running{true};
+        std::vector<std::unique_ptr<Classifier_t>> classifiers;
+        std::vector<rte_ring*> classifier_rings;
+        auto free_rings = [&]() {
+            for (rte_ring* ring : classifier_rings) {
+                rte_ring_free(ring);
+            }
+            rte_ring_free(tx_ring);
+        };
+        unsigned lcore_id;
+        RTE_LCORE_FOREACH_WORKER(lcore_id) {
+            auto classifier = std::make_unique<Classifier_t>();
+            rte_ring* rx_ring = rte_ring_create(("bench_cls_" + std::to_string(lcore_id)).c_str(), classifier_ring_size,
+                                                SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+            if (!rx_ring || !init_classifier(*classifier, filter, lcore_id)) {
+                spdlog::error("Failed to set up classifier lcore {}", lcore_id);
+                rte_ring_free(rx_ring);
+                classifiers.clear();
+                free_rings();
+                return EXIT_FAILURE;
+            }
+            classifier_rings.push_back(rx_ring);
+            classifier->rx_ring = rx_ring;
+            classifier->tx_ring = tx_ring;
+            classifier->running = &running;
+            classifiers.push_back(std::move(classifier));
+        }
+
+        // The agent's defaults: Toeplitz with the symmetric key, no decapsulation
+        std::vector<uint8_t> rss_key;
+        for (size_t i = 0; i < 40; i++) {
+            rss_key.push_back(i % 2 == 0 ? 0x6d : 0x5a);
+        }
+        dpdk_flow_distributor distributor;
+        if (!distributor.init(FlowHash::TOEPLITZ, rss_key, classifier_rings, false)) {
+            classifiers.clear();
+            free_rings();
+            return EXIT_FAILURE;
+        }
+
+        // Launched only once every classifier is set up, so a failure above leaves no lcore running
+        size_t next = 0;
+        RTE_LCORE_FOREACH_WORKER(lcore_id) {
+            rte_eal_remote_launch(run_classifier_lcore, classifiers[next++].get(), lcore_id);
+        }
+
+        std::vector<uint64_t> inject_tsc(reader.count());
+        replay_pipeline(reader, classifiers, distributor, tx_ring, inject_tsc, nullptr);
+        for (auto& classifier : classifiers) {
+            classifier->verdicts = VerdictCounts_t{};
+        }
+
+        const auto wall_start = std::chrono::steady_clock::now();
+        const uint64_t tsc_start = rte_rdtsc();
+        for (int iter = 0; iter < iterations; iter++) {
+            replay_pipeline(reader, classifiers, distributor, tx_ring, inject_tsc, &latencies);
+        }
+        const uint64_t cycles = rte_rdtsc() - tsc_start;
+        const double wall_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start).count();
+
+        running = false;
+        rte_eal_mp_wait_lcore();
+
+        VerdictCounts_t verdicts{};
+        for (const auto& classifier : classifiers) {
+            add_verdicts(verdicts, classifier->verdicts);
+        }
+        spdlog::info("==== pcap replay (pipeline, {} classifier lcores): {} packets x {} iterations ====",
+                     classifiers.size(), reader.count(), iterations);
+        report(reader, iterations, tsc_hz, cycles, wall_ns, verdicts, latencies);
+
+        classifiers.clear();
+        free_rings();
+        return EXIT_SUCCESS;
+    }
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+    if (argc < 2) {
+        spdlog::error("Usage: {} <capture.pcap> [block_list.json] [iterations] [rtc|pipeline] [classifier lcores]", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string pcap_path = argv[1];
+    const std::string rule_path = argc > 2 ? argv[2] : "../config/block_list.json";
+    const int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 100;
+    const std::string mode = argc > 4 ? argv[4] : "rtc";
+    const unsigned classifier_lcores = argc > 5 ? static_cast<unsigned>(std::max(1, std::atoi(argv[5]))) : 2;
+
+    if (mode != "rtc" && mode != "pipeline") {
+        spdlog::error("Unknown mode '{}', expected rtc or pipeline", mode);
+        return EXIT_FAILURE;
+    }
+    const bool pipeline = mode == "pipeline";
+
+    dpdk_pcap_reader reader;
+    if (!reader.open(pcap_path) || reader.count() == 0) {
+        spdlog::error("No packets to replay from {}", pcap_path);
+        return EXIT_FAILURE;
+    }
+
+    if (!initialize_eal(pipeline ? classifier_lcores + 1 : 1)) {
+        spdlog::error("Failed to initialize EAL");
+        return EXIT_FAILURE;
+    }
+
+    const int status = run(reader, rule_path, iterations, pipeline);
+    rte_eal_cleanup();
+    return status;
+}
@@ -0,0 +1,252 @@
+#include "dpdk_acl_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <rte_errno.h>
+#include <spdlog/spdlog.h>
+
+dpdk_acl_table::dpdk_acl_table(NetworkProtocol family)
+    : _ctx(nullptr)
+    , _family(family)
+    , _scoped(false) {
+
+}
+
+dpdk_acl_table::~dpdk_acl_table() {
+    clear();
+}
+
+void dpdk_acl_table::clear() {
+    _pending.clear();
+    _scoped = false;
+    if (_ctx) {
+        rte_acl_free(_ctx);
+        _ctx = nullptr;
+    }
+}
+
+uint32_t dpdk_acl_table::field_count() const {
+    return (_family == NetworkProtocol::IPv4 ? 5 : 11) + (_scoped ? 2 : 0);
+}
+
+void dpdk_acl_table::set_prefix(const std::optional<IpPrefix_t>& prefix, rte_acl_field* fields, uint32_t words) {
+    // One 32-bit MASK field per address word, mask_range is the prefix length within that word
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t word = 0;
+        int bits = 0;
+        if (prefix) {
+            std::memcpy(&word, prefix->addr.v6 + i * 4, sizeof(word));
+            bits = std::min(32, std::max(0, static_cast<int>(prefix->length) - static_cast<int>(i * 32)));
+        }
+        fields[i].value.u32 = ntohl(word);
+        fields[i].mask_range.u32 = static_cast<uint32_t>(bits);
+    }
+}
+
+void dpdk_acl_table::set_range(const std::optional<PortRange_t>& range, rte_acl_field& field) {
+    field.value.u16 = range ? range->low : 0;
+    field.mask_range.u16 = range ? range->high : UINT16_MAX;
+}
+
+void dpdk_acl_table::set_exact(const std::optional<uint32_t>& value, rte_acl_field& field) {
+    field.value.u32 = value ? *value : 0;
+    field.mask_range.u32 = value ? 32 : 0;
+}
+
+void dpdk_acl_table::add(const RuleMatch_t& match, uint32_t rule_id, uint32_t value) {
+    AclRule_t rule{};
+    rule.data.category_mask = 1;
+    // rte_acl returns the highest priority match, earlier rules must win
+    rule.data.priority = static_cast<int32_t>(
+            rule_id < RTE_ACL_MAX_PRIORITY - RTE_ACL_MIN_PRIORITY ? RTE_ACL_MAX_PRIORITY - rule_id : RTE_ACL_MIN_PRIORITY);
+    // userdata 0 means "no match" to rte_acl, so shift by one
+    rule.data.userdata = value + 1;
+
+    rule.field[0].value.u8 = match.proto ? *match.proto : 0;
+    rule.field[0].mask_range.u8 = match.proto ? UINT8_MAX : 0;
+
+    const uint32_t words = _family == NetworkProtocol::IPv4 ? 1 : 4;
+    set_prefix(match.src_ip, &rule.field[1], words);
+    set_prefix(match.dst_ip, &rule.field[1 + words], words);
+    set_range(match.src_port, rule.field[1 + 2 * words]);
+    set_range(match.dst_port, rule.field[2 + 2 * words]);
+    // Compared against the key's encoded form, so the PRESENT bit keeps untagged packets out
+    set_exact(match.vlan ? std::optional<uint32_t>(FLOW_KEY_VLAN_PRESENT | *match.vlan) : std::nullopt,
+              rule.field[3 + 2 * words]);
+    set_exact(match.vni ? std::optional<uint32_t>(FLOW_KEY_VNI_PRESENT | *match.vni) : std::nullopt,
+              rule.field[4 + 2 * words]);
+    _scoped = _scoped || match.vlan || match.vni;
+
+    _pending.push_back(rule);
+}
+
+void dpdk_acl_table::fill_config(rte_acl_config& config) const {
+    config.num_categories = 1;
+    config.num_fields = field_count();
+
+    // The first field must be one byte wide, the rest are grouped in 4-byte input words
+    uint8_t index = 0;
+    auto def = [&config, &index](uint8_t type, uint8_t size, uint8_t input_index, size_t offset) {
+        rte_acl_field_def& field = config.defs[index];
+        field.type = type;
+        field.size = size;
+        field.field_index = index;
+        field.input_index = input_index;
+        field.offset = static_cast<uint32_t>(offset);
+        index++;
+    };
+
+    if (_family == NetworkProtocol::IPv4) {
+        def(RTE_ACL_FIELD_TYPE_BITMASK, sizeof(uint8_t), 0, offsetof(AclKey4_t, proto));
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 1, offsetof(AclKey4_t, src_addr));
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 2, offsetof(AclKey4_t, dst_addr));
+        def(RTE_ACL_FIELD_TYPE_RANGE, sizeof(uint16_t), 3, offsetof(AclKey4_t, src_port));
+        def(RTE_ACL_FIELD_TYPE_RANGE, sizeof(uint16_t), 3, offsetof(AclKey4_t, dst_port));
+        if (_scoped) {
+            def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 4, offsetof(AclKey4_t, vlan));
+            def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 5, offsetof(AclKey4_t, vni));
+        }
+        return;
+    }
+
+    def(RTE_ACL_FIELD_TYPE_BITMASK, sizeof(uint8_t), 0, offsetof(AclKey6_t, proto));
+    for (uint8_t i = 0; i < 4; i++) {
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 1 + i, offsetof(AclKey6_t, src_addr) + i * 4);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 5 + i, offsetof(AclKey6_t, dst_addr) + i * 4);
+    }
+    def(RTE_ACL_FIELD_TYPE_RANGE, sizeof(uint16_t), 9, offsetof(AclKey6_t, src_port));
+    def(RTE_ACL_FIELD_TYPE_RANGE, sizeof(uint16_t), 9, offsetof(AclKey6_t, dst_port));
+    if (_scoped) {
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 10, offsetof(AclKey6_t, vlan));
+        def(RTE_ACL_FIELD_TYPE_MASK, sizeof(uint32_t), 11, offsetof(AclKey6_t, vni));
+    }
+}
+
+bool dpdk_acl_table::build() {
+    if (_ctx) {
+        rte_acl_free(_ctx);
+        _ctx = nullptr;
+    }
+    if (_pending.empty()) {
+        return true;
+    }
+
+    // Every generation gets its own context, names must be unique while the old one lives
+    static std::atomic<uint32_t> instance{0};
+    const std::string name = std::string(_family == NetworkProtocol::IPv4 ? "acl4_" : "acl6_") +
+                             std::to_string(instance.fetch_add(1));
+
+    rte_acl_param param{};
+    param.name = name.c_str();
+    param.socket_id = SOCKET_ID_ANY;
+    param.rule_size = sizeof(AclRule_t);
+    param.max_rule_num = static_cast<uint32_t>(_pending.size());
+
+    _ctx = rte_acl_create(&param);
+    if (!_ctx) {
+        spdlog::error("Failed to create ACL context {}: {}", name, rte_strerror(rte_errno));
+        return false;
+    }
+
+    int ret = rte_acl_add_rules(_ctx, reinterpret_cast<const rte_acl_rule*>(_pending.data()),
+                                static_cast<uint32_t>(_pending.size()));
+    if (ret != 0) {
+        spdlog::error("Failed to add {} rules to ACL context {}: {}", _pending.size(), name, rte_strerror(-ret));
+        clear();
+        return false;
+    }
+
+    rte_acl_config config{};
+    fill_config(config);
+    ret = rte_acl_build(_ctx, &config);
+    if (ret != 0) {
+        spdlog::error("Failed to build ACL context {}: {}", name, rte_strerror(-ret));
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void dpdk_acl_table::classify_burst(const FlowKeyBurst_t& keys, uint32_t* results) const {
+    if (!_ctx) {
+        return;
+    }
+
+    // Only packets of this family take part, gather them into contiguous inputs
+    union {
+        AclKey4_t v4;
+        AclKey6_t v6;
+    } input[FLOW_KEY_BURST_MAX];
+    const uint8_t* data[FLOW_KEY_BURST_MAX];
+    uint16_t index[FLOW_KEY_BURST_MAX];
+    uint32_t matches[FLOW_KEY_BURST_MAX];
+
+    uint32_t count = 0;
+    for (uint16_t i = 0; i < keys.count; i++) {
+        if (keys.family[i] != _family || keys.status[i] != ParseStatus::OK) {
+            continue;
+        }
+
+        if (_family == NetworkProtocol::IPv4) {
+            AclKey4_t& key = input[count].v4;
+            key.proto = keys.proto[i];
+            key.src_addr = keys.src_addr[i].v4;
+            key.dst_addr = keys.dst_addr[i].v4;
+            key.src_port = htons(keys.src_port[i]);
+            key.dst_port = htons(keys.dst_port[i]);
+            key.vlan = htonl(keys.vlan[i]);
+            key.vni = htonl(keys.vni[i]);
+        } else {
+            AclKey6_t& key = input[count].v6;
+            key.proto = keys.proto[i];
+            std::memcpy(key.src_addr, keys.src_addr[i].v6, sizeof(key.src_addr));
+            std::memcpy(key.dst_addr, keys.dst_addr[i].v6, sizeof(key.dst_addr));
+            key.src_port = htons(keys.src_port[i]);
+            key.dst_port = htons(keys.dst_port[i]);
+            key.vlan = htonl(keys.vlan[i]);
+            key.vni = htonl(keys.vni[i]);
+        }
+        data[count] = reinterpret_cast<const uint8_t*>(&input[count]);
+        index[count] = i;
+        count++;
+    }
+
+    if (count == 0 || rte_acl_classify(_ctx, data, matches, count, 1) != 0) {
+        return;
+    }
+
+    for (uint32_t j = 0; j < count; j++) {
+        if (matches[j] != 0 && matches[j] - 1 < results[index[j]]) {
+            results[index[j]] = matches[j] - 1;
+        }
+    }
+}
+
+size_t dpdk_acl_table::size() const {
+    return _pending.size();
+}
+
+void dpdk_acl_table::save(dpdk_rule_snapshot_writer& writer, SnapshotSection section) const {
+    writer.add(section, _pending.data(), sizeof(AclRule_t), _pending.size(), _scoped ? 1 : 0);
+}
+
+bool dpdk_acl_table::attach(const dpdk_rule_snapshot& snapshot, SnapshotSection section) {
+    clear();
+    uint64_t count = 0;
+    uint64_t scoped = 0;
+    const void* rules = snapshot.section(section, sizeof(AclRule_t), count, scoped);
+    if (!rules) {
+        return false;
+    }
+
+    const auto* begin = static_cast<const AclRule_t*>(rules);
+    _pending.assign(begin, begin + count);
+    _scoped = scoped != 0;
+    return build();
+}
@@ -0,0 +1,89 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_ACL_TABLE_H
+#define DPDK_FASTDROP_AGENT_DPDK_ACL_TABLE_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <rte_acl.h>
+
+#include "dpdk_flow_key.h"
+#include "dpdk_rule_match.h"
+#include "dpdk_rule_snapshot.h"
+
+// Multi-field (proto, src/dst address, src/dst port range) rules for one address family,
+// compiled into an rte_acl trie and classified a whole burst at a time with the SIMD path
+// DPDK picks for this CPU. Results are folded into the caller's array with min(), like
+// every other classifier stage.
+// VLAN and VNI fields are only defined once a rule is scoped by them, so rule sets that
+// never mention them build the same trie as before.
+class dpdk_acl_table {
+public:
+    explicit dpdk_acl_table(NetworkProtocol family);
+    virtual ~dpdk_acl_table();
+
+    void clear();
+    void add(const RuleMatch_t& match, uint32_t rule_id, uint32_t value);
+    bool build();
+    void classify_burst(const FlowKeyBurst_t& keys, uint32_t* results) const;
+
+    size_t size() const;
+
+    // rte_acl tries can not be serialized, so snapshots carry the rules and attach() rebuilds
+    void save(dpdk_rule_snapshot_writer& writer, SnapshotSection section) const;
+    bool attach(const dpdk_rule_snapshot& snapshot, SnapshotSection section);
+
+    // True when check() accepts the value of every rule
+    template<typename Check>
+    bool all_values(Check check) const {
+        for (const auto& rule : _pending) {
+            if (rule.data.userdata != 0 && !check(rule.data.userdata - 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t MAX_FIELDS = 13;    // IPv6: proto, 4 + 4 address words, 2 ports, vlan, vni
+
+    RTE_ACL_RULE_DEF(AclRule, MAX_FIELDS);
+    typedef struct AclRule AclRule_t;
+
+    // Classifier input, fields in network order at the offsets the field defs declare
+    typedef struct AclKey4 {
+        uint8_t  proto;
+        uint8_t  pad[3];
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint32_t vlan;
+        uint32_t vni;
+    } AclKey4_t;
+
+    typedef struct AclKey6 {
+        uint8_t  proto;
+        uint8_t  pad[3];
+        uint8_t  src_addr[16];
+        uint8_t  dst_addr[16];
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint32_t vlan;
+        uint32_t vni;
+    } AclKey6_t;
+
+    uint32_t field_count() const;
+    void fill_config(rte_acl_config& config) const;
+    static void set_prefix(const std::optional<IpPrefix_t>& prefix, rte_acl_field* fields, uint32_t words);
+    static void set_range(const std::optional<PortRange_t>& range, rte_acl_field& field);
+    static void set_exact(const std::optional<uint32_t>& value, rte_acl_field& field);
+
+    std::vector<AclRule_t> _pending;
+    rte_acl_ctx* _ctx;
+    NetworkProtocol _family;
+    bool _scoped;   // some rule matches on vlan or vni
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_ACL_TABLE_H
@@ -0,0 +1,299 @@
+#include "dpdk_agent_config.h"
+
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+dpdk_agent_config::dpdk_agent_config()
+    : _rule_path("../config/block_list.json")
+    , _watch_rules(true)
+    , _rule_snapshot_memory("mmap")
+    , _metrics_path("/var/run/dpdk-fastdrop-agent.prom")
+    , _rule_stats_enabled(true)
+    , _rule_stats_path("/var/run/dpdk-fastdrop-agent.rules.json")
+    , _rule_stats_interval_s(10)
+    , _rss_functions{"ip", "tcp", "udp"}
+    , _rss_key("symmetric")
+    , _offload_mode("on")
+    , _rate_limit_entries(16384)
+    , _flow_cache_entries(65536)
+    , _flow_cache_idle_ms(30000)
+    , _prefilter_enabled(false)
+    , _prefilter_false_positive_rate(0.01)
+    , _fragment_entries(4096)
+    , _fragment_timeout_ms(2000)
+    , _decapsulate(false)
+    , _rx_ptype_offload(true)
+    , _rx_checksum_offload(true)
+    , _packet_log_sample_rate(0)
+    , _packet_log_reasons{"blocked", "rate_limited"}
+    , _packet_log_max_per_second(100)
+    , _packet_log_ring_size(1024)
+    , _power_mode("adaptive")
+    , _power_max_spin_us(20)
+    , _power_max_pause_us(200)
+    , _power_sleep_us(100)
+    , _power_epoll_timeout_ms(10)
+    , _pipeline_mode("run_to_completion")
+    , _pipeline_rx_lcores(1)
+    , _pipeline_tx_lcores(1)
+    , _pipeline_ring_size(4096)
+    , _pipeline_distribution("shared")
+    , _pipeline_flow_hash("toeplitz") {
+
+}
+
+dpdk_agent_config::~dpdk_agent_config() {
+
+}
+
+bool dpdk_agent_config::load(const std::string& path) {
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        spdlog::warn("Agent config {} not found, using defaults", path);
+        return true;
+    }
+
+    nlohmann::json json;
+    try {
+        f >> json;
+    } catch (const std::exception& e) {
+        spdlog::error("Agent config parse error: {}", e.what());
+        return false;
+    }
+
+    try {
+        if (json.contains("rules")) {
+            const auto& rules = json["rules"];
+            _rule_path = rules.value("path", _rule_path);
+            _watch_rules = rules.value("watch", _watch_rules);
+            _rule_snapshot_memory = rules.value("snapshot_memory", _rule_snapshot_memory);
+        }
+
+        if (json.contains("metrics")) {
+            _metrics_path = json["metrics"].value("path", _metrics_path);
+        }
+
+        if (json.contains("rule_stats")) {
+            const auto& rule_stats = json["rule_stats"];
+            _rule_stats_enabled = rule_stats.value("enabled", _rule_stats_enabled);
+            _rule_stats_path = rule_stats.value("path", _rule_stats_path);
+            _rule_stats_interval_s = rule_stats.value("interval_s", _rule_stats_interval_s);
+        }
+
+        if (json.contains("rss")) {
+            const auto& rss = json["rss"];
+            _rss_functions = rss.value("functions", _rss_functions);
+            _rss_key = rss.value("key", _rss_key);
+        }
+
+        if (json.contains("offload")) {
+            _offload_mode = json["offload"].value("mode", _offload_mode);
+        }
+
+        if (json.contains("rate_limit")) {
+            _rate_limit_entries = json["rate_limit"].value("table_entries", _rate_limit_entries);
+        }
+
+        if (json.contains("flow_cache")) {
+            const auto& flow_cache = json["flow_cache"];
+            _flow_cache_entries = flow_cache.value("entries", _flow_cache_entries);
+            _flow_cache_idle_ms = flow_cache.value("idle_timeout_ms", _flow_cache_idle_ms);
+        }
+
+        if (json.contains("prefilter")) {
+            const auto& prefilter = json["prefilter"];
+            _prefilter_enabled = prefilter.value("enabled", _prefilter_enabled);
+            _prefilter_false_positive_rate = prefilter.value("false_positive_rate", _prefilter_false_positive_rate);
+        }
+
+        if (json.contains("fragments")) {
+            const auto& fragments = json["fragments"];
+            _fragment_entries = fragments.value("entries", _fragment_entries);
+            _fragment_timeout_ms = fragments.value("timeout_ms", _fragment_timeout_ms);
+        }
+
+        if (json.contains("parser")) {
+            _decapsulate = json["parser"].value("decapsulate", _decapsulate);
+        }
+
+        if (json.contains("rx_offload")) {
+            const auto& rx_offload = json["rx_offload"];
+            _rx_ptype_offload = rx_offload.value("ptype", _rx_ptype_offload);
+            _rx_checksum_offload = rx_offload.value("checksum", _rx_checksum_offload);
+        }
+
+        if (json.contains("packet_log")) {
+            const auto& packet_log = json["packet_log"];
+            _packet_log_sample_rate = packet_log.value("sample_rate", _packet_log_sample_rate);
+            _packet_log_reasons = packet_log.value("reasons", _packet_log_reasons);
+            _packet_log_max_per_second = packet_log.value("max_per_second", _packet_log_max_per_second);
+            _packet_log_ring_size = packet_log.value("ring_size", _packet_log_ring_size);
+        }
+
+        if (json.contains("power")) {
+            const auto& power = json["power"];
+            _power_mode = power.value("mode", _power_mode);
+            _power_max_spin_us = power.value("max_spin_us", _power_max_spin_us);
+            _power_max_pause_us = power.value("max_pause_us", _power_max_pause_us);
+            _power_sleep_us = power.value("sleep_us", _power_sleep_us);
+            _power_epoll_timeout_ms = power.value("epoll_timeout_ms", _power_epoll_timeout_ms);
+        }
+
+        if (json.contains("pipeline")) {
+            const auto& pipeline = json["pipeline"];
+            _pipeline_mode = pipeline.value("mode", _pipeline_mode);
+            _pipeline_rx_lcores = pipeline.value("rx_lcores", _pipeline_rx_lcores);
+            _pipeline_tx_lcores = pipeline.value("tx_lcores", _pipeline_tx_lcores);
+            _pipeline_ring_size = pipeline.value("ring_size", _pipeline_ring_size);
+            _pipeline_distribution = pipeline.value("distribution", _pipeline_distribution);
+            _pipeline_flow_hash = pipeline.value("flow_hash", _pipeline_flow_hash);
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Invalid agent config {}: {}", path, e.what());
+        return false;
+    }
+
+    spdlog::info("Agent config loaded from {}", path);
+    return true;
+}
+
+const std::string& dpdk_agent_config::rule_path() const {
+    return _rule_path;
+}
+
+bool dpdk_agent_config::watch_rules() const {
+    return _watch_rules;
+}
+
+const std::string& dpdk_agent_config::rule_snapshot_memory() const {
+    return _rule_snapshot_memory;
+}
+
+const std::string& dpdk_agent_config::metrics_path() const {
+    return _metrics_path;
+}
+
+bool dpdk_agent_config::rule_stats_enabled() const {
+    return _rule_stats_enabled;
+}
+
+const std::string& dpdk_agent_config::rule_stats_path() const {
+    return _rule_stats_path;
+}
+
+uint32_t dpdk_agent_config::rule_stats_interval_s() const {
+    return _rule_stats_interval_s;
+}
+
+const std::vector<std::string>& dpdk_agent_config::rss_functions() const {
+    return _rss_functions;
+}
+
+const std::string& dpdk_agent_config::rss_key() const {
+    return _rss_key;
+}
+
+const std::string& dpdk_agent_config::offload_mode() const {
+    return _offload_mode;
+}
+
+uint32_t dpdk_agent_config::rate_limit_entries() const {
+    return _rate_limit_entries;
+}
+
+uint32_t dpdk_agent_config::flow_cache_entries() const {
+    return _flow_cache_entries;
+}
+
+uint32_t dpdk_agent_config::flow_cache_idle_ms() const {
+    return _flow_cache_idle_ms;
+}
+
+bool dpdk_agent_config::prefilter_enabled() const {
+    return _prefilter_enabled;
+}
+
+double dpdk_agent_config::prefilter_false_positive_rate() const {
+    return _prefilter_false_positive_rate;
+}
+
+uint32_t dpdk_agent_config::fragment_entries() const {
+    return _fragment_entries;
+}
+
+uint32_t dpdk_agent_config::fragment_timeout_ms() const {
+    return _fragment_timeout_ms;
+}
+
+bool dpdk_agent_config::decapsulate() const {
+    return _decapsulate;
+}
+
+bool dpdk_agent_config::rx_ptype_offload() const {
+    return _rx_ptype_offload;
+}
+
+bool dpdk_agent_config::rx_checksum_offload() const {
+    return _rx_checksum_offload;
+}
+
+uint32_t dpdk_agent_config::packet_log_sample_rate() const {
+    return _packet_log_sample_rate;
+}
+
+const std::vector<std::string>& dpdk_agent_config::packet_log_reasons() const {
+    return _packet_log_reasons;
+}
+
+uint32_t dpdk_agent_config::packet_log_max_per_second() const {
+    return _packet_log_max_per_second;
+}
+
+uint32_t dpdk_agent_config::packet_log_ring_size() const {
+    return _packet_log_ring_size;
+}
+
+const std::string& dpdk_agent_config::power_mode() const {
+    return _power_mode;
+}
+
+uint32_t dpdk_agent_config::power_max_spin_us() const {
+    return _power_max_spin_us;
+}
+
+uint32_t dpdk_agent_config::power_max_pause_us() const {
+    return _power_max_pause_us;
+}
+
+uint32_t dpdk_agent_config::power_sleep_us() const {
+    return _power_sleep_us;
+}
+
+uint32_t dpdk_agent_config::power_epoll_timeout_ms() const {
+    return _power_epoll_timeout_ms;
+}
+
+const std::string& dpdk_agent_config::pipeline_mode() const {
+    return _pipeline_mode;
+}
+
+uint16_t dpdk_agent_config::pipeline_rx_lcores() const {
+    return _pipeline_rx_lcores;
+}
+
+uint16_t dpdk_agent_config::pipeline_tx_lcores() const {
+    return _pipeline_tx_lcores;
+}
+
+uint32_t dpdk_agent_config::pipeline_ring_size() const {
+    return _pipeline_ring_size;
+}
+
+const std::string& dpdk_agent_config::pipeline_distribution() const {
+    return _pipeline_distribution;
+}
+
+const std::string& dpdk_agent_config::pipeline_flow_hash() const {
+    return _pipeline_flow_hash;
+}
@@ -0,0 +1,92 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_AGENT_CONFIG_H
+#define DPDK_FASTDROP_AGENT_DPDK_AGENT_CONFIG_H
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Agent settings from config/agent.json. Missing keys keep their defaults.
+class dpdk_agent_config : public std::enable_shared_from_this<dpdk_agent_config> {
+public:
+    explicit dpdk_agent_config();
+    virtual ~dpdk_agent_config();
+
+    bool load(const std::string& path);
+
+    const std::string& rule_path() const;
+    bool watch_rules() const;
+    const std::string& rule_snapshot_memory() const;
+    const std::string& metrics_path() const;
+    bool rule_stats_enabled() const;
+    const std::string& rule_stats_path() const;
+    uint32_t rule_stats_interval_s() const;
+    const std::vector<std::string>& rss_functions() const;
+    const std::string& rss_key() const;
+    const std::string& offload_mode() const;
+    uint32_t rate_limit_entries() const;
+    uint32_t flow_cache_entries() const;
+    uint32_t flow_cache_idle_ms() const;
+    bool prefilter_enabled() const;
+    double prefilter_false_positive_rate() const;
+    uint32_t fragment_entries() const;
+    uint32_t fragment_timeout_ms() const;
+    bool decapsulate() const;
+    bool rx_ptype_offload() const;
+    bool rx_checksum_offload() const;
+    uint32_t packet_log_sample_rate() const;
+    const std::vector<std::string>& packet_log_reasons() const;
+    uint32_t packet_log_max_per_second() const;
+    uint32_t packet_log_ring_size() const;
+    const std::string& power_mode() const;
+    uint32_t power_max_spin_us() const;
+    uint32_t power_max_pause_us() const;
+    uint32_t power_sleep_us() const;
+    uint32_t power_epoll_timeout_ms() const;
+    const std::string& pipeline_mode() const;
+    uint16_t pipeline_rx_lcores() const;
+    uint16_t pipeline_tx_lcores() const;
+    uint32_t pipeline_ring_size() const;
+    const std::string& pipeline_distribution() const;
+    const std::string& pipeline_flow_hash() const;
+
+private:
+    std::string _rule_path;
+    bool _watch_rules;
+    std::string _rule_snapshot_memory;          // "mmap" or "hugepage", for binary rule snapshots
+    std::string _metrics_path;
+    bool _rule_stats_enabled;                   // per-rule hit counters, one array per lcore
+    std::string _rule_stats_path;               // JSON report of hits per rule
+    uint32_t _rule_stats_interval_s;
+    std::vector<std::string> _rss_functions;    // "ip", "tcp", "udp"
+    std::string _rss_key;                       // "symmetric" or hex bytes
+    std::string _offload_mode;                  // "off", "dry-run" or "on"
+    uint32_t _rate_limit_entries;               // token buckets per worker lcore
+    uint32_t _flow_cache_entries;               // cached flows per worker lcore, 0 disables the cache
+    uint32_t _flow_cache_idle_ms;
+    bool _prefilter_enabled;                    // Bloom filter in front of the exact-address tables
+    double _prefilter_false_positive_rate;
+    uint32_t _fragment_entries;                 // tracked datagrams per worker lcore, 0 disables tracking
+    uint32_t _fragment_timeout_ms;
+    bool _decapsulate;                          // also match the inner 5-tuple of VXLAN/Geneve/GRE packets, disables flow offload
+    bool _rx_ptype_offload;                     // parse from mbuf packet_type when the PMD reports it
+    bool _rx_checksum_offload;                  // drop packets the NIC flags with a bad checksum
+    uint32_t _packet_log_sample_rate;           // 1 in N, 0 disables packet logging
+    std::vector<std::string> _packet_log_reasons;
+    uint32_t _packet_log_max_per_second;        // per worker lcore, 0 = no cap
+    uint32_t _packet_log_ring_size;
+    std::string _power_mode;                    // "poll" or "adaptive"
+    uint32_t _power_max_spin_us;
+    uint32_t _power_max_pause_us;
+    uint32_t _power_sleep_us;                   // without RX interrupts
+    uint32_t _power_epoll_timeout_ms;
+    std::string _pipeline_mode;                 // "run_to_completion" or "pipeline"
+    uint16_t _pipeline_rx_lcores;
+    uint16_t _pipeline_tx_lcores;
+    uint32_t _pipeline_ring_size;               // per stage ring
+    std::string _pipeline_distribution;         // "shared" or "flow"
+    std::string _pipeline_flow_hash;            // "toeplitz" or "crc32"
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_AGENT_CONFIG_H
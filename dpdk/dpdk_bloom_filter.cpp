@@ -0,0 +1,78 @@
+#include "dpdk_bloom_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+dpdk_bloom_filter::dpdk_bloom_filter()
+    : _false_positive_rate(0.0) {
+
+}
+
+dpdk_bloom_filter::~dpdk_bloom_filter() {
+
+}
+
+double dpdk_bloom_filter::expected_rate(double keys_per_block) {
+    // Keys per block are Poisson distributed; a block holding j keys has each word bit
+    // set with probability 1 - (31/32)^j, and a foreign key needs all eight of its bits set
+    double probability = std::exp(-keys_per_block);
+    double rate = 0.0;
+    const auto last = static_cast<unsigned>(keys_per_block + 10.0 * std::sqrt(keys_per_block) + 20.0);
+    for (unsigned j = 0; j <= last; j++) {
+        rate += probability * std::pow(1.0 - std::pow(31.0 / 32.0, j), WORDS);
+        probability *= keys_per_block / (j + 1);
+    }
+    return rate;
+}
+
+void dpdk_bloom_filter::init(size_t key_count, double false_positive_rate) {
+    const double target = std::clamp(false_positive_rate, 1e-6, 0.5);
+
+    // Densest fill that still meets the target, found by bisection (the rate grows with the fill)
+    double low = 0.0;
+    double high = 64.0;
+    for (int i = 0; i < 40; i++) {
+        const double mid = (low + high) / 2.0;
+        (expected_rate(mid) <= target ? low : high) = mid;
+    }
+
+    const double keys_per_block = std::max(low, 1e-3);
+    const auto blocks = static_cast<size_t>(std::ceil(std::max<size_t>(key_count, 1) / keys_per_block));
+    _blocks.assign(std::clamp<size_t>(blocks, 1, UINT32_MAX), Block_t{});
+    _false_positive_rate = expected_rate(static_cast<double>(std::max<size_t>(key_count, 1)) / _blocks.size());
+}
+
+void dpdk_bloom_filter::clear() {
+    _blocks.clear();
+    _blocks.shrink_to_fit();
+    _false_positive_rate = 0.0;
+}
+
+void dpdk_bloom_filter::insert(uint64_t hash) {
+    Block_t& block = _blocks[block_index(hash)];
+    const auto bits = static_cast<uint32_t>(hash);
+    for (unsigned i = 0; i < WORDS; i++) {
+        block.words[i] |= 1u << ((bits * SALTS[i]) >> 27);
+    }
+}
+
+uint16_t dpdk_bloom_filter::probe_burst(const uint64_t* hashes, uint16_t count, bool* listed) const {
+    for (uint16_t i = 0; i < count; i++) {
+        prefetch(hashes[i]);
+    }
+
+    uint16_t ruled_out = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        listed[i] = may_contain(hashes[i]);
+        ruled_out += !listed[i];
+    }
+    return ruled_out;
+}
+
+double dpdk_bloom_filter::false_positive_rate() const {
+    return _false_positive_rate;
+}
+
+size_t dpdk_bloom_filter::memory_bytes() const {
+    return _blocks.size() * sizeof(Block_t);
+}
@@ -0,0 +1,72 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_BLOOM_FILTER_H
+#define DPDK_FASTDROP_AGENT_DPDK_BLOOM_FILTER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Split-block Bloom filter over 64-bit key hashes.
+// A key maps to one 32-byte block (never straddling a cache line) and sets one bit in
+// each of its eight 32-bit words, so a probe is one memory access and eight independent
+// shift/and steps that compilers turn into a single vector compare where the ISA allows.
+// The upper hash half picks the block, the lower half the bits. Built once on the
+// control path; a false answer means the key was never inserted.
+class dpdk_bloom_filter {
+public:
+    explicit dpdk_bloom_filter();
+    virtual ~dpdk_bloom_filter();
+
+    // Sizes the filter for key_count keys at the target false positive rate
+    void init(size_t key_count, double false_positive_rate);
+    void clear();
+    void insert(uint64_t hash);
+
+    inline bool enabled() const {
+        return !_blocks.empty();
+    }
+
+    inline void prefetch(uint64_t hash) const {
+        __builtin_prefetch(&_blocks[block_index(hash)]);
+    }
+
+    inline bool may_contain(uint64_t hash) const {
+        const Block_t& block = _blocks[block_index(hash)];
+        const auto bits = static_cast<uint32_t>(hash);
+        uint32_t missing = 0;
+        for (unsigned i = 0; i < WORDS; i++) {
+            missing |= ~block.words[i] & (1u << ((bits * SALTS[i]) >> 27));
+        }
+        return missing == 0;
+    }
+
+    // Prefetches every block of the burst before testing any; returns how many were ruled out
+    uint16_t probe_burst(const uint64_t* hashes, uint16_t count, bool* listed) const;
+
+    double false_positive_rate() const;
+    size_t memory_bytes() const;
+
+private:
+    static constexpr unsigned WORDS = 8;
+    static constexpr uint32_t SALTS[WORDS] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+
+    typedef struct alignas(32) Block {
+        uint32_t words[WORDS];
+    } Block_t;
+
+    // Multiply-shift instead of a modulo, the block count need not be a power of two
+    inline size_t block_index(uint64_t hash) const {
+        return static_cast<size_t>(((hash >> 32) * _blocks.size()) >> 32);
+    }
+
+    static double expected_rate(double keys_per_block);
+
+    std::vector<Block_t> _blocks;
+    double _false_positive_rate;    // expected for the keys given to init()
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_BLOOM_FILTER_H
@@ -1,14 +1,26 @@
 #include <unistd.h>
+#include <algorithm>
 #include <iomanip>
 #include "dpdk_firewall.h"
 
-dpdk_firewall::dpdk_firewall()
-    : _mem_buf_pool(nullptr)
+dpdk_firewall::dpdk_firewall(const dpdk_agent_config& config)
+    : _config(config)
+    , _workers{}
+    , _metrics_exporter(config.metrics_path())
+    , _mem_buf_pools{}
     , _mem_buf_pool_name("MBUF_POOL")
-    , _mem_buf_pool_size(8192)
     , _mem_buf_pool_cache_size(250)
     , _mem_buf_pool_data_size(RTE_MBUF_DEFAULT_BUF_SIZE)
+    , _dev_info{}
+    , _rx_queue_count(0)
+    , _tx_queue_count(0)
+    , _rx_ring_size(1024)
+    , _tx_ring_size(1024)
     , _port_id(RTE_MAX_ETHPORTS)
+    , _rule_stats_next_tsc(0)
+    , _rx_interrupts(false)
+    , _rx_ptype(false)
+    , _rx_checksum(false)
     , _initialized(false) {
     spdlog::info("Starting DPDK initialization...");
 
@@ -26,6 +38,11 @@ dpdk_firewall::dpdk_firewall()
     }
     spdlog::info("EAL initialized successfully.");
 
+    unsigned lcore_id;
+    RTE_LCORE_FOREACH_WORKER(lcore_id) {
+        _worker_lcores.push_back(lcore_id);
+    }
+
     // Find and validate a usable Ethernet port
     if (!find_and_validate_port()) {
         spdlog::error("DPDK initialization aborted due to port errors.");
@@ -33,12 +50,18 @@ dpdk_firewall::dpdk_firewall()
     }
     spdlog::info("Ethernet port found and validated: port_id={}", _port_id);
 
-    // Create packet buffer pool (mbuf pool)
-    if (!create_mbuf_pool()) {
+    // Decide queue count and ring depth from the worker lcores and device limits
+    if (!plan_queues()) {
+        spdlog::error("DPDK initialization aborted due to queue planning failure.");
+        return;
+    }
+
+    // Create packet buffer pools (one mbuf pool per NUMA socket)
+    if (!create_mbuf_pools()) {
         spdlog::error("DPDK initialization aborted due to mbuf pool creation failure.");
         return;
     }
-    spdlog::info("Mbuf pool created successfully.");
+    spdlog::info("Mbuf pools created successfully.");
 
     // Configure and start Ethernet port
     if (!configure_and_start_port()) {
@@ -46,26 +69,70 @@ dpdk_firewall::dpdk_firewall()
         return;
     }
     spdlog::info("Ethernet port configured and started.");
+    print_mbuf_pool_report();
 
-    // Load Filter Rules
-    const std::string filter_rule_path = "../config/block_list.json";
+    // Load Filter Rules (workers read them under RCU so they can be reloaded live)
+    if (!_packet_filter.enable_rcu(RTE_MAX_LCORE)) {
+        spdlog::error("DPDK initialization aborted due to RCU setup failure.");
+        return;
+    }
+
+    SnapshotMemory snapshot_memory = SnapshotMemory::MMAP;
+    if (!dpdk_rule_snapshot::parse_memory(_config.rule_snapshot_memory(), snapshot_memory)) {
+        spdlog::warn("Unknown rule snapshot memory '{}', using mmap", _config.rule_snapshot_memory());
+    }
+    _packet_filter.set_snapshot_memory(snapshot_memory);
+    if (_config.prefilter_enabled()) {
+        const double rate = _config.prefilter_false_positive_rate();
+        if (rate <= 0.0 || rate > 0.5) {
+            spdlog::warn("Pre-filter false positive rate {} out of range (0, 0.5], using 0.01", rate);
+        }
+        _packet_filter.set_prefilter(rate > 0.0 && rate <= 0.5 ? rate : 0.01);
+    }
+    if (_config.rule_stats_enabled()) {
+        _packet_filter.set_rule_stats(_config.rule_stats_path());
+    }
+
+    const std::string& filter_rule_path = _config.rule_path();
     if (!_packet_filter.load_rules(filter_rule_path)) {
         spdlog::error("Failed to load packet filtering rules from {}", filter_rule_path);
         return;
     }
     _packet_filter.print_rules_comments();
 
+    OffloadMode offload_mode = OffloadMode::OFF;
+    if (!dpdk_flow_offload::parse_mode(_config.offload_mode(), offload_mode)) {
+        spdlog::warn("Unknown offload mode '{}', flow offload disabled", _config.offload_mode());
+    }
+    if (offload_mode != OffloadMode::OFF && _config.decapsulate()) {
+        // rte_flow patterns only see the outer header, so a DROP would also catch tunnels
+        // that an earlier allow rule lets through on their inner tuple
+        spdlog::warn("Flow offload disabled, it cannot follow rules through decapsulated tunnels");
+        offload_mode = OffloadMode::OFF;
+    }
+    _flow_offload.attach(_port_id, offload_mode);
+    apply_flow_offload();
+
     spdlog::info("DPDK initialization complete. Port {} started in promiscuous mode.", _port_id);
     _initialized = true;
     rte_atomic32_set(&_running, 1);
 }
 
 dpdk_firewall::~dpdk_firewall() {
+    destroy_worker_contexts();
+
     if (is_initialized()) {
+        _flow_offload.flush();
+        _pipeline.flush();
         rte_eth_dev_stop(_port_id);
         rte_eth_dev_close(_port_id);
         spdlog::info("DPDK port {} stopped and closed.", _port_id);
     }
+
+    for (auto& pool : _mem_buf_pools) {
+        rte_mempool_free(pool);
+        pool = nullptr;
+    }
 }
 
 bool dpdk_firewall::find_and_validate_port() {
@@ -87,60 +154,290 @@ bool dpdk_firewall::find_and_validate_port() {
     return false;
 }
 
-bool dpdk_firewall::create_mbuf_pool() {
-    _mem_buf_pool = rte_pktmbuf_pool_create(
-        _mem_buf_pool_name.c_str(),
-        _mem_buf_pool_size,
-        _mem_buf_pool_cache_size,
-        0,
-        _mem_buf_pool_data_size,
-        rte_socket_id()  // Allocate memory on current socket
-    );
-
-    if (!_mem_buf_pool) {
-        spdlog::error("Failed to create mbuf pool: {}", rte_strerror(rte_errno));
+bool dpdk_firewall::plan_queues() {
+    int result = rte_eth_dev_info_get(_port_id, &_dev_info);
+    if (result != 0) {
+        spdlog::error("Failed to get device info for port {}: {}", _port_id, rte_strerror(-result));
+        return false;
+    }
+
+    PipelineMode pipeline_mode = PipelineMode::RUN_TO_COMPLETION;
+    if (!dpdk_pipeline::parse_mode(_config.pipeline_mode(), pipeline_mode)) {
+        spdlog::warn("Unknown pipeline mode '{}', running to completion", _config.pipeline_mode());
+    }
+    PipelineDistribution distribution = PipelineDistribution::SHARED;
+    if (!dpdk_pipeline::parse_distribution(_config.pipeline_distribution(), distribution)) {
+        spdlog::warn("Unknown pipeline distribution '{}', using shared rings", _config.pipeline_distribution());
+    }
+    FlowHash flow_hash = FlowHash::TOEPLITZ;
+    if (!dpdk_flow_distributor::parse_hash(_config.pipeline_flow_hash(), flow_hash)) {
+        spdlog::warn("Unknown flow hash '{}', using toeplitz", _config.pipeline_flow_hash());
+    }
+    if (pipeline_mode == PipelineMode::PIPELINE &&
+        !_pipeline.plan(_worker_lcores, _config.pipeline_rx_lcores(), _config.pipeline_tx_lcores())) {
+        spdlog::warn("Pipeline topology unavailable, running to completion");
+    }
+    // Fragment tables are per lcore: with shared rings any classifier may dequeue any fragment,
+    // so a later fragment would miss its first fragment's verdict. Flow rings hash fragments on
+    // L3 and keep a datagram on one classifier.
+    if (_pipeline.enabled() && distribution == PipelineDistribution::SHARED &&
+        _pipeline.classifier_lcores().size() > 1 && _config.fragment_entries() > 0) {
+        spdlog::warn("Shared pipeline rings would split fragments across {} classifier lcores, using flow distribution",
+                     _pipeline.classifier_lcores().size());
+        distribution = PipelineDistribution::FLOW;
+    }
+
+    // One RX and one TX queue per worker lcore, bounded by what the device offers.
+    // In pipeline mode RX stage i polls RX queue i and TX stage i owns TX queue i, and the
+    // counts differ: RSS must spread only over RX queues that some RX stage polls.
+    if (_pipeline.enabled()) {
+        _rx_queue_lcores = _pipeline.rx_lcores();
+        _tx_queue_lcores = _pipeline.tx_lcores();
+        _rx_queue_count = static_cast<uint16_t>(std::min<size_t>(_rx_queue_lcores.size(), _dev_info.max_rx_queues));
+        _tx_queue_count = static_cast<uint16_t>(std::min<size_t>(_tx_queue_lcores.size(), _dev_info.max_tx_queues));
+        if (_rx_queue_count < _rx_queue_lcores.size() || _tx_queue_count < _tx_queue_lcores.size()) {
+            spdlog::error("Port {} supports {} RX / {} TX queues, pipeline stages need {} / {}",
+                          _port_id, _dev_info.max_rx_queues, _dev_info.max_tx_queues,
+                          _rx_queue_lcores.size(), _tx_queue_lcores.size());
+            return false;
+        }
+    } else {
+        _rx_queue_lcores = _worker_lcores;
+        _tx_queue_lcores = _worker_lcores;
+        const size_t wanted = std::max<size_t>(_worker_lcores.size(), 1);
+        _rx_queue_count = static_cast<uint16_t>(std::min<size_t>({wanted, _dev_info.max_rx_queues, _dev_info.max_tx_queues}));
+        _tx_queue_count = _rx_queue_count;
+        if (_rx_queue_count > 0 && _rx_queue_count < wanted) {
+            spdlog::warn("Port {} supports {} queue pairs, {} of {} worker lcores will stay idle",
+                         _port_id, _rx_queue_count, wanted - _rx_queue_count, wanted);
+        }
+    }
+    if (_rx_queue_count == 0 || _tx_queue_count == 0) {
+        spdlog::error("Port {} reports no usable RX/TX queues", _port_id);
+        return false;
+    }
+
+    if (_pipeline.enabled()) {
+        if (!_pipeline.create_rings(_config.pipeline_ring_size(), distribution)) {
+            return false;
+        }
+        // Software RSS hashes with the same key the port is programmed with
+        build_rss_key(_dev_info.hash_key_size ? _dev_info.hash_key_size : 40);
+        if (!_pipeline.init_distributors(flow_hash, _rss_key, _config.decapsulate())) {
+            return false;
+        }
+    }
+
+    result = rte_eth_dev_adjust_nb_rx_tx_desc(_port_id, &_rx_ring_size, &_tx_ring_size);
+    if (result != 0) {
+        spdlog::error("Failed to adjust ring sizes for port {}: {}", _port_id, rte_strerror(-result));
         return false;
     }
     return true;
 }
 
-bool dpdk_firewall::configure_and_start_port() const {
-    rte_eth_conf port_conf = {};
-    port_conf.rxmode.max_lro_pkt_size = RTE_ETHER_MAX_LEN;  // Max LRO packet size
-    port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;   // Multi Queue
+int dpdk_firewall::queue_socket_id(const std::vector<unsigned>& queue_lcores, uint16_t queue_id) const {
+    // Queue memory and its mbufs live next to the lcore that polls the queue
+    if (queue_id < queue_lcores.size()) {
+        return static_cast<int>(rte_lcore_to_socket_id(queue_lcores[queue_id]));
+    }
+    const int port_socket = rte_eth_dev_socket_id(_port_id);
+    return port_socket < 0 ? 0 : port_socket;
+}
 
-    int result = 0;
+bool dpdk_firewall::create_mbuf_pools() {
+    // Per socket: every ring it serves can be full, plus one burst in flight per queue
+    // and a full per-lcore cache on each worker.
+    std::array<uint32_t, RTE_MAX_NUMA_NODES> rx_queues_per_socket{};
+    std::array<uint32_t, RTE_MAX_NUMA_NODES> tx_queues_per_socket{};
+    for (uint16_t q = 0; q < _rx_queue_count; q++) {
+        rx_queues_per_socket[queue_socket_id(_rx_queue_lcores, q)]++;
+    }
+    for (uint16_t q = 0; q < _tx_queue_count; q++) {
+        tx_queues_per_socket[queue_socket_id(_tx_queue_lcores, q)]++;
+    }
 
-    constexpr uint16_t rx_queue_count = 2;
-    constexpr uint16_t tx_queue_count = 2;
+    for (int socket_id = 0; socket_id < RTE_MAX_NUMA_NODES; socket_id++) {
+        const uint32_t rx_queues = rx_queues_per_socket[socket_id];
+        const uint32_t tx_queues = tx_queues_per_socket[socket_id];
+        if (rx_queues == 0 && tx_queues == 0) {
+            continue;
+        }
 
-    rte_eth_dev_configure(_port_id, rx_queue_count, tx_queue_count, &port_conf);
+        // Pipeline rings may hold packets from any socket's RX stage, so count them everywhere
+        const uint32_t needed = rx_queues * (_rx_ring_size + dpdk_worker_context::BURST_SIZE) +
+                                tx_queues * (_tx_ring_size + dpdk_worker_context::BURST_SIZE) +
+                                std::max(rx_queues, tx_queues) * _mem_buf_pool_cache_size + _pipeline.ring_slots();
+        // Mempools are most memory-efficient at 2^n - 1 elements
+        uint32_t pool_size = 8191;
+        while (pool_size < needed) {
+            pool_size = pool_size * 2 + 1;
+        }
 
-    // Setup RX queue 0-n with 128 descriptors
-    for (uint16_t q = 0; q < rx_queue_count; ++q) {
-        int ret = rte_eth_rx_queue_setup(_port_id, q, 128, rte_eth_dev_socket_id(_port_id), nullptr, _mem_buf_pool);
-        if (ret < 0) {
-            spdlog::error("RX queue {} setup failed: {}", q, ret);
+        const std::string pool_name = _mem_buf_pool_name + "_S" + std::to_string(socket_id);
+        _mem_buf_pools[socket_id] = rte_pktmbuf_pool_create(
+            pool_name.c_str(),
+            pool_size,
+            _mem_buf_pool_cache_size,
+            0,
+            _mem_buf_pool_data_size,
+            socket_id
+        );
+
+        if (!_mem_buf_pools[socket_id]) {
+            spdlog::error("Failed to create mbuf pool {} ({} mbufs) on socket {}: {}",
+                          pool_name, pool_size, socket_id, rte_strerror(rte_errno));
             return false;
         }
+        spdlog::info("Mbuf pool {} created: {} mbufs for {} RX / {} TX queues on socket {}",
+                     pool_name, pool_size, rx_queues, tx_queues, socket_id);
+    }
+    return true;
+}
+
+void dpdk_firewall::print_mbuf_pool_report() const {
+    spdlog::info("==== Mbuf Pool Utilisation ====");
+    for (int socket_id = 0; socket_id < RTE_MAX_NUMA_NODES; socket_id++) {
+        const rte_mempool* pool = _mem_buf_pools[socket_id];
+        if (!pool) {
+            continue;
+        }
+        const unsigned in_use = rte_mempool_in_use_count(pool);
+        const unsigned available = rte_mempool_avail_count(pool);
+        const unsigned total = in_use + available;
+        spdlog::info("- socket {}: {} in use / {} total ({:.1f}%), {} available",
+                     socket_id, in_use, total, total ? 100.0 * in_use / total : 0.0, available);
+    }
+    spdlog::info("===============================");
+}
+
+bool dpdk_firewall::build_rss_conf(const rte_eth_dev_info& dev_info, rte_eth_rss_conf& rss_conf) {
+    uint64_t rss_hf = 0;
+    for (const auto& name : _config.rss_functions()) {
+        if (name == "ip") {
+            rss_hf |= RTE_ETH_RSS_IP;
+        } else if (name == "tcp") {
+            rss_hf |= RTE_ETH_RSS_TCP;
+        } else if (name == "udp") {
+            rss_hf |= RTE_ETH_RSS_UDP;
+        } else {
+            spdlog::warn("Unknown RSS hash function '{}' ignored", name);
+        }
+    }
+    // Fragments carry no ports, so the NIC hashes all of them (the first included) on L3 only.
+    // Spread them by address instead of leaving them all on queue 0; either way every fragment
+    // of a datagram reaches the same worker and its fragment table.
+    if (rss_hf & (RTE_ETH_RSS_TCP | RTE_ETH_RSS_UDP)) {
+        rss_hf |= RTE_ETH_RSS_FRAG_IPV4 | RTE_ETH_RSS_FRAG_IPV6;
+    }
+
+    const uint64_t supported = rss_hf & dev_info.flow_type_rss_offloads;
+    if (supported != rss_hf) {
+        spdlog::warn("Port {} supports only RSS types 0x{:x} of requested 0x{:x}", _port_id, supported, rss_hf);
+    }
+
+    build_rss_key(dev_info.hash_key_size ? dev_info.hash_key_size : 40);
+
+    rss_conf.rss_key = _rss_key.data();
+    rss_conf.rss_key_len = static_cast<uint8_t>(_rss_key.size());
+    rss_conf.rss_hf = supported;
+    return supported != 0;
+}
+
+void dpdk_firewall::build_rss_key(size_t key_len) {
+    // A key made of a repeated 16-bit pattern makes Toeplitz symmetric:
+    // both directions of a flow hash to the same queue.
+    const std::string& key = _config.rss_key();
+    _rss_key.clear();
+    if (key != "symmetric") {
+        try {
+            for (size_t i = 0; i + 1 < key.size(); i += 2) {
+                _rss_key.push_back(static_cast<uint8_t>(std::stoul(key.substr(i, 2), nullptr, 16)));
+            }
+        } catch (const std::exception&) {
+            spdlog::warn("RSS key is not valid hex");
+            _rss_key.clear();
+        }
+        if (_rss_key.size() != key_len) {
+            spdlog::warn("RSS key must be {} bytes for port {}, got {}; using symmetric key",
+                         key_len, _port_id, _rss_key.size());
+            _rss_key.clear();
+        }
     }
+    if (_rss_key.empty()) {
+        for (size_t i = 0; i < key_len; i++) {
+            _rss_key.push_back(i % 2 == 0 ? 0x6d : 0x5a);
+        }
+    }
+}
 
-    // Setup TX queue 0 with 128 descriptors
-    result = rte_eth_tx_queue_setup(_port_id, 0, 128, rte_eth_dev_socket_id(_port_id), nullptr);
+bool dpdk_firewall::configure_and_start_port() {
+    int result = 0;
+
+    rte_eth_conf port_conf = {};
+    port_conf.rxmode.max_lro_pkt_size = RTE_ETHER_MAX_LEN;  // Max LRO packet size
+    port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_NONE;
+    if (_rx_queue_count > 1 && build_rss_conf(_dev_info, port_conf.rx_adv_conf.rss_conf)) {
+        port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;   // Multi Queue
+    }
+
+    // Let the NIC verify checksums, workers drop bad packets before parsing them.
+    // Partial support is fine: layers it does not check are flagged unknown, never bad.
+    const uint64_t rx_checksum = _dev_info.rx_offload_capa & RTE_ETH_RX_OFFLOAD_CHECKSUM;
+    if (_config.rx_checksum_offload() && rx_checksum) {
+        port_conf.rxmode.offloads |= rx_checksum;
+        _rx_checksum = true;
+    }
+
+    // RX queue interrupts let idle workers sleep in epoll; not every PMD has them
+    if (build_power_policy().mode == PowerMode::ADAPTIVE) {
+        port_conf.intr_conf.rxq = 1;
+        result = rte_eth_dev_configure(_port_id, _rx_queue_count, _tx_queue_count, &port_conf);
+        _rx_interrupts = result == 0;
+        if (result < 0) {
+            spdlog::warn("Port {} rejected RX interrupts ({}), idle workers use timed sleeps",
+                         _port_id, rte_strerror(-result));
+            port_conf.intr_conf.rxq = 0;
+        }
+    }
+
+    if (!_rx_interrupts) {
+        result = rte_eth_dev_configure(_port_id, _rx_queue_count, _tx_queue_count, &port_conf);
+    }
     if (result < 0) {
-        spdlog::error("Failed to setup TX queue: {}", rte_strerror(-result));
+        spdlog::error("Failed to configure port {} with {} RX / {} TX queues: {}",
+                      _port_id, _rx_queue_count, _tx_queue_count, rte_strerror(-result));
         return false;
     }
 
-    // OPTIONAL (RX interrupt mode)
-    for (uint16_t q = 0; q < rx_queue_count; ++q) {
-        int ret = rte_eth_dev_rx_intr_enable(_port_id, q);
-        if (ret != 0) {
-            spdlog::warn("RX interrupt enable failed for queue {}: {}", q, ret);
-        } else {
-            spdlog::info("RX interrupt enabled for queue {}", q);
+    // Setup RX queues 0-n and TX queues 0-m, each bound to the pool on its lcore's socket
+    const int port_socket = rte_eth_dev_socket_id(_port_id);
+    for (uint16_t q = 0; q < _rx_queue_count; ++q) {
+        const int socket_id = queue_socket_id(_rx_queue_lcores, q);
+        if (port_socket >= 0 && port_socket != socket_id) {
+            spdlog::warn("RX queue {} is polled from socket {} but port {} sits on socket {}",
+                         q, socket_id, _port_id, port_socket);
+        }
+
+        int ret = rte_eth_rx_queue_setup(_port_id, q, _rx_ring_size, socket_id, nullptr, _mem_buf_pools[socket_id]);
+        if (ret < 0) {
+            spdlog::error("RX queue {} setup failed: {}", q, ret);
+            return false;
+        }
+    }
+    for (uint16_t q = 0; q < _tx_queue_count; ++q) {
+        const int socket_id = queue_socket_id(_tx_queue_lcores, q);
+        int ret = rte_eth_tx_queue_setup(_port_id, q, _tx_ring_size, socket_id, nullptr);
+        if (ret < 0) {
+            spdlog::error("Failed to setup TX queue {}: {}", q, rte_strerror(-ret));
+            return false;
         }
     }
+    _rx_ptype = configure_ptypes();
+    spdlog::info("Port {} configured with {} RX / {} TX queues of {}/{} descriptors (RSS {}, ptype {}, RX checksum {})",
+                 _port_id, _rx_queue_count, _tx_queue_count, _rx_ring_size, _tx_ring_size,
+                 port_conf.rxmode.mq_mode == RTE_ETH_MQ_RX_RSS ? "on" : "off",
+                 _rx_ptype ? "on" : "off", _rx_checksum ? "on" : "off");
 
     // Verification
     if (!is_ready_for_dpdk()) {
@@ -160,6 +457,28 @@ bool dpdk_firewall::configure_and_start_port() const {
     return true;
 }
 
+bool dpdk_firewall::configure_ptypes() {
+    if (!_config.rx_ptype_offload()) {
+        return false;
+    }
+
+    // Without L3 and L4 types every packet would fall back to the byte walk anyway
+    constexpr uint32_t ptype_mask = RTE_PTYPE_L2_MASK | RTE_PTYPE_L3_MASK | RTE_PTYPE_L4_MASK | RTE_PTYPE_TUNNEL_MASK;
+    const int l3_types = rte_eth_dev_get_supported_ptypes(_port_id, RTE_PTYPE_L3_MASK, nullptr, 0);
+    const int l4_types = rte_eth_dev_get_supported_ptypes(_port_id, RTE_PTYPE_L4_MASK, nullptr, 0);
+    if (l3_types <= 0 || l4_types <= 0) {
+        spdlog::info("Port {} does not report L3/L4 packet types, headers are parsed from packet bytes", _port_id);
+        return false;
+    }
+
+    // Only ask for the layers the parser reads, so the PMD may skip the rest
+    const int ret = rte_eth_dev_set_ptype_mask(_port_id, ptype_mask, nullptr, 0);
+    if (ret < 0) {
+        spdlog::warn("Port {} rejected the packet type mask: {}", _port_id, rte_strerror(-ret));
+    }
+    return true;
+}
+
 bool dpdk_firewall::initialize_eal() {
     const char* eal_args[] = {
         "dpdk-app",
@@ -311,6 +630,80 @@ bool dpdk_firewall::is_initialized() const {
     return _initialized;
 }
 
+void dpdk_firewall::publish_metrics() {
+    if (is_initialized()) {
+        _metrics_exporter.publish(_workers);
+    }
+
+    // Merging walks every rule once per lcore, so the report runs on its own, slower interval
+    if (is_initialized() && _config.rule_stats_enabled()) {
+        const uint64_t now = rte_rdtsc();
+        if (now >= _rule_stats_next_tsc) {
+            _packet_filter.write_rule_stats();
+            _rule_stats_next_tsc = now + std::max<uint32_t>(_config.rule_stats_interval_s(), 1) * rte_get_tsc_hz();
+        }
+    }
+}
+
+bool dpdk_firewall::rules_changed() const {
+    return is_initialized() && _config.watch_rules() && _packet_filter.rules_file_changed();
+}
+
+bool dpdk_firewall::reload_rules() {
+    if (!is_initialized()) {
+        return false;
+    }
+
+    spdlog::info("Reloading packet filtering rules from {}", _config.rule_path());
+    if (!_packet_filter.load_rules(_config.rule_path())) {
+        return false;
+    }
+    _packet_filter.print_rules_comments();
+
+    // Software already enforces the new set, only now follow up in the NIC
+    apply_flow_offload();
+    return true;
+}
+
+void dpdk_firewall::apply_flow_offload() {
+    const dpdk_rule_set* rule_set = _packet_filter.active_rule_set();
+    if (rule_set && !_flow_offload.apply(*rule_set)) {
+        spdlog::warn("Some block rules could not be offloaded to port {}, software keeps enforcing them", _port_id);
+    }
+}
+
+bool dpdk_firewall::build_packet_log_policy(PacketLogPolicy_t& policy) const {
+    policy = PacketLogPolicy_t{};
+    if (_config.packet_log_sample_rate() == 0) {
+        return true;
+    }
+
+    uint32_t reason_mask = 0;
+    if (!dpdk_packet_logger::parse_reasons(_config.packet_log_reasons(), reason_mask)) {
+        return false;
+    }
+
+    policy.sample_rate = _config.packet_log_sample_rate();
+    policy.reason_mask = reason_mask;
+    policy.max_per_second = _config.packet_log_max_per_second();
+    spdlog::info("Logging 1 in {} packets (reason mask 0x{:x}), at most {} per second per lcore",
+                 policy.sample_rate, policy.reason_mask, policy.max_per_second);
+    return true;
+}
+
+PowerPolicy_t dpdk_firewall::build_power_policy() const {
+    PowerPolicy_t policy{};
+    if (!dpdk_power_manager::parse_mode(_config.power_mode(), policy.mode)) {
+        spdlog::warn("Unknown power mode '{}', using adaptive", _config.power_mode());
+        policy.mode = PowerMode::ADAPTIVE;
+    }
+    policy.max_spin_us = _config.power_max_spin_us();
+    policy.max_pause_us = _config.power_max_pause_us();
+    policy.sleep_us = _config.power_sleep_us();
+    policy.epoll_timeout_ms = _config.power_epoll_timeout_ms();
+    return policy;
+}
+
 void dpdk_firewall::stop_workers() {
     rte_atomic32_set(&_running, 0);
 
@@ -318,108 +711,228 @@ void dpdk_firewall::stop_workers() {
     RTE_LCORE_FOREACH_WORKER(lcore_id) {
         rte_eal_wait_lcore(lcore_id);
     }
+
+    // Workers are done producing, flush what is left in the log rings
+    _packet_logger.stop();
+
+    // Packets stranded between pipeline stages go back to their pools
+    _pipeline.print_report();
+    _pipeline.flush();
+
+    // Final counts of the generation that was active at shutdown
+    if (_config.rule_stats_enabled()) {
+        _packet_filter.write_rule_stats();
+        _packet_filter.print_rule_stats();
+    }
+
+    destroy_worker_contexts();
+}
+
+void dpdk_firewall::destroy_worker_contexts() {
+    for (auto& ctx : _workers) {
+        dpdk_worker_context::destroy(ctx);
+        ctx = nullptr;
+    }
 }
 
 int dpdk_firewall::run_loop_worker(void* arg) {
-    auto* self = static_cast<dpdk_firewall*>(arg);
-    const unsigned lcore_id = rte_lcore_id();
-    constexpr uint16_t burst_size = 32;
+    auto* ctx = static_cast<dpdk_worker_context*>(arg);
+    const dpdk_packet_filter& packet_filter = ctx->filter();
+    dpdk_packet_parser& packet_parser = ctx->parser();
+    WorkerCounters_t& counters = ctx->counters();
+    dpdk_log_sampler& log_sampler = ctx->log_sampler();
+
+    const unsigned lcore_id = ctx->lcore_id();
+    const int stats_slot = rte_lcore_index(static_cast<int>(lcore_id));
+    constexpr uint16_t burst_size = dpdk_worker_context::BURST_SIZE;
     rte_mbuf* bufs[burst_size];
-    rte_mbuf* tx_bufs[burst_size];
-    uint16_t tx_count = 0;
 
-    const uint16_t rx_queue_count = 2;
-    const uint16_t queue_id = lcore_id % rx_queue_count;
-    const uint16_t tx_queue_id = 0;
+    spdlog::info("Starting worker loop on lcore {} (socket {}) with RX queue {}, TX queue {}",
+                 lcore_id, ctx->socket_id(), ctx->rx_queue_id(), ctx->tx_queue_id());
+
+    packet_filter.register_reader(lcore_id);
+    packet_filter.reader_online(lcore_id);
+
+    dpdk_power_manager& power = ctx->power();
+    power.register_interrupt();
+    // Compiled out unless built with FASTDROP_STAGE_TIMING
+    dpdk_stage_timer& stage_timer = ctx->stage_timer();
+
+    // Flow cache aging work per poll, a little more when there is nothing else to do
+    constexpr uint32_t age_budget_busy = 32;
+    constexpr uint32_t age_budget_idle = 256;
 
-    spdlog::info("Starting worker loop on lcore {} with RX queue {}", lcore_id, queue_id);
+    while (ctx->is_running()) {
+        // Nothing from the previous burst references the rule set any more
+        packet_filter.reader_quiescent(lcore_id);
 
-    int empty_poll_counter = 0;
-    constexpr int sleep_threshold = 100;
-    while (rte_atomic32_read(&self->_running)) {
         // RX
-        const uint16_t nb_rx = rte_eth_rx_burst(self->_port_id, queue_id, bufs, burst_size);
+        const uint64_t burst_start = rte_rdtsc();
+        const uint16_t nb_rx = ctx->rx_burst(bufs, burst_size);
         if (nb_rx == 0) {
-            if (++empty_poll_counter >= sleep_threshold) {
-                std::this_thread::sleep_for(std::chrono::microseconds(100));
-                empty_poll_counter = 0;
-            } else {
-                rte_pause();
+            counters.empty_polls++;
+            ctx->flow_cache().age(burst_start, packet_filter.generation(), age_budget_idle);
+            ctx->frag_table().age(burst_start, age_budget_idle);
+            switch (power.on_empty_poll(burst_start)) {
+                case IdleState::SPIN:
+                    break;
+                case IdleState::PAUSE:
+                    rte_pause();
+                    break;
+                default:
+                    // Offline while sleeping so a reload never waits on an idle worker
+                    packet_filter.reader_offline(lcore_id);
+                    power.sleep();
+                    packet_filter.reader_online(lcore_id);
+                    break;
             }
             continue;
         }
 
-        empty_poll_counter = 0;
+        stage_timer.start(burst_start);
+        stage_timer.mark(WorkerStage::RX, nb_rx);
+        power.on_traffic(burst_start);
+
+        // Parse and classify the whole burst before touching individual packets
+        FlowKeyBurst_t& keys = ctx->flow_keys();
+        TunnelKeyBurst_t& tunnels = ctx->tunnel_keys();
+        uint32_t* results = ctx->match_results();
+        counters.ptype_parsed += packet_parser.parse_burst(bufs, nb_rx, keys, &tunnels);
+        stage_timer.mark(WorkerStage::PARSE, nb_rx);
+        const dpdk_rule_set* rule_set = packet_filter.active_rule_set();
+        RuleCounters_t* rule_counters = rule_set ? rule_set->rule_counters(stats_slot) : nullptr;
+        if (rule_set) {
+            counters.prefilter_skips += ctx->flow_cache().classify_burst(*rule_set, keys, results, burst_start);
+            // Outer headers are never cached, a tunnel's verdict also depends on its carrier
+            counters.prefilter_skips += rule_set->lookup_tunnels(tunnels, results);
+            // Later fragments inherit the verdict of their first fragment before policing
+            ctx->frag_table().apply_burst(keys, results, burst_start);
+            counters.rate_limit_evictions += ctx->rate_limiter().police_burst(*rule_set, bufs, keys, results, burst_start);
+            ctx->flow_cache().age(burst_start, rule_set->generation(), age_budget_busy);
+            ctx->frag_table().age(burst_start, age_budget_busy);
+        } else {
+            std::fill(results, results + nb_rx, dpdk_rule_classifier::NO_MATCH);
+        }
+        stage_timer.mark(WorkerStage::FILTER, nb_rx);
 
         for (uint16_t i = 0; i < nb_rx; i++) {
             rte_mbuf* pkt = bufs[i];
-            const uint8_t* pkt_data = rte_pktmbuf_mtod(pkt, const uint8_t*);
-            uint16_t pkt_len = rte_pktmbuf_pkt_len(pkt);
-
-            if (self->_packet_parser.parse(pkt_data, pkt_len)) {
-                uint32_t src_ip = self->_packet_parser.get_src_ip();
-                uint16_t src_port = self->_packet_parser.get_src_port();
-                bool is_tcp = self->_packet_parser.is_tcp();
-
-                if (self->_packet_filter.match(src_ip, src_port, is_tcp)) {
-                    tx_bufs[tx_count++] = pkt;
-
-                    if (tx_count == burst_size) {
-                        uint16_t nb_tx = rte_eth_tx_burst(self->_port_id, tx_queue_id, tx_bufs, tx_count);
+            counters.rx_bytes += rte_pktmbuf_pkt_len(pkt);
 
-                        uint32_t total_tx_bytes = 0;
-                        for (uint16_t j = 0; j < nb_tx; j++) {
-                            total_tx_bytes += rte_pktmbuf_pkt_len(tx_bufs[j]);
-                        }
-
-                        for (uint16_t j = nb_tx; j < tx_count; j++) {
-                            rte_pktmbuf_free(tx_bufs[j]);
-                            spdlog::warn("Packet TX failed (burst overflow), freed packet");
-                        }
-
-                        spdlog::info("TX burst: {} packets sent ({} bytes) on lcore {}", nb_tx, total_tx_bytes, lcore_id);
-                        tx_count = 0;
-                    }
-
-                    self->_packet_parser.print_packet_hex_ascii(pkt_data, pkt_len);
-                    self->_packet_parser.print_summary();
+            if (keys.status[i] != ParseStatus::OK) {
+                log_sampler.offer(LogReason::PARSE_FAILED, pkt, dpdk_rule_classifier::NO_MATCH, burst_start);
+                if (keys.status[i] == ParseStatus::BAD_CHECKSUM) {
+                    counters.checksum_drops++;
                 } else {
-                    spdlog::info("Packet blocked by filter: IP={} Port={}",
-                                 self->_packet_parser.ipv4_to_string(src_ip), src_port);
-                    rte_pktmbuf_free(pkt);
+                    counters.parse_failures++;
                 }
-            } else {
-                spdlog::warn("Failed to parse packet on lcore {}", lcore_id);
                 rte_pktmbuf_free(pkt);
+                continue;
             }
-        }
-
-        if (tx_count > 0) {
-            uint16_t nb_tx = rte_eth_tx_burst(self->_port_id, tx_queue_id, tx_bufs, tx_count);
 
-            uint32_t total_tx_bytes = 0;
-            for (uint16_t j = 0; j < nb_tx; j++) {
-                total_tx_bytes += rte_pktmbuf_pkt_len(tx_bufs[j]);
+            // Plain stores into this lcore's own array, merged by the control thread
+            if (rule_counters) {
+                rule_set->count_hit(rule_counters, results[i], rte_pktmbuf_pkt_len(pkt), burst_start);
             }
 
-            for (uint16_t j = nb_tx; j < tx_count; j++) {
-                rte_pktmbuf_free(tx_bufs[j]);
-                spdlog::warn("Packet TX failed (flush), freed packet");
+            // Sampled before the mbuf is handed on; formatting happens on the logging thread
+            if (dpdk_packet_filter::is_allowed(results[i])) {
+                log_sampler.offer(LogReason::ALLOWED, pkt, results[i], burst_start);
+                ctx->tx_enqueue(pkt);
+            } else if (dpdk_rule_classifier::action(results[i]) == RuleAction::RATE_EXCEEDED) {
+                log_sampler.offer(LogReason::RATE_LIMITED, pkt, results[i], burst_start);
+                counters.rate_limited++;
+                rte_pktmbuf_free(pkt);
+            } else {
+                log_sampler.offer(LogReason::BLOCKED, pkt, results[i], burst_start);
+                ctx->drop(pkt);
             }
-
-            spdlog::info("TX flush: {} packets sent ({} bytes) on lcore {}", nb_tx, total_tx_bytes, lcore_id);
-            tx_count = 0;
         }
+
+        stage_timer.mark(WorkerStage::VERDICT, nb_rx);
+
+        ctx->tx_flush();
+        stage_timer.mark(WorkerStage::TX, nb_rx);
+        counters.busy_cycles += rte_rdtsc() - burst_start;
     }
 
+    ctx->tx_flush();
+    packet_filter.reader_offline(lcore_id);
+    packet_filter.unregister_reader(lcore_id);
+    power.print_report(lcore_id);
+    stage_timer.print_report(lcore_id);
     spdlog::info("Worker loop on lcore {} exiting", lcore_id);
     return 0;
 }
 
 void dpdk_firewall::launch_workers() {
-    unsigned lcore_id;
+    if (!is_initialized()) {
+        return;
+    }
+
+    const PowerPolicy_t power_policy = build_power_policy();
+    PacketLogPolicy_t log_policy{};
+    if (!build_packet_log_policy(log_policy)) {
+        spdlog::warn("Packet logging disabled");
+    }
+
+    // Contexts are created on the control thread but placed on each lcore's own socket.
+    // Queue pair i belongs to worker i alone, so RX and TX need no locking.
+    // Pipeline classifiers own no queue, they exchange packets with the stages through rings.
+    const bool pipeline = _pipeline.enabled();
+    const std::vector<unsigned>& lcores = pipeline ? _pipeline.classifier_lcores() : _worker_lcores;
+    const size_t worker_count = pipeline ? lcores.size() : std::min<size_t>(lcores.size(), _rx_queue_count);
+    for (size_t i = 0; i < worker_count; i++) {
+        const unsigned lcore_id = lcores[i];
+        const auto queue_id = static_cast<uint16_t>(pipeline ? 0 : i);
+        _workers[lcore_id] = dpdk_worker_context::create(lcore_id, _port_id, queue_id, queue_id,
+                                                         &_packet_filter, &_running);
+        if (!_workers[lcore_id]) {
+            continue;
+        }
 
+        dpdk_worker_context* ctx = _workers[lcore_id];
+        if (pipeline) {
+            _pipeline.attach(*ctx, i);
+        }
+        ctx->parser().set_decapsulate(_config.decapsulate());
+        ctx->parser().set_rx_metadata(_rx_ptype, _rx_checksum);
+        if (!ctx->rate_limiter().init(_config.rate_limit_entries(), ctx->socket_id())) {
+            spdlog::warn("Rate limiting disabled on lcore {}, rate_limit rules pass unpoliced", lcore_id);
+        }
+
+        const uint64_t idle_cycles = rte_get_tsc_hz() / 1000 * _config.flow_cache_idle_ms();
+        if (!ctx->flow_cache().init("flow_cache_" + std::to_string(lcore_id), _config.flow_cache_entries(),
+                                    idle_cycles, ctx->socket_id())) {
+            spdlog::warn("Flow cache disabled on lcore {}, every packet takes the full rule lookup", lcore_id);
+        }
+
+        const uint64_t frag_timeout = rte_get_tsc_hz() / 1000 * _config.fragment_timeout_ms();
+        if (!ctx->frag_table().init("frag_table_" + std::to_string(lcore_id), _config.fragment_entries(),
+                                    frag_timeout, ctx->socket_id())) {
+            spdlog::warn("Fragment tracking disabled on lcore {}, later fragments match on addresses only", lcore_id);
+        }
+
+        ctx->power().init(_port_id, ctx->rx_queue_id(), power_policy, _rx_interrupts && !pipeline, rte_get_tsc_hz());
+
+        if (log_policy.sample_rate) {
+            rte_ring* ring = _packet_logger.create_ring(lcore_id, _config.packet_log_ring_size(), ctx->socket_id());
+            ctx->log_sampler().attach(ring, log_policy, rte_get_tsc_hz());
+        }
+    }
+
+    if (log_policy.sample_rate) {
+        _packet_logger.start();
+    }
+
+    if (pipeline) {
+        _pipeline.launch(_port_id, &_running);
+    }
+
+    unsigned lcore_id;
     RTE_LCORE_FOREACH_WORKER(lcore_id) {
-        rte_eal_remote_launch(dpdk_firewall::run_loop_worker, this, lcore_id);
+        if (_workers[lcore_id]) {
+            rte_eal_remote_launch(dpdk_firewall::run_loop_worker, _workers[lcore_id], lcore_id);
+        }
     }
-}
\ No newline at end of file
+}
@@ -3,28 +3,48 @@
 
 #pragma once
 
+#include <array>
 #include <fstream>
 #include <memory>
+#include <vector>
 #include <rte_atomic.h>
 #include <rte_ethdev.h>
 #include <spdlog/spdlog.h>
 
+#include "dpdk_agent_config.h"
+#include "dpdk_flow_offload.h"
+#include "dpdk_metrics_exporter.h"
+#include "dpdk_packet_logger.h"
 #include "dpdk_packet_parser.h"
 #include "dpdk_packet_filter.h"
+#include "dpdk_pipeline.h"
+#include "dpdk_worker_context.h"
 
 class dpdk_firewall : public std::enable_shared_from_this<dpdk_firewall> {
 public:
-    explicit dpdk_firewall();
+    explicit dpdk_firewall(const dpdk_agent_config& config);
     virtual ~dpdk_firewall();
 
     bool is_initialized() const;
     void launch_workers();
     void stop_workers();
+    void publish_metrics();
+    bool rules_changed() const;
+    bool reload_rules();
 
 private:
     bool find_and_validate_port();
-    bool create_mbuf_pool();
-    bool configure_and_start_port() const;
+    bool plan_queues();
+    bool create_mbuf_pools();
+    void print_mbuf_pool_report() const;
+    int queue_socket_id(const std::vector<unsigned>& queue_lcores, uint16_t queue_id) const;
+    bool configure_and_start_port();
+    bool build_rss_conf(const rte_eth_dev_info& dev_info, rte_eth_rss_conf& rss_conf);
+    void build_rss_key(size_t key_len);
+    bool configure_ptypes();
+    void apply_flow_offload();
+    bool build_packet_log_policy(PacketLogPolicy_t& policy) const;
+    PowerPolicy_t build_power_policy() const;
     static bool initialize_eal();
     static bool is_root();
     static bool is_hugepages_mounted();
@@ -34,21 +54,50 @@ private:
     static bool ensure_dpdk_environment();
     static bool mount_hugepages();
 
+    void destroy_worker_contexts();
+
     static int run_loop_worker(void* arg);
 
 private:
-    dpdk_packet_parser _packet_parser;
+    dpdk_agent_config _config;
+
+    // Shared read-only by all workers once loaded
     dpdk_packet_filter _packet_filter;
+    // NIC-side DROP rules mirroring the offloadable part of the active set
+    dpdk_flow_offload _flow_offload;
+
+    // RX/TX stage lcores and rings when the pipeline topology is selected
+    dpdk_pipeline _pipeline;
+
+    // Indexed by lcore id, owned here and touched only by that lcore while running
+    std::array<dpdk_worker_context*, RTE_MAX_LCORE> _workers;
+    dpdk_metrics_exporter _metrics_exporter;
+    // Formats the packets the workers sample, on its own thread
+    dpdk_packet_logger _packet_logger;
 
     rte_atomic32_t _running;
-    rte_mempool* _mem_buf_pool;
+    // One pool per NUMA socket that hosts a worker, indexed by socket id
+    std::array<rte_mempool*, RTE_MAX_NUMA_NODES> _mem_buf_pools;
 
     std::string _mem_buf_pool_name;
-    uint16_t _mem_buf_pool_size;
     uint16_t _mem_buf_pool_cache_size;
     uint16_t _mem_buf_pool_data_size;
 
+    std::vector<unsigned> _worker_lcores;   // worker i polls RX queue i and owns TX queue i
+    std::vector<unsigned> _rx_queue_lcores; // lcore polling RX queue q (the RX stage in pipeline mode)
+    std::vector<unsigned> _tx_queue_lcores; // lcore sending on TX queue q (the TX stage in pipeline mode)
+    std::vector<uint8_t> _rss_key;
+    rte_eth_dev_info _dev_info;
+    uint16_t _rx_queue_count;
+    uint16_t _tx_queue_count;
+    uint16_t _rx_ring_size;
+    uint16_t _tx_ring_size;
+
     uint16_t _port_id;
+    uint64_t _rule_stats_next_tsc;          // next rule stats report, control thread only
+    bool _rx_interrupts;                    // port configured with intr_conf.rxq
+    bool _rx_ptype;                         // PMD reports L2/L3/L4 packet types
+    bool _rx_checksum;                      // PMD validates checksums into ol_flags
     bool _initialized;
 };
 
@@ -0,0 +1,180 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FLAT_HASH_H
+#define DPDK_FASTDROP_AGENT_DPDK_FLAT_HASH_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 64-bit finalizer (murmur3 fmix64), good avalanche for packed integer keys
+struct dpdk_flat_hash_mix {
+    uint64_t operator()(uint64_t key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+};
+
+// Open-addressing (linear probing) table mapping a key to a uint32_t value.
+// Built once on the control path, then read-only on the datapath.
+// Load factor is kept <= 0.5 so a miss usually ends within the first cache line.
+// The slot array can also be attached read-only from memory the caller keeps alive.
+template<typename Key, typename Hash = dpdk_flat_hash_mix>
+class dpdk_flat_hash {
+public:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    explicit dpdk_flat_hash()
+        : _table(nullptr)
+        , _mask(0)
+        , _size(0) {
+    }
+
+    void clear() {
+        _slots.clear();
+        _table = nullptr;
+        _mask = 0;
+        _size = 0;
+    }
+
+    void reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity < count * 2) {
+            capacity <<= 1;
+        }
+        if (capacity > _slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Keeps the smallest value per key, so inserting in rule order preserves first-match
+    void insert_min(const Key& key, uint32_t value) {
+        if ((_size + 1) * 2 > _slots.size()) {
+            rehash(_slots.empty() ? 16 : _slots.size() * 2);
+        }
+
+        size_t idx = Hash{}(key) & _mask;
+        while (_slots[idx].value != EMPTY) {
+            if (_slots[idx].key == key) {
+                if (value < _slots[idx].value) {
+                    _slots[idx].value = value;
+                }
+                return;
+            }
+            idx = (idx + 1) & _mask;
+        }
+        _slots[idx].key = key;
+        _slots[idx].value = value;
+        ++_size;
+    }
+
+    uint32_t lookup(const Key& key) const {
+        if (_size == 0) {
+            return EMPTY;
+        }
+
+        size_t idx = Hash{}(key) & _mask;
+        while (_table[idx].value != EMPTY) {
+            if (_table[idx].key == key) {
+                return _table[idx].value;
+            }
+            idx = (idx + 1) & _mask;
+        }
+        return EMPTY;
+    }
+
+    void prefetch(const Key& key) const {
+        if (_size != 0) {
+            __builtin_prefetch(&_table[Hash{}(key) & _mask]);
+        }
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t memory_bytes() const {
+        return _table ? (_mask + 1) * sizeof(Slot_t) : 0;
+    }
+
+    // Control path only, visits every stored key
+    template<typename Fn>
+    void for_each_key(Fn&& fn) const {
+        for (size_t i = 0; _table && i <= _mask; i++) {
+            if (_table[i].value != EMPTY) {
+                fn(_table[i].key);
+            }
+        }
+    }
+
+    // Raw slot array, slot_size() bytes per slot, for serializing the table as one block
+    const void* slots() const {
+        return _table;
+    }
+
+    size_t capacity() const {
+        return _table ? _mask + 1 : 0;
+    }
+
+    static constexpr size_t slot_size() {
+        return sizeof(Slot_t);
+    }
+
+    // Serves lookups straight from a slot array written out from slots(); insert_min must not follow
+    bool attach(const void* slots, size_t capacity, size_t size) {
+        clear();
+        if (!slots || (capacity & (capacity - 1)) || size * 2 > capacity) {
+            return false;
+        }
+        if (capacity > 0) {
+            _table = static_cast<const Slot_t*>(slots);
+            _mask = capacity - 1;
+            _size = size;
+        }
+        return true;
+    }
+
+    // True when check() accepts every stored value, for validating an attached table
+    template<typename Check>
+    bool all_values(Check check) const {
+        for (size_t i = 0; _table && i <= _mask; i++) {
+            if (_table[i].value != EMPTY && !check(_table[i].value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    typedef struct Slot {
+        Key key;
+        uint32_t value = EMPTY;
+    } Slot_t;
+
+    void rehash(size_t capacity) {
+        std::vector<Slot_t> old;
+        old.swap(_slots);
+
+        _slots.assign(capacity, Slot_t{});
+        _table = _slots.data();
+        _mask = capacity - 1;
+        _size = 0;
+
+        for (const auto& slot : old) {
+            if (slot.value != EMPTY) {
+                insert_min(slot.key, slot.value);
+            }
+        }
+    }
+
+    std::vector<Slot_t> _slots;
+    const Slot_t* _table;   // _slots, or the slot array of an attached snapshot
+    size_t _mask;
+    size_t _size;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FLAT_HASH_H
@@ -0,0 +1,208 @@
+#include "dpdk_flow_cache.h"
+
+#include <cstring>
+#include <rte_errno.h>
+#include <rte_hash_crc.h>
+#include <rte_malloc.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk_rule_set.h"
+
+dpdk_flow_cache::dpdk_flow_cache()
+    : _hash(nullptr)
+    , _entries(nullptr)
+    , _idle_cycles(0)
+    , _capacity(0)
+    , _age_cursor(0)
+    , _stats{}
+    , _tuples{}
+    , _miss_keys{}
+    , _miss_results{}
+    , _miss_index{} {
+
+}
+
+dpdk_flow_cache::~dpdk_flow_cache() {
+    if (_hash) {
+        rte_hash_free(_hash);
+        _hash = nullptr;
+    }
+    rte_free(_entries);
+    _entries = nullptr;
+}
+
+bool dpdk_flow_cache::init(const std::string& name, uint32_t entries, uint64_t idle_cycles, int socket_id) {
+    if (entries == 0) {
+        return true;
+    }
+
+    // Single writer (the owning lcore), so no locking or lock-free flags
+    rte_hash_parameters params{};
+    params.name = name.c_str();
+    params.entries = entries;
+    params.key_len = sizeof(FlowTuple_t);
+    params.hash_func = rte_hash_crc;
+    params.hash_func_init_val = 0;
+    params.socket_id = socket_id;
+
+    _hash = rte_hash_create(&params);
+    if (!_hash) {
+        spdlog::error("Failed to create flow cache {} ({} entries): {}", name, entries, rte_strerror(rte_errno));
+        return false;
+    }
+
+    // Key positions returned by rte_hash are < entries without the multi-writer flag
+    _entries = static_cast<FlowEntry_t*>(
+            rte_zmalloc_socket("flow_cache_entries", sizeof(FlowEntry_t) * entries, RTE_CACHE_LINE_SIZE, socket_id));
+    if (!_entries) {
+        spdlog::error("Failed to allocate flow cache {} entries on socket {}", name, socket_id);
+        rte_hash_free(_hash);
+        _hash = nullptr;
+        return false;
+    }
+
+    _capacity = entries;
+    _idle_cycles = idle_cycles;
+    return true;
+}
+
+void dpdk_flow_cache::make_tuple(const FlowKeyBurst_t& keys, uint16_t idx, FlowTuple_t& tuple) {
+    std::memset(&tuple, 0, sizeof(tuple));
+    tuple.src_addr = keys.src_addr[idx];
+    tuple.dst_addr = keys.dst_addr[idx];
+    tuple.src_port = keys.src_port[idx];
+    tuple.dst_port = keys.dst_port[idx];
+    tuple.proto = keys.proto[idx];
+    tuple.family = keys.family[idx];
+    tuple.vlan = keys.vlan[idx];
+    tuple.vni = keys.vni[idx];
+}
+
+uint16_t dpdk_flow_cache::classify_burst(const dpdk_rule_set& rule_set, const FlowKeyBurst_t& keys, uint32_t* results,
+                                         uint64_t now) {
+    if (!_hash) {
+        return rule_set.lookup_burst(keys, results);
+    }
+
+    const auto generation = static_cast<uint32_t>(rule_set.generation());
+    const void* lookup_keys[FLOW_KEY_BURST_MAX];
+    uint16_t lookup_index[FLOW_KEY_BURST_MAX];
+    int32_t positions[FLOW_KEY_BURST_MAX];
+    uint32_t lookups = 0;
+
+    auto add_miss = [this, &keys](uint16_t i) {
+        const uint16_t m = _miss_keys.count++;
+        _miss_keys.status[m] = keys.status[i];
+        _miss_keys.family[m] = keys.family[i];
+        _miss_keys.proto[m] = keys.proto[i];
+        _miss_keys.tcp_flags[m] = keys.tcp_flags[i];
+        _miss_keys.fragment[m] = keys.fragment[i];
+        _miss_keys.frag_id[m] = keys.frag_id[i];
+        _miss_keys.src_port[m] = keys.src_port[i];
+        _miss_keys.dst_port[m] = keys.dst_port[i];
+        _miss_keys.src_addr[m] = keys.src_addr[i];
+        _miss_keys.dst_addr[m] = keys.dst_addr[i];
+        _miss_keys.vlan[m] = keys.vlan[i];
+        _miss_keys.vni[m] = keys.vni[i];
+        _miss_index[m] = i;
+    };
+
+    // Unparsed and non-IP packets always take the full path, and so do later fragments:
+    // without ports they have no flow to key on, the fragment table supplies their verdict
+    _miss_keys.count = 0;
+    for (uint16_t i = 0; i < keys.count; i++) {
+        if (is_cacheable(keys, i)) {
+            make_tuple(keys, i, _tuples[i]);
+            lookup_keys[lookups] = &_tuples[i];
+            lookup_index[lookups++] = i;
+        } else {
+            add_miss(i);
+        }
+    }
+
+    if (lookups > 0) {
+        rte_hash_lookup_bulk(_hash, lookup_keys, lookups, positions);
+    }
+
+    for (uint32_t j = 0; j < lookups; j++) {
+        const uint16_t i = lookup_index[j];
+        const int32_t pos = positions[j];
+        if (pos < 0 || _entries[pos].generation != generation) {
+            add_miss(i);
+            continue;
+        }
+
+        _stats.hits++;
+        results[i] = _entries[pos].result;
+        if (keys.tcp_flags[i] & (TCP_FIN | TCP_RST)) {
+            rte_hash_del_key(_hash, &_tuples[i]);
+            _entries[pos] = FlowEntry_t{};
+            _stats.closed++;
+        } else {
+            _entries[pos].last_seen = now;
+        }
+    }
+
+    if (_miss_keys.count == 0) {
+        return 0;
+    }
+
+    const uint16_t prefilter_skips = rule_set.lookup_burst(_miss_keys, _miss_results);
+    for (uint16_t m = 0; m < _miss_keys.count; m++) {
+        const uint16_t i = _miss_index[m];
+        results[i] = _miss_results[m];
+        if (!is_cacheable(keys, i)) {
+            continue;
+        }
+
+        _stats.misses++;
+        if (keys.tcp_flags[i] & (TCP_FIN | TCP_RST)) {
+            continue;
+        }
+
+        const int32_t pos = rte_hash_add_key(_hash, &_tuples[i]);
+        if (pos < 0) {
+            _stats.full++;
+            continue;
+        }
+        _entries[pos] = FlowEntry_t{ _miss_results[m], generation, now };
+    }
+    return prefilter_skips;
+}
+
+void dpdk_flow_cache::age(uint64_t now, uint64_t generation, uint32_t budget) {
+    if (!_hash) {
+        return;
+    }
+
+    // Walk the entry array, not the hash buckets, so the work per call is fixed
+    for (uint32_t k = 0; k < budget; k++) {
+        const uint32_t pos = _age_cursor;
+        _age_cursor = _age_cursor + 1 < _capacity ? _age_cursor + 1 : 0;
+
+        FlowEntry_t& entry = _entries[pos];
+        if (entry.last_seen == 0) {
+            continue;
+        }
+        if (entry.generation == static_cast<uint32_t>(generation) && now - entry.last_seen <= _idle_cycles) {
+            continue;
+        }
+
+        void* key = nullptr;
+        if (rte_hash_get_key_with_position(_hash, static_cast<int32_t>(pos), &key) == 0) {
+            FlowTuple_t tuple;
+            std::memcpy(&tuple, key, sizeof(tuple));
+            rte_hash_del_key(_hash, &tuple);
+        }
+        entry = FlowEntry_t{};
+        _stats.expired++;
+    }
+}
+
+const FlowCacheStats_t& dpdk_flow_cache::stats() const {
+    return _stats;
+}
+
+uint32_t dpdk_flow_cache::size() const {
+    return _hash ? static_cast<uint32_t>(rte_hash_count(_hash)) : 0;
+}
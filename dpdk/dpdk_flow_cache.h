@@ -0,0 +1,85 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FLOW_CACHE_H
+#define DPDK_FASTDROP_AGENT_DPDK_FLOW_CACHE_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <rte_hash.h>
+
+#include "dpdk_flow_key.h"
+
+class dpdk_rule_set;
+
+typedef struct FlowCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expired;       // aged out, or left over from an older rule set
+    uint64_t closed;        // removed early on TCP FIN/RST
+    uint64_t full;          // not cached because the table was full
+} FlowCacheStats_t;
+
+// Per-lcore cache of classifier results for established flows, keyed by 5-tuple.
+// A hit costs one bulk cuckoo lookup instead of the full rule evaluation; misses are
+// compacted into a second burst, classified together and inserted.
+// Entries remember the rule set generation they were computed under, so a reload
+// invalidates everything at once without touching the table. Idle and stale entries
+// are reclaimed a bounded number per poll, and TCP FIN/RST removes a flow early.
+// The cached value is the raw classifier result: rate limiting still runs per packet.
+class dpdk_flow_cache {
+public:
+    explicit dpdk_flow_cache();
+    virtual ~dpdk_flow_cache();
+
+    bool init(const std::string& name, uint32_t entries, uint64_t idle_cycles, int socket_id);
+    // Returns the rule set's pre-filter skips for the misses
+    uint16_t classify_burst(const dpdk_rule_set& rule_set, const FlowKeyBurst_t& keys, uint32_t* results, uint64_t now);
+    void age(uint64_t now, uint64_t generation, uint32_t budget);
+
+    const FlowCacheStats_t& stats() const;
+    uint32_t size() const;
+
+private:
+    static constexpr uint8_t TCP_FIN = 0x01;
+    static constexpr uint8_t TCP_RST = 0x04;
+
+    // Hashed as raw bytes, so always built from a zeroed value
+    typedef struct FlowTuple {
+        IpAddr_t src_addr;
+        IpAddr_t dst_addr;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint8_t proto;
+        NetworkProtocol family;
+        uint16_t vlan;
+        uint32_t vni;
+    } FlowTuple_t;
+
+    typedef struct FlowEntry {
+        uint32_t result;
+        uint32_t generation;
+        uint64_t last_seen;     // TSC
+    } FlowEntry_t;
+
+    static void make_tuple(const FlowKeyBurst_t& keys, uint16_t idx, FlowTuple_t& tuple);
+
+    static inline bool is_cacheable(const FlowKeyBurst_t& keys, uint16_t idx) {
+        return keys.status[idx] == ParseStatus::OK && keys.family[idx] != NetworkProtocol::NONE &&
+               keys.fragment[idx] != FragmentType::LATER;
+    }
+
+    rte_hash* _hash;
+    FlowEntry_t* _entries;      // indexed by rte_hash key position
+    uint64_t _idle_cycles;
+    uint32_t _capacity;
+    uint32_t _age_cursor;
+    FlowCacheStats_t _stats;
+
+    // Scratch for the misses of one burst
+    FlowTuple_t _tuples[FLOW_KEY_BURST_MAX];
+    FlowKeyBurst_t _miss_keys;
+    uint32_t _miss_results[FLOW_KEY_BURST_MAX];
+    uint16_t _miss_index[FLOW_KEY_BURST_MAX];
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FLOW_CACHE_H
@@ -0,0 +1,139 @@
+#include "dpdk_flow_distributor.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+#include <rte_hash_crc.h>
+#include <rte_thash.h>
+#include <spdlog/spdlog.h>
+
+dpdk_flow_distributor::dpdk_flow_distributor()
+    : _hash(FlowHash::TOEPLITZ)
+    , _reta{}
+    , _keys{} {
+
+}
+
+dpdk_flow_distributor::~dpdk_flow_distributor() {
+
+}
+
+bool dpdk_flow_distributor::parse_hash(const std::string& name, FlowHash& hash) {
+    if (name == "toeplitz") {
+        hash = FlowHash::TOEPLITZ;
+    } else if (name == "crc32") {
+        hash = FlowHash::CRC32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_flow_distributor::init(FlowHash hash, const std::vector<uint8_t>& rss_key, const std::vector<rte_ring*>& rings,
+                                 bool decapsulate) {
+    if (rings.empty()) {
+        spdlog::error("Flow distribution needs at least one target ring");
+        return false;
+    }
+
+    _hash = hash;
+    if (_hash == FlowHash::TOEPLITZ) {
+        // rte_softrss_be reads one key word past the tuple
+        constexpr size_t min_key_len = (RTE_THASH_V6_L4_LEN + 1) * sizeof(uint32_t);
+        if (rss_key.size() < min_key_len) {
+            spdlog::warn("RSS key of {} bytes is too short for software Toeplitz, distributing by CRC32",
+                         rss_key.size());
+            _hash = FlowHash::CRC32;
+        } else {
+            std::vector<uint32_t> key_words(rss_key.size() / sizeof(uint32_t));
+            std::memcpy(key_words.data(), rss_key.data(), key_words.size() * sizeof(uint32_t));
+            _rss_key_be.resize(key_words.size());
+            rte_convert_rss_key(key_words.data(), _rss_key_be.data(), static_cast<int>(key_words.size() * sizeof(uint32_t)));
+        }
+    }
+
+    _packet_parser.set_decapsulate(decapsulate);
+    _rings = rings;
+    for (uint16_t i = 0; i < RETA_SIZE; i++) {
+        _reta[i] = static_cast<uint16_t>(i % _rings.size());
+    }
+
+    _buckets.assign(_rings.size() * FLOW_KEY_BURST_MAX, nullptr);
+    _bucket_counts.assign(_rings.size(), 0);
+    _stats.assign(_rings.size(), DistributionStats_t{});
+    return true;
+}
+
+uint32_t dpdk_flow_distributor::toeplitz(const FlowKeyBurst_t& keys, uint16_t idx) const {
+    // Host order words laid out like rte_ipv4_tuple / rte_ipv6_tuple
+    uint32_t tuple[RTE_THASH_V6_L4_LEN];
+    uint32_t len;
+    // Fragments hash on L3 only, like a NIC does, so a datagram's first and later fragments meet
+    const bool has_ports = (keys.proto[idx] == 6 || keys.proto[idx] == 17) && keys.fragment[idx] == FragmentType::NONE;
+
+    if (keys.family[idx] == NetworkProtocol::IPv4) {
+        tuple[0] = ntohl(keys.src_addr[idx].v4);
+        tuple[1] = ntohl(keys.dst_addr[idx].v4);
+        tuple[2] = static_cast<uint32_t>(keys.src_port[idx]) << 16 | keys.dst_port[idx];
+        len = has_ports ? RTE_THASH_V4_L4_LEN : RTE_THASH_V4_L3_LEN;
+    } else {
+        for (size_t w = 0; w < 4; w++) {
+            uint32_t src;
+            uint32_t dst;
+            std::memcpy(&src, &keys.src_addr[idx].v6[w * 4], sizeof(src));
+            std::memcpy(&dst, &keys.dst_addr[idx].v6[w * 4], sizeof(dst));
+            tuple[w] = ntohl(src);
+            tuple[4 + w] = ntohl(dst);
+        }
+        tuple[8] = static_cast<uint32_t>(keys.src_port[idx]) << 16 | keys.dst_port[idx];
+        len = has_ports ? RTE_THASH_V6_L4_LEN : RTE_THASH_V6_L3_LEN;
+    }
+    return rte_softrss_be(tuple, len, reinterpret_cast<const uint8_t*>(_rss_key_be.data()));
+}
+
+uint32_t dpdk_flow_distributor::crc32(const FlowKeyBurst_t& keys, uint16_t idx) {
+    // IPv4 addresses are zero padded, so both families hash the full 16 bytes.
+    // Fragments leave the ports out, so all fragments of a datagram go to one target.
+    const uint32_t ports = keys.fragment[idx] == FragmentType::NONE
+            ? static_cast<uint32_t>(keys.src_port[idx]) << 16 | keys.dst_port[idx] : 0;
+    uint32_t value = rte_hash_crc(&keys.src_addr[idx], sizeof(IpAddr_t), keys.proto[idx]);
+    value = rte_hash_crc(&keys.dst_addr[idx], sizeof(IpAddr_t), value);
+    return rte_hash_crc(&ports, sizeof(ports), value);
+}
+
+uint32_t dpdk_flow_distributor::hash(const FlowKeyBurst_t& keys, uint16_t idx) const {
+    // Non-IP and unparsable packets all go to the first target, the classifier drops or passes them
+    if (keys.family[idx] == NetworkProtocol::NONE) {
+        return 0;
+    }
+    return _hash == FlowHash::TOEPLITZ ? toeplitz(keys, idx) : crc32(keys, idx);
+}
+
+void dpdk_flow_distributor::distribute(rte_mbuf* const* pkts, uint16_t count) {
+    _packet_parser.parse_burst(pkts, count, _keys);
+
+    for (uint16_t i = 0; i < count; i++) {
+        const uint16_t target = _reta[hash(_keys, i) & (RETA_SIZE - 1)];
+        _buckets[target * FLOW_KEY_BURST_MAX + _bucket_counts[target]++] = pkts[i];
+    }
+
+    for (size_t target = 0; target < _rings.size(); target++) {
+        const uint16_t pending = _bucket_counts[target];
+        if (pending == 0) {
+            continue;
+        }
+        _bucket_counts[target] = 0;
+
+        rte_mbuf** bucket = &_buckets[target * FLOW_KEY_BURST_MAX];
+        const unsigned enqueued = rte_ring_enqueue_burst(_rings[target], reinterpret_cast<void* const*>(bucket),
+                                                         pending, nullptr);
+        _stats[target].packets += enqueued;
+        if (unlikely(enqueued < pending)) {
+            rte_pktmbuf_free_bulk(&bucket[enqueued], pending - enqueued);
+            _stats[target].ring_full_drops += pending - enqueued;
+        }
+    }
+}
+
+const std::vector<DistributionStats_t>& dpdk_flow_distributor::stats() const {
+    return _stats;
+}
@@ -0,0 +1,65 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FLOW_DISTRIBUTOR_H
+#define DPDK_FASTDROP_AGENT_DPDK_FLOW_DISTRIBUTOR_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+
+#include "dpdk_flow_key.h"
+#include "dpdk_packet_parser.h"
+
+enum class FlowHash : uint8_t {
+    TOEPLITZ,   // software RSS with the port's key, the same function the NIC would run
+    CRC32       // rte_hash_crc over the 5-tuple, cheaper but direction dependent
+};
+
+typedef struct DistributionStats {
+    uint64_t packets;           // handed to this target's ring
+    uint64_t ring_full_drops;   // freed because the target fell behind
+} DistributionStats_t;
+
+// Software RSS for ports whose RSS is missing or uneven (TAP and other vdevs, some VFs).
+// Runs on a pipeline RX lcore: parses the 5-tuple of each packet, hashes it and spreads
+// the burst over one ring per classifier through an indirection table, like a NIC would.
+// A flow always lands on the same classifier, so the flow cache and rate limiter state
+// stay core-local. With the default symmetric key both directions of a flow hash alike.
+// Tunnelled packets hash on the same inner 5-tuple the classifier matches on.
+class dpdk_flow_distributor {
+public:
+    static constexpr uint16_t RETA_SIZE = 128;
+
+    explicit dpdk_flow_distributor();
+    virtual ~dpdk_flow_distributor();
+
+    static bool parse_hash(const std::string& name, FlowHash& hash);
+
+    // rss_key must cover an IPv6 5-tuple (40 bytes) for Toeplitz; shorter keys fall back to CRC32
+    bool init(FlowHash hash, const std::vector<uint8_t>& rss_key, const std::vector<rte_ring*>& rings, bool decapsulate);
+    // Takes ownership of all count (at most FLOW_KEY_BURST_MAX) packets: enqueued to their target ring or freed
+    void distribute(rte_mbuf* const* pkts, uint16_t count);
+
+    const std::vector<DistributionStats_t>& stats() const;
+
+private:
+    uint32_t hash(const FlowKeyBurst_t& keys, uint16_t idx) const;
+    uint32_t toeplitz(const FlowKeyBurst_t& keys, uint16_t idx) const;
+    static uint32_t crc32(const FlowKeyBurst_t& keys, uint16_t idx);
+
+    FlowHash _hash;
+    std::vector<uint32_t> _rss_key_be;  // converted once for rte_softrss_be
+    std::vector<rte_ring*> _rings;
+    uint16_t _reta[RETA_SIZE];
+
+    dpdk_packet_parser _packet_parser;
+    FlowKeyBurst_t _keys;
+    // FLOW_KEY_BURST_MAX slots per target, filled per burst then enqueued in one go
+    std::vector<rte_mbuf*> _buckets;
+    std::vector<uint16_t> _bucket_counts;
+    std::vector<DistributionStats_t> _stats;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FLOW_DISTRIBUTOR_H
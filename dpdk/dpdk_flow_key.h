@@ -0,0 +1,87 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FLOW_KEY_H
+#define DPDK_FASTDROP_AGENT_DPDK_FLOW_KEY_H
+
+#pragma once
+
+#include <cstdint>
+
+// Maximum number of packets handled by one parse_burst / classify_burst call
+constexpr uint16_t FLOW_KEY_BURST_MAX = 64;
+
+enum class NetworkProtocol : uint8_t {
+    NONE,
+    IPv4,
+    IPv6
+};
+
+enum class ParseStatus : uint8_t {
+    OK = 0,
+    TRUNCATED,
+    MALFORMED,
+    BAD_CHECKSUM    // the NIC flagged an IP or L4 checksum error, nothing was parsed
+};
+
+// Position of a packet within a fragmented IP datagram
+enum class FragmentType : uint8_t {
+    NONE = 0,   // not fragmented (or an IPv6 atomic fragment)
+    FIRST,      // offset 0 with more fragments: carries the L4 header
+    LATER       // non-zero offset: payload only, ports are left 0
+};
+
+// Address in network byte order. IPv4 uses v4 and leaves the rest zeroed.
+typedef union IpAddr {
+    uint32_t v4;
+    uint8_t  v6[16];
+    uint64_t u64[2];
+} IpAddr_t;
+
+// Set in vlan / vni when the packet carried a tag / tunnel, so a scoped rule for VLAN 0 or
+// VNI 0 never matches untagged or untunnelled traffic
+constexpr uint16_t FLOW_KEY_VLAN_PRESENT = 0x1000;
+constexpr uint32_t FLOW_KEY_VNI_PRESENT = 1u << 24;
+
+// Structure-of-arrays of compact flow keys for one rx burst.
+// proto is the IP protocol number, ports are host order (0 when there is no L4 header).
+// frag_id is the IPv4 identification or IPv6 fragment header id, valid when fragment != NONE.
+// Tunnelled packets carry the innermost 5-tuple (the outer ones go to a TunnelKeyBurst); vlan is the outermost VLAN ID and vni the
+// innermost VXLAN/Geneve VNI or NVGRE VSID, each with its PRESENT bit, 0 when absent.
+typedef struct FlowKeyBurst {
+    uint16_t        count;
+    ParseStatus     status[FLOW_KEY_BURST_MAX];
+    NetworkProtocol family[FLOW_KEY_BURST_MAX];
+    uint8_t         proto[FLOW_KEY_BURST_MAX];
+    uint8_t         tcp_flags[FLOW_KEY_BURST_MAX];
+    FragmentType    fragment[FLOW_KEY_BURST_MAX];
+    uint32_t        frag_id[FLOW_KEY_BURST_MAX];
+    uint16_t        src_port[FLOW_KEY_BURST_MAX];
+    uint16_t        dst_port[FLOW_KEY_BURST_MAX];
+    IpAddr_t        src_addr[FLOW_KEY_BURST_MAX];
+    IpAddr_t        dst_addr[FLOW_KEY_BURST_MAX];
+    uint16_t        vlan[FLOW_KEY_BURST_MAX];
+    uint32_t        vni[FLOW_KEY_BURST_MAX];
+} FlowKeyBurst_t;
+
+// Outer headers of the tunnels parse_burst stepped into, compacted: keys slot i holds the
+// headers that carried burst packet packet[i] (one slot per tunnel level). Classified next
+// to the inner tuple, so wrapping traffic in a tunnel does not hide its outer addresses.
+typedef struct TunnelKeyBurst {
+    FlowKeyBurst_t keys;
+    uint8_t        packet[FLOW_KEY_BURST_MAX];
+} TunnelKeyBurst_t;
+
+static inline void copy_flow_key(const FlowKeyBurst_t& from, uint16_t from_idx, FlowKeyBurst_t& to, uint16_t to_idx) {
+    to.status[to_idx] = from.status[from_idx];
+    to.family[to_idx] = from.family[from_idx];
+    to.proto[to_idx] = from.proto[from_idx];
+    to.tcp_flags[to_idx] = from.tcp_flags[from_idx];
+    to.fragment[to_idx] = from.fragment[from_idx];
+    to.frag_id[to_idx] = from.frag_id[from_idx];
+    to.src_port[to_idx] = from.src_port[from_idx];
+    to.dst_port[to_idx] = from.dst_port[from_idx];
+    to.src_addr[to_idx] = from.src_addr[from_idx];
+    to.dst_addr[to_idx] = from.dst_addr[from_idx];
+    to.vlan[to_idx] = from.vlan[from_idx];
+    to.vni[to_idx] = from.vni[from_idx];
+}
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FLOW_KEY_H
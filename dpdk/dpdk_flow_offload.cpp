@@ -0,0 +1,313 @@
+#include "dpdk_flow_offload.h"
+
+#include <algorithm>
+#include <cstring>
+#include <arpa/inet.h>
+#include <rte_errno.h>
+#include <spdlog/spdlog.h>
+
+dpdk_flow_offload::dpdk_flow_offload()
+    : _generation(0)
+    , _port_id(UINT16_MAX)
+    , _mode(OffloadMode::OFF)
+    , _supported(true) {
+
+}
+
+dpdk_flow_offload::~dpdk_flow_offload() {
+    // Flows are flushed by the owner before the port is closed
+}
+
+void dpdk_flow_offload::attach(uint16_t port_id, OffloadMode mode) {
+    _port_id = port_id;
+    _mode = mode;
+    _supported = true;
+}
+
+bool dpdk_flow_offload::parse_mode(const std::string& text, OffloadMode& mode) {
+    if (text == "off") {
+        mode = OffloadMode::OFF;
+    } else if (text == "dry-run") {
+        mode = OffloadMode::DRY_RUN;
+    } else if (text == "on") {
+        mode = OffloadMode::ON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_flow_offload::overlaps(const std::optional<IpPrefix_t>& a, const std::optional<IpPrefix_t>& b) {
+    if (!a || !b) {
+        return true;
+    }
+    if (a->family != b->family) {
+        return false;
+    }
+
+    // Two prefixes intersect iff they agree on the shorter one's bits
+    const unsigned bits = std::min(a->length, b->length);
+    const uint8_t* x = a->addr.v6;
+    const uint8_t* y = b->addr.v6;
+    if (std::memcmp(x, y, bits / 8) != 0) {
+        return false;
+    }
+    if (bits % 8 == 0) {
+        return true;
+    }
+    const auto mask = static_cast<uint8_t>(0xFF << (8 - bits % 8));
+    return (x[bits / 8] & mask) == (y[bits / 8] & mask);
+}
+
+bool dpdk_flow_offload::overlaps(const std::optional<PortRange_t>& a, const std::optional<PortRange_t>& b) {
+    return !a || !b || (a->low <= b->high && b->low <= a->high);
+}
+
+bool dpdk_flow_offload::overlaps(const RuleMatch_t& a, const RuleMatch_t& b) {
+    if (a.proto && b.proto && *a.proto != *b.proto) {
+        return false;
+    }
+    return overlaps(a.src_ip, b.src_ip) && overlaps(a.dst_ip, b.dst_ip) &&
+           overlaps(a.src_port, b.src_port) && overlaps(a.dst_port, b.dst_port);
+}
+
+bool dpdk_flow_offload::eligible(const std::vector<dpdk_rule_set::Rule_t>& rules, size_t id, std::string& reason) {
+    const auto& rule = rules[id];
+    const auto& ip = rule.match.src_ip;
+    const auto& port = rule.match.src_port;
+    if (rule.action != RuleAction::BLOCK) {
+        reason = "not a block rule";
+        return false;
+    }
+    if (rule.match.dst_ip || rule.match.dst_port || rule.match.proto) {
+        reason = "multi-field match";
+        return false;
+    }
+    if (rule.match.vlan || rule.match.vni) {
+        reason = "VLAN/VNI scoped";
+        return false;
+    }
+    if (!rule.prefix_list.empty()) {
+        reason = "prefix list";
+        return false;
+    }
+    if (!ip && !port) {
+        reason = "matches all traffic";
+        return false;
+    }
+    if (ip && ip->length != (ip->family == NetworkProtocol::IPv4 ? 32 : 128)) {
+        reason = "prefix match";
+        return false;
+    }
+    if (port && port->low != port->high) {
+        reason = "port range";
+        return false;
+    }
+    if (port && port->low == 0) {
+        reason = "port 0 also matches non-TCP/UDP packets";
+        return false;
+    }
+
+    // The NIC drops before software runs, so an earlier allow covering any of
+    // the same packets must keep this rule in software
+    for (size_t j = 0; j < id; j++) {
+        if (rules[j].action != RuleAction::BLOCK && overlaps(rules[j].match, rule.match)) {
+            reason = "shadowed by non-block rule " + std::to_string(j);
+            return false;
+        }
+    }
+    return true;
+}
+
+int dpdk_flow_offload::install(const rte_flow_item* pattern, rte_flow*& flow, std::string& error) {
+    rte_flow_attr attr{};
+    attr.ingress = 1;
+
+    const rte_flow_action actions[] = {
+        { RTE_FLOW_ACTION_TYPE_DROP, nullptr },
+        { RTE_FLOW_ACTION_TYPE_END, nullptr }
+    };
+
+    rte_flow_error flow_error{};
+    flow = nullptr;
+    if (_mode == OffloadMode::DRY_RUN) {
+        const int ret = rte_flow_validate(_port_id, &attr, pattern, actions, &flow_error);
+        if (ret != 0) {
+            error = flow_error.message ? flow_error.message : rte_strerror(-ret);
+        }
+        return ret;
+    }
+
+    flow = rte_flow_create(_port_id, &attr, pattern, actions, &flow_error);
+    if (!flow) {
+        error = flow_error.message ? flow_error.message : rte_strerror(rte_errno);
+        return -rte_errno;
+    }
+    return 0;
+}
+
+bool dpdk_flow_offload::program_rule(const dpdk_rule_set::Rule_t& rule, RuleOffload_t& entry) {
+    // Software matches the port of TCP and UDP alike, and a port-only rule
+    // covers both address families, so one rule may need up to four flows
+    const auto& ip = rule.match.src_ip;
+    const auto& port = rule.match.src_port;
+    std::vector<NetworkProtocol> families;
+    if (ip) {
+        families.push_back(ip->family);
+    } else {
+        families = { NetworkProtocol::IPv4, NetworkProtocol::IPv6 };
+    }
+
+    std::vector<rte_flow_item_type> l4_types;
+    if (port) {
+        l4_types = { RTE_FLOW_ITEM_TYPE_TCP, RTE_FLOW_ITEM_TYPE_UDP };
+    } else {
+        l4_types = { RTE_FLOW_ITEM_TYPE_END };
+    }
+
+    rte_flow_item_ipv4 ipv4_spec{}, ipv4_mask{};
+    rte_flow_item_ipv6 ipv6_spec{}, ipv6_mask{};
+    if (ip && ip->family == NetworkProtocol::IPv4) {
+        ipv4_spec.hdr.src_addr = ip->addr.v4;
+        ipv4_mask.hdr.src_addr = UINT32_MAX;
+    } else if (ip) {
+        std::memcpy(&ipv6_spec.hdr.src_addr, ip->addr.v6, sizeof(ipv6_spec.hdr.src_addr));
+        std::memset(&ipv6_mask.hdr.src_addr, 0xFF, sizeof(ipv6_mask.hdr.src_addr));
+    }
+
+    rte_flow_item_tcp tcp_spec{}, tcp_mask{};
+    rte_flow_item_udp udp_spec{}, udp_mask{};
+    if (port) {
+        tcp_spec.hdr.src_port = udp_spec.hdr.src_port = htons(port->low);
+        tcp_mask.hdr.src_port = udp_mask.hdr.src_port = UINT16_MAX;
+    }
+
+    for (const auto family : families) {
+        for (const auto l4_type : l4_types) {
+            rte_flow_item pattern[4] = {};
+            pattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+            if (family == NetworkProtocol::IPv4) {
+                pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV4;
+                pattern[1].spec = ip ? &ipv4_spec : nullptr;
+                pattern[1].mask = ip ? &ipv4_mask : nullptr;
+            } else {
+                pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV6;
+                pattern[1].spec = ip ? &ipv6_spec : nullptr;
+                pattern[1].mask = ip ? &ipv6_mask : nullptr;
+            }
+            pattern[2].type = l4_type;
+            if (l4_type == RTE_FLOW_ITEM_TYPE_TCP) {
+                pattern[2].spec = &tcp_spec;
+                pattern[2].mask = &tcp_mask;
+            } else if (l4_type == RTE_FLOW_ITEM_TYPE_UDP) {
+                pattern[2].spec = &udp_spec;
+                pattern[2].mask = &udp_mask;
+            }
+            pattern[3].type = RTE_FLOW_ITEM_TYPE_END;
+
+            rte_flow* flow = nullptr;
+            std::string error;
+            const int ret = install(pattern, flow, error);
+            if (ret != 0) {
+                // All or nothing per rule, so the report stays exact
+                for (auto* created : entry.flows) {
+                    if (created) {
+                        rte_flow_destroy(_port_id, created, nullptr);
+                    }
+                }
+                entry.flows.clear();
+                entry.status = OffloadStatus::NIC_REJECTED;
+                entry.reason = error;
+                if (ret == -ENOSYS || ret == -ENOTSUP) {
+                    _supported = false;
+                }
+                return false;
+            }
+            entry.flows.push_back(flow);
+        }
+    }
+
+    entry.status = _mode == OffloadMode::DRY_RUN ? OffloadStatus::VALIDATED : OffloadStatus::OFFLOADED;
+    return true;
+}
+
+bool dpdk_flow_offload::apply(const dpdk_rule_set& rule_set) {
+    if (_mode == OffloadMode::OFF) {
+        return true;
+    }
+
+    // The new set is already live in software, so dropping the old flows first is safe
+    flush();
+    _generation = rule_set.generation();
+
+    const auto& rules = rule_set.rules();
+    _rules.reserve(rules.size());
+    bool all_ok = true;
+    for (size_t id = 0; id < rules.size(); id++) {
+        RuleOffload_t entry{ static_cast<uint32_t>(id), OffloadStatus::SOFTWARE, {}, {} };
+        if (eligible(rules, id, entry.reason)) {
+            if (!_supported) {
+                entry.status = OffloadStatus::NIC_REJECTED;
+                entry.reason = "port has no rte_flow support";
+            } else if (!program_rule(rules[id], entry)) {
+                all_ok = false;
+            }
+        }
+        _rules.push_back(std::move(entry));
+    }
+
+    print_report();
+    return all_ok;
+}
+
+void dpdk_flow_offload::flush() {
+    for (auto& entry : _rules) {
+        for (auto* flow : entry.flows) {
+            if (flow) {
+                rte_flow_error error{};
+                if (rte_flow_destroy(_port_id, flow, &error) != 0) {
+                    spdlog::warn("Failed to remove flow of rule {}: {}", entry.rule_id,
+                                 error.message ? error.message : "unknown error");
+                }
+            }
+        }
+    }
+    _rules.clear();
+}
+
+size_t dpdk_flow_offload::offloaded_count() const {
+    return std::count_if(_rules.begin(), _rules.end(), [](const RuleOffload_t& entry) {
+        return entry.status == OffloadStatus::OFFLOADED;
+    });
+}
+
+void dpdk_flow_offload::print_report() const {
+    size_t in_hardware = 0;
+    for (const auto& entry : _rules) {
+        if (entry.status == OffloadStatus::OFFLOADED || entry.status == OffloadStatus::VALIDATED) {
+            in_hardware++;
+        }
+    }
+
+    spdlog::info("==== Flow Offload Report (generation {}, {}) ====", _generation,
+                 _mode == OffloadMode::DRY_RUN ? "dry run" : "installed");
+    spdlog::info("{} of {} rules {} on port {}", in_hardware, _rules.size(),
+                 _mode == OffloadMode::DRY_RUN ? "would be offloaded" : "offloaded", _port_id);
+    for (const auto& entry : _rules) {
+        switch (entry.status) {
+        case OffloadStatus::OFFLOADED:
+            spdlog::info("- Rule {}: offloaded ({} flows)", entry.rule_id, entry.flows.size());
+            break;
+        case OffloadStatus::VALIDATED:
+            spdlog::info("- Rule {}: accepted by NIC ({} flows)", entry.rule_id, entry.flows.size());
+            break;
+        case OffloadStatus::NIC_REJECTED:
+            spdlog::info("- Rule {}: software, rejected by NIC: {}", entry.rule_id, entry.reason);
+            break;
+        case OffloadStatus::SOFTWARE:
+            spdlog::info("- Rule {}: software, {}", entry.rule_id, entry.reason);
+            break;
+        }
+    }
+    spdlog::info("===============================================================");
+}
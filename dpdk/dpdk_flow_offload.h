@@ -0,0 +1,67 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FLOW_OFFLOAD_H
+#define DPDK_FASTDROP_AGENT_DPDK_FLOW_OFFLOAD_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <rte_flow.h>
+
+#include "dpdk_rule_set.h"
+
+enum class OffloadMode : uint8_t {
+    OFF,
+    DRY_RUN,    // plan and rte_flow_validate only, nothing is installed
+    ON
+};
+
+enum class OffloadStatus : uint8_t {
+    OFFLOADED,
+    VALIDATED,      // dry run: the NIC would accept it
+    SOFTWARE,       // stays in the software path, see reason
+    NIC_REJECTED
+};
+
+// Installs rte_flow DROP rules for block list entries the NIC can enforce on its own.
+// Only exact source IP, exact source port and IP+port block rules qualify, and only
+// when no earlier allow or rate-limit rule overlaps them: the NIC drops before
+// software sees the packet, so a shadowing rule would otherwise be bypassed. Everything else stays in software,
+// which keeps matching the full rule set either way.
+class dpdk_flow_offload : public std::enable_shared_from_this<dpdk_flow_offload> {
+public:
+    typedef struct RuleOffload {
+        uint32_t rule_id;
+        OffloadStatus status;
+        std::string reason;
+        std::vector<rte_flow*> flows;
+    } RuleOffload_t;
+
+    explicit dpdk_flow_offload();
+    virtual ~dpdk_flow_offload();
+
+    void attach(uint16_t port_id, OffloadMode mode);
+    bool apply(const dpdk_rule_set& rule_set);
+    void flush();
+    void print_report() const;
+    size_t offloaded_count() const;
+
+    static bool parse_mode(const std::string& text, OffloadMode& mode);
+    static bool eligible(const std::vector<dpdk_rule_set::Rule_t>& rules, size_t id, std::string& reason);
+
+private:
+    static bool overlaps(const std::optional<IpPrefix_t>& a, const std::optional<IpPrefix_t>& b);
+    static bool overlaps(const std::optional<PortRange_t>& a, const std::optional<PortRange_t>& b);
+    static bool overlaps(const RuleMatch_t& a, const RuleMatch_t& b);
+    bool program_rule(const dpdk_rule_set::Rule_t& rule, RuleOffload_t& entry);
+    int install(const rte_flow_item* pattern, rte_flow*& flow, std::string& error);
+
+    std::vector<RuleOffload_t> _rules;
+    uint64_t _generation;
+    uint16_t _port_id;
+    OffloadMode _mode;
+    bool _supported;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FLOW_OFFLOAD_H
@@ -0,0 +1,147 @@
+#include "dpdk_frag_table.h"
+
+#include <cstring>
+#include <rte_errno.h>
+#include <rte_hash_crc.h>
+#include <rte_malloc.h>
+#include <spdlog/spdlog.h>
+
+dpdk_frag_table::dpdk_frag_table()
+    : _hash(nullptr)
+    , _entries(nullptr)
+    , _timeout_cycles(0)
+    , _capacity(0)
+    , _age_cursor(0)
+    , _stats{} {
+
+}
+
+dpdk_frag_table::~dpdk_frag_table() {
+    if (_hash) {
+        rte_hash_free(_hash);
+        _hash = nullptr;
+    }
+    rte_free(_entries);
+    _entries = nullptr;
+}
+
+bool dpdk_frag_table::init(const std::string& name, uint32_t entries, uint64_t timeout_cycles, int socket_id) {
+    if (entries == 0) {
+        return true;
+    }
+
+    // Single writer (the owning lcore), so no locking or lock-free flags
+    rte_hash_parameters params{};
+    params.name = name.c_str();
+    params.entries = entries;
+    params.key_len = sizeof(FragKey_t);
+    params.hash_func = rte_hash_crc;
+    params.hash_func_init_val = 0;
+    params.socket_id = socket_id;
+
+    _hash = rte_hash_create(&params);
+    if (!_hash) {
+        spdlog::error("Failed to create fragment table {} ({} entries): {}", name, entries, rte_strerror(rte_errno));
+        return false;
+    }
+
+    _entries = static_cast<FragEntry_t*>(
+            rte_zmalloc_socket("frag_table_entries", sizeof(FragEntry_t) * entries, RTE_CACHE_LINE_SIZE, socket_id));
+    if (!_entries) {
+        spdlog::error("Failed to allocate fragment table {} entries on socket {}", name, socket_id);
+        rte_hash_free(_hash);
+        _hash = nullptr;
+        return false;
+    }
+
+    _capacity = entries;
+    _timeout_cycles = timeout_cycles;
+    return true;
+}
+
+void dpdk_frag_table::make_key(const FlowKeyBurst_t& keys, uint16_t idx, FragKey_t& key) {
+    std::memset(&key, 0, sizeof(key));
+    key.src_addr = keys.src_addr[idx];
+    key.dst_addr = keys.dst_addr[idx];
+    key.id = keys.frag_id[idx];
+    key.proto = keys.proto[idx];
+    key.family = keys.family[idx];
+    key.vlan = keys.vlan[idx];
+}
+
+void dpdk_frag_table::remove(int32_t pos, const FragKey_t& key) {
+    rte_hash_del_key(_hash, &key);
+    _entries[pos] = FragEntry_t{};
+}
+
+void dpdk_frag_table::apply_burst(const FlowKeyBurst_t& keys, uint32_t* results, uint64_t now) {
+    if (!_hash) {
+        return;
+    }
+
+    // Fragments are rare, so they are looked up one at a time instead of in bulk
+    for (uint16_t i = 0; i < keys.count; i++) {
+        if (keys.fragment[i] == FragmentType::NONE || keys.status[i] != ParseStatus::OK) {
+            continue;
+        }
+
+        FragKey_t key;
+        make_key(keys, i, key);
+
+        if (keys.fragment[i] == FragmentType::FIRST) {
+            // A repeated first fragment just refreshes the entry
+            const int32_t pos = rte_hash_add_key(_hash, &key);
+            if (pos < 0) {
+                _stats.full++;
+                continue;
+            }
+            _entries[pos] = FragEntry_t{ results[i], now + _timeout_cycles };
+            _stats.tracked++;
+            continue;
+        }
+
+        const int32_t pos = rte_hash_lookup(_hash, &key);
+        if (pos >= 0 && now < _entries[pos].expires) {
+            results[i] = _entries[pos].result;
+            _stats.matched++;
+            continue;
+        }
+        if (pos >= 0) {
+            remove(pos, key);
+            _stats.expired++;
+        }
+        results[i] = UNMATCHED;
+        _stats.unmatched++;
+    }
+}
+
+void dpdk_frag_table::age(uint64_t now, uint32_t budget) {
+    if (!_hash) {
+        return;
+    }
+
+    // Walk the entry array, not the hash buckets, so the work per call is fixed
+    for (uint32_t k = 0; k < budget; k++) {
+        const uint32_t pos = _age_cursor;
+        _age_cursor = _age_cursor + 1 < _capacity ? _age_cursor + 1 : 0;
+
+        const FragEntry_t& entry = _entries[pos];
+        if (entry.expires == 0 || now < entry.expires) {
+            continue;
+        }
+
+        void* key = nullptr;
+        if (rte_hash_get_key_with_position(_hash, static_cast<int32_t>(pos), &key) == 0) {
+            FragKey_t frag_key;
+            std::memcpy(&frag_key, key, sizeof(frag_key));
+            remove(static_cast<int32_t>(pos), frag_key);
+        } else {
+            _entries[pos] = FragEntry_t{};
+        }
+        _stats.expired++;
+    }
+}
+
+const FragTableStats_t& dpdk_frag_table::stats() const {
+    return _stats;
+}
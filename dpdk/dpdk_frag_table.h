@@ -0,0 +1,70 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_FRAG_TABLE_H
+#define DPDK_FASTDROP_AGENT_DPDK_FRAG_TABLE_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <rte_hash.h>
+
+#include "dpdk_flow_key.h"
+#include "dpdk_rule_classifier.h"
+
+typedef struct FragTableStats {
+    uint64_t tracked;       // first fragments whose verdict was recorded
+    uint64_t matched;       // later fragments given their first fragment's verdict
+    uint64_t unmatched;     // later fragments without a live entry, dropped
+    uint64_t expired;
+    uint64_t full;          // first fragments not recorded because the table was full
+} FragTableStats_t;
+
+// Per-lcore, verdict-only fragment tracking. Later fragments carry no L4 header, so port
+// rules can not see them; instead the verdict the first fragment got is remembered under
+// (src, dst, id, proto, vlan) and copied to the rest of the datagram. Nothing is buffered or
+// reassembled: a later fragment that arrives before its first fragment, after the timeout
+// or once the table is full is dropped (fail closed).
+// RSS hashes every fragment of a datagram on L3 only, so they all reach the same lcore.
+class dpdk_frag_table {
+public:
+    // Result given to unmatched later fragments: a BLOCK under a rule id no rule set uses
+    static constexpr uint32_t UNMATCHED = dpdk_rule_classifier::encode(
+            dpdk_rule_classifier::rule_id(dpdk_rule_classifier::NO_MATCH) - 1, RuleAction::BLOCK);
+
+    explicit dpdk_frag_table();
+    virtual ~dpdk_frag_table();
+
+    bool init(const std::string& name, uint32_t entries, uint64_t timeout_cycles, int socket_id);
+    // Records first fragment results and overwrites those of later fragments, in burst order
+    void apply_burst(const FlowKeyBurst_t& keys, uint32_t* results, uint64_t now);
+    void age(uint64_t now, uint32_t budget);
+
+    const FragTableStats_t& stats() const;
+
+private:
+    // Hashed as raw bytes, so always built from a zeroed value
+    typedef struct FragKey {
+        IpAddr_t src_addr;
+        IpAddr_t dst_addr;
+        uint32_t id;
+        uint8_t proto;
+        NetworkProtocol family;
+        uint16_t vlan;
+    } FragKey_t;
+
+    typedef struct FragEntry {
+        uint32_t result;
+        uint64_t expires;   // TSC, 0 for a free slot
+    } FragEntry_t;
+
+    static void make_key(const FlowKeyBurst_t& keys, uint16_t idx, FragKey_t& key);
+    void remove(int32_t pos, const FragKey_t& key);
+
+    rte_hash* _hash;
+    FragEntry_t* _entries;  // indexed by rte_hash key position
+    uint64_t _timeout_cycles;
+    uint32_t _capacity;
+    uint32_t _age_cursor;
+    FragTableStats_t _stats;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_FRAG_TABLE_H
@@ -0,0 +1,61 @@
+#include "dpdk_log_sampler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <rte_lcore.h>
+
+dpdk_log_sampler::dpdk_log_sampler()
+    : _ring(nullptr)
+    , _policy{}
+    , _tsc_hz(0)
+    , _window_start(0)
+    , _window_count(0)
+    , _countdown(0)
+    , _stats{} {
+
+}
+
+dpdk_log_sampler::~dpdk_log_sampler() {
+
+}
+
+void dpdk_log_sampler::attach(rte_ring* ring, const PacketLogPolicy_t& policy, uint64_t tsc_hz) {
+    _policy = policy;
+    _tsc_hz = tsc_hz;
+    _window_start = 0;
+    _window_count = 0;
+    _countdown = policy.sample_rate;
+    // A zero rate or an empty filter leaves the fast path a single predictable branch
+    _ring = policy.sample_rate && policy.reason_mask ? ring : nullptr;
+}
+
+void dpdk_log_sampler::enqueue(LogReason reason, const rte_mbuf* pkt, uint32_t result, uint64_t now) {
+    if (now - _window_start >= _tsc_hz) {
+        _window_start = now;
+        _window_count = 0;
+    }
+    if (_policy.max_per_second && _window_count >= _policy.max_per_second) {
+        _stats.suppressed++;
+        return;
+    }
+    _window_count++;
+
+    PacketLogRecord_t record;
+    record.tsc = now;
+    record.result = result;
+    record.pkt_len = rte_pktmbuf_pkt_len(pkt);
+    record.lcore_id = static_cast<uint16_t>(rte_lcore_id());
+    record.snap_len = std::min<uint16_t>(rte_pktmbuf_data_len(pkt), PacketLogRecord_t::SNAP_LEN);
+    record.reason = reason;
+    std::memcpy(record.snap, rte_pktmbuf_mtod(pkt, const uint8_t*), record.snap_len);
+
+    if (rte_ring_sp_enqueue_elem(_ring, &record, sizeof(record)) != 0) {
+        _stats.ring_full++;
+        return;
+    }
+    _stats.records++;
+}
+
+const LogSamplerStats_t& dpdk_log_sampler::stats() const {
+    return _stats;
+}
@@ -0,0 +1,84 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_LOG_SAMPLER_H
+#define DPDK_FASTDROP_AGENT_DPDK_LOG_SAMPLER_H
+
+#pragma once
+
+#include <cstdint>
+#include <rte_branch_prediction.h>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+
+// Why a packet was logged; also the bit position in the reason filter
+enum class LogReason : uint8_t {
+    ALLOWED = 0,
+    BLOCKED,
+    RATE_LIMITED,
+    PARSE_FAILED
+};
+
+// Fixed-size binary record passed from a worker to the logging thread.
+// Two cache lines: the verdict plus a snapshot of the first bytes of the frame,
+// which the logging thread parses and formats later.
+typedef struct PacketLogRecord {
+    static constexpr uint16_t SNAP_LEN = 96;
+
+    uint64_t tsc;
+    uint32_t result;        // raw classifier result
+    uint32_t pkt_len;
+    uint16_t lcore_id;
+    uint16_t snap_len;
+    LogReason reason;
+    uint8_t pad[11];
+    uint8_t snap[SNAP_LEN];
+} PacketLogRecord_t;
+
+static_assert(sizeof(PacketLogRecord_t) == 128, "log record must stay two cache lines");
+
+typedef struct PacketLogPolicy {
+    uint32_t sample_rate;       // log 1 in N packets that pass the reason filter, 0 = off
+    uint32_t reason_mask;       // bit (1 << LogReason)
+    uint32_t max_per_second;    // per worker lcore
+} PacketLogPolicy_t;
+
+typedef struct LogSamplerStats {
+    uint64_t records;           // enqueued for the logging thread
+    uint64_t suppressed;        // sampled but over the rate cap
+    uint64_t ring_full;         // sampled but the logging thread fell behind
+} LogSamplerStats_t;
+
+// Worker side of the packet logger. Decides with a few integer ops whether a packet
+// is logged and, if so, copies a snapshot into the lcore's single-producer ring.
+// Never formats, allocates or blocks: when the ring is full the record is dropped.
+class dpdk_log_sampler {
+public:
+    explicit dpdk_log_sampler();
+    virtual ~dpdk_log_sampler();
+
+    void attach(rte_ring* ring, const PacketLogPolicy_t& policy, uint64_t tsc_hz);
+
+    inline void offer(LogReason reason, const rte_mbuf* pkt, uint32_t result, uint64_t now) {
+        if (likely(!_ring || !(_policy.reason_mask & (1u << static_cast<uint8_t>(reason))))) {
+            return;
+        }
+        if (--_countdown != 0) {
+            return;
+        }
+        _countdown = _policy.sample_rate;
+        enqueue(reason, pkt, result, now);
+    }
+
+    const LogSamplerStats_t& stats() const;
+
+private:
+    void enqueue(LogReason reason, const rte_mbuf* pkt, uint32_t result, uint64_t now);
+
+    rte_ring* _ring;
+    PacketLogPolicy_t _policy;
+    uint64_t _tsc_hz;
+    uint64_t _window_start;
+    uint32_t _window_count;
+    uint32_t _countdown;
+    LogSamplerStats_t _stats;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_LOG_SAMPLER_H
@@ -0,0 +1,197 @@
+#include "dpdk_metrics_exporter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <rte_cycles.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+    typedef struct CounterDesc {
+        const char* name;
+        const char* help;
+        uint64_t WorkerCounters_t::* field;
+        const char* rate_name;  // nullptr when no rate gauge is exported
+        double rate_scale;      // 8 turns bytes into bits per second
+    } CounterDesc_t;
+
+    const CounterDesc_t counter_descs[] = {
+        {"fastdrop_rx_packets_total", "Packets received", &WorkerCounters_t::rx_packets, "fastdrop_rx_pps", 1.0},
+        {"fastdrop_rx_bytes_total", "Bytes received", &WorkerCounters_t::rx_bytes, "fastdrop_rx_bps", 8.0},
+        {"fastdrop_tx_packets_total", "Packets transmitted", &WorkerCounters_t::tx_packets, "fastdrop_tx_pps", 1.0},
+        {"fastdrop_tx_bytes_total", "Bytes transmitted", &WorkerCounters_t::tx_bytes, "fastdrop_tx_bps", 8.0},
+        {"fastdrop_drop_packets_total", "Packets blocked by the filter", &WorkerCounters_t::dropped_packets, "fastdrop_drop_pps", 1.0},
+        {"fastdrop_drop_bytes_total", "Bytes blocked by the filter", &WorkerCounters_t::dropped_bytes, "fastdrop_drop_bps", 8.0},
+        {"fastdrop_parse_failures_total", "Packets dropped because parsing failed", &WorkerCounters_t::parse_failures, nullptr, 0.0},
+        {"fastdrop_checksum_drops_total", "Packets dropped because the NIC flagged a bad IP or L4 checksum", &WorkerCounters_t::checksum_drops, nullptr, 0.0},
+        {"fastdrop_ptype_parsed_total", "Packets parsed from the NIC's packet type instead of their bytes", &WorkerCounters_t::ptype_parsed, nullptr, 0.0},
+        {"fastdrop_rate_limited_packets_total", "Packets dropped for exceeding a rate limit", &WorkerCounters_t::rate_limited, "fastdrop_rate_limited_pps", 1.0},
+        {"fastdrop_rate_limit_evictions_total", "Active rate limit buckets evicted for lack of space", &WorkerCounters_t::rate_limit_evictions, nullptr, 0.0},
+        {"fastdrop_flow_cache_hits_total", "Packets classified from the flow cache", &WorkerCounters_t::flow_cache_hits, nullptr, 0.0},
+        {"fastdrop_flow_cache_misses_total", "Packets classified by the full rule set", &WorkerCounters_t::flow_cache_misses, nullptr, 0.0},
+        {"fastdrop_flow_cache_expired_total", "Flow cache entries aged out or invalidated by a reload", &WorkerCounters_t::flow_cache_expired, nullptr, 0.0},
+        {"fastdrop_flow_cache_closed_total", "Flow cache entries removed on TCP FIN/RST", &WorkerCounters_t::flow_cache_closed, nullptr, 0.0},
+        {"fastdrop_prefilter_skips_total", "Rule lookups the Bloom pre-filter answered without the exact-address tables", &WorkerCounters_t::prefilter_skips, nullptr, 0.0},
+        {"fastdrop_frag_tracked_total", "First fragments whose verdict was recorded for the rest of the datagram", &WorkerCounters_t::frag_tracked, nullptr, 0.0},
+        {"fastdrop_frag_matched_total", "Later fragments given their first fragment's verdict", &WorkerCounters_t::frag_matched, nullptr, 0.0},
+        {"fastdrop_frag_unmatched_total", "Later fragments dropped because their first fragment was not seen", &WorkerCounters_t::frag_unmatched, nullptr, 0.0},
+        {"fastdrop_log_records_total", "Sampled packets handed to the logging thread", &WorkerCounters_t::log_records, nullptr, 0.0},
+        {"fastdrop_log_drops_total", "Sampled packets not logged because of the rate cap or a full log ring", &WorkerCounters_t::log_drops, nullptr, 0.0},
+        {"fastdrop_tx_full_drops_total", "Packets freed because the TX queue was full", &WorkerCounters_t::tx_full_drops, nullptr, 0.0},
+        {"fastdrop_empty_polls_total", "RX polls that returned no packets", &WorkerCounters_t::empty_polls, nullptr, 0.0},
+        {"fastdrop_busy_cycles_total", "TSC cycles spent processing non-empty bursts", &WorkerCounters_t::busy_cycles, nullptr, 0.0},
+        {"fastdrop_idle_spin_cycles_total", "TSC cycles spent idle spinning", &WorkerCounters_t::idle_spin_cycles, nullptr, 0.0},
+        {"fastdrop_idle_pause_cycles_total", "TSC cycles spent idle in rte_pause", &WorkerCounters_t::idle_pause_cycles, nullptr, 0.0},
+        {"fastdrop_idle_sleep_cycles_total", "TSC cycles spent idle asleep", &WorkerCounters_t::idle_sleep_cycles, nullptr, 0.0},
+        {"fastdrop_wakeups_spin_total", "Idle periods ended while spinning", &WorkerCounters_t::wakeups_spin, nullptr, 0.0},
+        {"fastdrop_wakeups_pause_total", "Idle periods ended while pausing", &WorkerCounters_t::wakeups_pause, nullptr, 0.0},
+        {"fastdrop_wakeups_sleep_total", "Idle periods ended asleep", &WorkerCounters_t::wakeups_sleep, nullptr, 0.0},
+        {"fastdrop_wake_latency_spin_cycles_total", "Summed wakeup latency of spin wakeups", &WorkerCounters_t::wake_latency_spin_cycles, nullptr, 0.0},
+        {"fastdrop_wake_latency_pause_cycles_total", "Summed wakeup latency of pause wakeups", &WorkerCounters_t::wake_latency_pause_cycles, nullptr, 0.0},
+        {"fastdrop_wake_latency_sleep_cycles_total", "Summed wakeup latency of sleep wakeups", &WorkerCounters_t::wake_latency_sleep_cycles, nullptr, 0.0},
+    };
+}
+
+dpdk_metrics_exporter::dpdk_metrics_exporter(const std::string& path)
+    : _path(path)
+    , _previous{}
+    , _previous_tsc(0)
+    , _write_failed(false) {
+
+}
+
+dpdk_metrics_exporter::~dpdk_metrics_exporter() {
+
+}
+
+void dpdk_metrics_exporter::publish(const std::array<dpdk_worker_context*, RTE_MAX_LCORE>& workers) {
+    const uint64_t now = rte_rdtsc();
+    const double elapsed = _previous_tsc ? static_cast<double>(now - _previous_tsc) / rte_get_tsc_hz() : 0.0;
+    _previous_tsc = now;
+
+    std::array<WorkerCounters_t, RTE_MAX_LCORE> current{};
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        if (workers[lcore_id]) {
+            current[lcore_id] = workers[lcore_id]->read_counters();
+        }
+    }
+
+    std::ostringstream out;
+    for (const auto& desc : counter_descs) {
+        out << "# HELP " << desc.name << " " << desc.help << "\n";
+        out << "# TYPE " << desc.name << " counter\n";
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            if (workers[lcore_id]) {
+                out << desc.name << "{lcore=\"" << lcore_id << "\"} " << current[lcore_id].*desc.field << "\n";
+            }
+        }
+    }
+
+    if (elapsed > 0.0) {
+        for (const auto& desc : counter_descs) {
+            if (!desc.rate_name) {
+                continue;
+            }
+            out << "# TYPE " << desc.rate_name << " gauge\n";
+            double total = 0.0;
+            for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+                if (!workers[lcore_id]) {
+                    continue;
+                }
+                const double rate = (current[lcore_id].*desc.field - _previous[lcore_id].*desc.field) * desc.rate_scale / elapsed;
+                total += rate;
+                out << desc.rate_name << "{lcore=\"" << lcore_id << "\"} " << rate << "\n";
+            }
+            out << desc.rate_name << " " << total << "\n";
+        }
+
+        out << "# TYPE fastdrop_busy_ratio gauge\n";
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            if (workers[lcore_id]) {
+                const double busy = (current[lcore_id].busy_cycles - _previous[lcore_id].busy_cycles) /
+                                    (elapsed * rte_get_tsc_hz());
+                out << "fastdrop_busy_ratio{lcore=\"" << lcore_id << "\"} " << busy << "\n";
+            }
+        }
+
+        // How evenly RSS or the software flow distributor spreads packets: each worker's share of
+        // the interval's packets, and the busiest worker against the mean (1.0 is an even spread)
+        uint64_t rx_total = 0;
+        uint64_t rx_max = 0;
+        unsigned worker_count = 0;
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            if (workers[lcore_id]) {
+                const uint64_t rx = current[lcore_id].rx_packets - _previous[lcore_id].rx_packets;
+                rx_total += rx;
+                rx_max = std::max(rx_max, rx);
+                worker_count++;
+            }
+        }
+        if (rx_total > 0) {
+            out << "# TYPE fastdrop_rx_share gauge\n";
+            for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+                if (workers[lcore_id]) {
+                    const uint64_t rx = current[lcore_id].rx_packets - _previous[lcore_id].rx_packets;
+                    out << "fastdrop_rx_share{lcore=\"" << lcore_id << "\"} " << static_cast<double>(rx) / rx_total << "\n";
+                }
+            }
+            out << "# TYPE fastdrop_load_imbalance gauge\n";
+            out << "fastdrop_load_imbalance " << static_cast<double>(rx_max) * worker_count / rx_total << "\n";
+        }
+    }
+
+    // Cumulative since the workers started, only present in FASTDROP_STAGE_TIMING builds
+    if (dpdk_stage_timer::ENABLED) {
+        out << "# HELP fastdrop_stage_cycles_per_packet TSC cycles per packet spent in each worker loop stage\n";
+        out << "# TYPE fastdrop_stage_cycles_per_packet summary\n";
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            if (!workers[lcore_id]) {
+                continue;
+            }
+            for (size_t stage = 0; stage < static_cast<size_t>(WorkerStage::COUNT); stage++) {
+                const StageLatency_t latency = workers[lcore_id]->stage_timer().latency(static_cast<WorkerStage>(stage));
+                const std::string labels = "lcore=\"" + std::to_string(lcore_id) + "\",stage=\"" +
+                                           dpdk_stage_timer::stage_name(static_cast<WorkerStage>(stage)) + "\"";
+                out << "fastdrop_stage_cycles_per_packet{" << labels << ",quantile=\"0.5\"} " << latency.p50 << "\n";
+                out << "fastdrop_stage_cycles_per_packet{" << labels << ",quantile=\"0.99\"} " << latency.p99 << "\n";
+                out << "fastdrop_stage_cycles_per_packet{" << labels << ",quantile=\"0.999\"} " << latency.p999 << "\n";
+                out << "fastdrop_stage_cycles_per_packet_sum{" << labels << "} " << latency.cycles << "\n";
+                out << "fastdrop_stage_cycles_per_packet_count{" << labels << "} " << latency.packets << "\n";
+            }
+        }
+    }
+
+    _previous = current;
+    write_file(out.str());
+}
+
+bool dpdk_metrics_exporter::write_file(const std::string& text) const {
+    if (_path.empty()) {
+        return false;
+    }
+
+    // Write then rename, so a scraper never sees a half-written file
+    const std::string tmp_path = _path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::trunc);
+        if (!f.is_open()) {
+            if (!_write_failed) {
+                spdlog::warn("Failed to open metrics file: {}", tmp_path);
+            }
+            _write_failed = true;
+            return false;
+        }
+        f << text;
+    }
+
+    if (std::rename(tmp_path.c_str(), _path.c_str()) != 0) {
+        if (!_write_failed) {
+            spdlog::warn("Failed to publish metrics file: {}", _path);
+        }
+        _write_failed = true;
+        return false;
+    }
+    _write_failed = false;
+    return true;
+}
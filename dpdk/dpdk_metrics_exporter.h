@@ -0,0 +1,31 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_METRICS_EXPORTER_H
+#define DPDK_FASTDROP_AGENT_DPDK_METRICS_EXPORTER_H
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <rte_lcore.h>
+
+#include "dpdk_worker_context.h"
+
+// Aggregates the per-lcore counters on the control thread and publishes totals
+// and per-second rates in Prometheus text format (node_exporter textfile style).
+class dpdk_metrics_exporter : public std::enable_shared_from_this<dpdk_metrics_exporter> {
+public:
+    explicit dpdk_metrics_exporter(const std::string& path);
+    virtual ~dpdk_metrics_exporter();
+
+    void publish(const std::array<dpdk_worker_context*, RTE_MAX_LCORE>& workers);
+
+private:
+    bool write_file(const std::string& text) const;
+
+    std::string _path;
+    std::array<WorkerCounters_t, RTE_MAX_LCORE> _previous;
+    uint64_t _previous_tsc;
+    mutable bool _write_failed;     // warn once, not every second
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_METRICS_EXPORTER_H
@@ -1,90 +1,171 @@
 #include "dpdk_packet_filter.h"
 
-#include <nlohmann/json.hpp>
-#include <fstream>
-#include <arpa/inet.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
 #include <spdlog/spdlog.h>
 
-dpdk_packet_filter::dpdk_packet_filter() {
+dpdk_packet_filter::dpdk_packet_filter()
+    : _active(nullptr)
+    , _qsbr(nullptr)
+    , _snapshot_memory(SnapshotMemory::MMAP)
+    , _prefilter_rate(0.0)
+    , _next_generation(1) {
 
 }
 
 dpdk_packet_filter::~dpdk_packet_filter() {
+    // Workers are stopped by now, nothing can still reference the active set
+    delete _active.exchange(nullptr);
 
+    if (_qsbr) {
+        rte_free(_qsbr);
+        _qsbr = nullptr;
+    }
 }
 
-bool dpdk_packet_filter::load_rules(const std::string& path) {
-    std::ifstream f(path);
-    if (!f.is_open()) {
-        spdlog::error("Failed to open rule file: {}", path);
+bool dpdk_packet_filter::enable_rcu(uint32_t max_readers) {
+    if (_qsbr) {
+        return true;
+    }
+
+    const size_t size = rte_rcu_qsbr_get_memsize(max_readers);
+    auto* qsbr = static_cast<rte_rcu_qsbr*>(rte_zmalloc("rule_set_qsbr", size, RTE_CACHE_LINE_SIZE));
+    if (!qsbr) {
+        spdlog::error("Failed to allocate RCU QSBR variable for {} readers", max_readers);
         return false;
     }
 
-    nlohmann::json json;
-    try {
-        f >> json;
-    } catch (const std::exception& e) {
-        spdlog::error("JSON parse error: {}", e.what());
+    if (rte_rcu_qsbr_init(qsbr, max_readers) != 0) {
+        spdlog::error("Failed to initialize RCU QSBR variable: {}", rte_strerror(rte_errno));
+        rte_free(qsbr);
         return false;
     }
 
-    _rules.clear();
-    for (const auto& item : json) {
-        Rule rule;
+    _qsbr = qsbr;
+    return true;
+}
 
-        if (item.contains("ip")) {
-            std::string ip_str = item["ip"].get<std::string>();
-            in_addr addr{};
-            if (inet_pton(AF_INET, ip_str.c_str(), &addr) == 1) {
-                rule.ip = addr.s_addr;
-            } else {
-                spdlog::warn("Invalid IP in rule: {}", ip_str);
-                continue;
-            }
-        }
+void dpdk_packet_filter::set_snapshot_memory(SnapshotMemory memory) {
+    _snapshot_memory = memory;
+}
 
-        if (item.contains("port")) {
-            rule.port = static_cast<uint16_t>(item["port"].get<int>());
-        }
+void dpdk_packet_filter::set_prefilter(double false_positive_rate) {
+    _prefilter_rate = false_positive_rate;
+}
 
-        rule.block = item.value("block", true);
+void dpdk_packet_filter::set_rule_stats(const std::string& path) {
+    _rule_stats_path = path;
+}
 
-        if (item.contains("comment")) {
-            rule.comment = item["comment"].get<std::string>();
-        }
+void dpdk_packet_filter::register_reader(unsigned reader_id) const {
+    if (_qsbr && rte_rcu_qsbr_thread_register(_qsbr, reader_id) != 0) {
+        spdlog::error("Failed to register RCU reader {}", reader_id);
+    }
+}
+
+void dpdk_packet_filter::unregister_reader(unsigned reader_id) const {
+    if (_qsbr) {
+        rte_rcu_qsbr_thread_unregister(_qsbr, reader_id);
+    }
+}
+
+bool dpdk_packet_filter::load_rules(const std::string& path) {
+    // Remember the version we tried, so a broken file is not retried until it changes again
+    std::error_code ec;
+    _rule_path = path;
+    _rule_mtime = std::filesystem::last_write_time(path, ec);
+
+    // Build the new generation entirely off the datapath
+    auto rule_set = std::make_unique<dpdk_rule_set>(_next_generation);
+    rule_set->set_prefilter(_prefilter_rate);
+    // Runs on a live agent at every reload: nothing in an edited file may take it down
+    bool loaded = false;
+    try {
+        loaded = rule_set->load(path, _snapshot_memory);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to load {}: {}", path, e.what());
+    }
+    if (!loaded) {
+        spdlog::error("Keeping rule set generation {}, reload of {} failed", generation(), path);
+        return false;
+    }
+    _next_generation++;
 
-        _rules.push_back(rule);
+    // One slot per lcore index, so each worker bumps only its own counters
+    if (!_rule_stats_path.empty() && !rule_set->enable_rule_stats(rte_lcore_count())) {
+        spdlog::warn("Rule hit counters disabled for rule set generation {}", rule_set->generation());
     }
 
-    spdlog::info("Loaded {} filtering rules", _rules.size());
+    publish(rule_set.release());
     return true;
 }
 
-bool dpdk_packet_filter::match(uint32_t ip, uint16_t port, bool is_tcp) {
-    for (const auto& rule : _rules) {
-        if (rule.ip && *rule.ip != ip) {
-            continue;
-        }
+void dpdk_packet_filter::publish(dpdk_rule_set* rule_set) {
+    const dpdk_rule_set* old_set = _active.exchange(rule_set, std::memory_order_acq_rel);
+    if (!old_set) {
+        return;
+    }
 
-        if (rule.port && *rule.port != port) {
-            continue;
-        }
+    // Wait until every online worker has finished the burst that may still use old_set
+    if (_qsbr) {
+        rte_rcu_qsbr_synchronize(_qsbr, RTE_QSBR_THRID_INVALID);
+    }
+    // No worker counts into old_set any more, its totals are final
+    if (!_rule_stats_path.empty()) {
+        old_set->write_rule_stats(_rule_stats_path);
+        old_set->print_rule_stats();
+    }
+    spdlog::info("Rule set generation {} replaced by {}", old_set->generation(), rule_set->generation());
+    delete old_set;
+}
 
-        // block: false
-        return !rule.block;
+bool dpdk_packet_filter::rules_file_changed() const {
+    if (_rule_path.empty()) {
+        return false;
     }
-    return true;
+
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(_rule_path, ec);
+    return !ec && mtime != _rule_mtime;
+}
+
+const dpdk_rule_set* dpdk_packet_filter::classify_burst(const FlowKeyBurst_t& keys, uint32_t* results) const {
+    // The caller may keep using the returned set (e.g. for rate policies) until its next quiescent report
+    const dpdk_rule_set* rule_set = _active.load(std::memory_order_acquire);
+    if (!rule_set) {
+        std::fill(results, results + keys.count, dpdk_rule_classifier::NO_MATCH);
+        return nullptr;
+    }
+    rule_set->lookup_burst(keys, results);
+    return rule_set;
 }
 
 void dpdk_packet_filter::print_rules_comments() const {
-    spdlog::info("==== Packet Filter Rules Comments (Total: {}) ====", _rules.size());
-    int idx = 0;
-    for (const auto& rule : _rules) {
-        if (!rule.comment.empty()) {
-            spdlog::info("- Rule {}: {}", idx++, rule.comment);
-        } else {
-            spdlog::info("- Rule {}: (No comment)", idx++);
-        }
-    }
-    spdlog::info("===============================================================");
-}
\ No newline at end of file
+    const dpdk_rule_set* rule_set = _active.load(std::memory_order_acquire);
+    if (rule_set) {
+        rule_set->print_rules_comments();
+    }
+}
+
+void dpdk_packet_filter::write_rule_stats() const {
+    const dpdk_rule_set* rule_set = _active.load(std::memory_order_acquire);
+    if (rule_set && !_rule_stats_path.empty()) {
+        rule_set->write_rule_stats(_rule_stats_path);
+    }
+}
+
+void dpdk_packet_filter::print_rule_stats() const {
+    const dpdk_rule_set* rule_set = _active.load(std::memory_order_acquire);
+    if (rule_set) {
+        rule_set->print_rule_stats();
+    }
+}
+
+uint64_t dpdk_packet_filter::generation() const {
+    const dpdk_rule_set* rule_set = _active.load(std::memory_order_acquire);
+    return rule_set ? rule_set->generation() : 0;
+}
+
+const dpdk_rule_set* dpdk_packet_filter::active_rule_set() const {
+    return _active.load(std::memory_order_acquire);
+}
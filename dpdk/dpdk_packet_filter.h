@@ -3,29 +3,86 @@
 
 #pragma once
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
-#include <optional>
 #include <string>
-#include <vector>
+#include <rte_rcu_qsbr.h>
 
+#include "dpdk_rule_set.h"
+
+// Owns the active rule set and swaps it without stopping the workers.
+// Workers read the current set lock-free and report quiescent states via QSBR;
+// a reload publishes the new set atomically and frees the old one only after
+// every registered reader has moved past it.
 class dpdk_packet_filter : public std::enable_shared_from_this<dpdk_packet_filter> {
 public:
     explicit dpdk_packet_filter();
     virtual ~dpdk_packet_filter();
 
+    bool enable_rcu(uint32_t max_readers);
+    // Where rule snapshots are loaded, applies from the next load_rules
+    void set_snapshot_memory(SnapshotMemory memory);
+    // Pre-filter false positive target for rule sets built from now on, 0 disables it
+    void set_prefilter(double false_positive_rate);
+    // Per-rule hit counters for rule sets built from now on, reported to path; empty disables them
+    void set_rule_stats(const std::string& path);
     bool load_rules(const std::string& path);
-    bool match(uint32_t ip, uint16_t port, bool is_tcp);
+    bool rules_file_changed() const;
+    const dpdk_rule_set* classify_burst(const FlowKeyBurst_t& keys, uint32_t* results) const;
     void print_rules_comments() const;
+    // Control thread only, writes the active set's counters
+    void write_rule_stats() const;
+    void print_rule_stats() const;
+    uint64_t generation() const;
+
+    // Valid for a worker until its next quiescent report, for the control thread until the next publish
+    const dpdk_rule_set* active_rule_set() const;
+
+    // true when a classify_burst result lets the packet through
+    // (RATE_LIMIT passes here, the rate limiter turns excess into RATE_EXCEEDED)
+    static inline bool is_allowed(uint32_t result) {
+        if (result == dpdk_rule_classifier::NO_MATCH) {
+            return true;
+        }
+        const RuleAction action = dpdk_rule_classifier::action(result);
+        return action == RuleAction::ALLOW || action == RuleAction::RATE_LIMIT;
+    }
+
+    // Reader side of QSBR, called from the worker lcores (no-ops without RCU)
+    void register_reader(unsigned reader_id) const;
+    void unregister_reader(unsigned reader_id) const;
+
+    inline void reader_online(unsigned reader_id) const {
+        if (_qsbr) {
+            rte_rcu_qsbr_thread_online(_qsbr, reader_id);
+        }
+    }
+
+    inline void reader_offline(unsigned reader_id) const {
+        if (_qsbr) {
+            rte_rcu_qsbr_thread_offline(_qsbr, reader_id);
+        }
+    }
+
+    inline void reader_quiescent(unsigned reader_id) const {
+        if (_qsbr) {
+            rte_rcu_qsbr_quiescent(_qsbr, reader_id);
+        }
+    }
 
 private:
-    typedef struct Rule {
-        std::optional<uint32_t> ip;
-        std::optional<uint16_t> port;
-        bool block;
-        std::string comment;
-    } Rule_t;
-
-    std::vector<Rule_t> _rules;
+    void publish(dpdk_rule_set* rule_set);
+
+    std::atomic<const dpdk_rule_set*> _active;
+    rte_rcu_qsbr* _qsbr;
+
+    std::string _rule_path;
+    std::filesystem::file_time_type _rule_mtime;
+    SnapshotMemory _snapshot_memory;
+    double _prefilter_rate;
+    std::string _rule_stats_path;
+    uint64_t _next_generation;
 };
 
 #endif // DPDK_FASTDROP_AGENT_DPDK_PACKET_FILTER_H
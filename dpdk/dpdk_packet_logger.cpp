@@ -0,0 +1,125 @@
+#include "dpdk_packet_logger.h"
+
+#include <chrono>
+#include <rte_errno.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk_rule_classifier.h"
+
+namespace {
+    constexpr const char* reason_names[] = {"allowed", "blocked", "rate_limited", "parse_failed"};
+}
+
+dpdk_packet_logger::dpdk_packet_logger()
+    : _rings{}
+    , _running(false) {
+
+}
+
+dpdk_packet_logger::~dpdk_packet_logger() {
+    stop();
+    for (auto& ring : _rings) {
+        rte_ring_free(ring);
+        ring = nullptr;
+    }
+}
+
+rte_ring* dpdk_packet_logger::create_ring(unsigned lcore_id, uint32_t size, int socket_id) {
+    if (lcore_id >= RTE_MAX_LCORE) {
+        return nullptr;
+    }
+
+    if (!_rings[lcore_id]) {
+        const std::string name = "packet_log_" + std::to_string(lcore_id);
+        _rings[lcore_id] = rte_ring_create_elem(name.c_str(), sizeof(PacketLogRecord_t), rte_align32pow2(size),
+                                                socket_id, RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!_rings[lcore_id]) {
+            spdlog::error("Failed to create packet log ring for lcore {}: {}", lcore_id, rte_strerror(rte_errno));
+        }
+    }
+    return _rings[lcore_id];
+}
+
+void dpdk_packet_logger::start() {
+    if (_running.exchange(true)) {
+        return;
+    }
+    _thread = std::thread(&dpdk_packet_logger::run, this);
+}
+
+void dpdk_packet_logger::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    // Whatever the workers managed to enqueue before they stopped
+    drain();
+}
+
+bool dpdk_packet_logger::parse_reasons(const std::vector<std::string>& names, uint32_t& mask) {
+    mask = 0;
+    for (const auto& name : names) {
+        bool known = false;
+        for (size_t reason = 0; reason < std::size(reason_names); reason++) {
+            if (name == reason_names[reason]) {
+                mask |= 1u << reason;
+                known = true;
+            }
+        }
+        if (!known) {
+            spdlog::error("Unknown packet log reason '{}'", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* dpdk_packet_logger::reason_name(LogReason reason) {
+    const auto index = static_cast<size_t>(reason);
+    return index < std::size(reason_names) ? reason_names[index] : "unknown";
+}
+
+void dpdk_packet_logger::run() {
+    while (_running.load(std::memory_order_relaxed)) {
+        if (drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+size_t dpdk_packet_logger::drain() {
+    PacketLogRecord_t records[DRAIN_BURST];
+    size_t total = 0;
+
+    for (rte_ring* ring : _rings) {
+        if (!ring) {
+            continue;
+        }
+        // One burst per ring per pass, so a busy lcore can not starve the others
+        const unsigned count = rte_ring_sc_dequeue_burst_elem(ring, records, sizeof(PacketLogRecord_t),
+                                                              DRAIN_BURST, nullptr);
+        for (unsigned i = 0; i < count; i++) {
+            format(records[i]);
+        }
+        total += count;
+    }
+    return total;
+}
+
+void dpdk_packet_logger::format(const PacketLogRecord_t& record) {
+    if (record.result == dpdk_rule_classifier::NO_MATCH) {
+        spdlog::info("[lcore {}] {} packet, {} bytes, no rule matched",
+                     record.lcore_id, reason_name(record.reason), record.pkt_len);
+    } else {
+        spdlog::info("[lcore {}] {} packet, {} bytes, rule #{}",
+                     record.lcore_id, reason_name(record.reason), record.pkt_len,
+                     dpdk_rule_classifier::rule_id(record.result));
+    }
+
+    _packet_parser.print_packet_hex_ascii(record.snap, record.snap_len);
+    if (_packet_parser.parse(record.snap, record.snap_len)) {
+        _packet_parser.print_summary();
+    }
+}
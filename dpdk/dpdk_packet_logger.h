@@ -0,0 +1,47 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_PACKET_LOGGER_H
+#define DPDK_FASTDROP_AGENT_DPDK_PACKET_LOGGER_H
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rte_lcore.h>
+#include <rte_ring.h>
+
+#include "dpdk_log_sampler.h"
+#include "dpdk_packet_parser.h"
+
+// Control side of the sampled packet log: owns one SP/SC ring per worker lcore and a
+// plain thread (not an lcore) that drains them and does all the formatting with spdlog.
+class dpdk_packet_logger {
+public:
+    explicit dpdk_packet_logger();
+    virtual ~dpdk_packet_logger();
+
+    rte_ring* create_ring(unsigned lcore_id, uint32_t size, int socket_id);
+    void start();
+    void stop();
+
+    // "allowed", "blocked", "rate_limited", "parse_failed"
+    static bool parse_reasons(const std::vector<std::string>& names, uint32_t& mask);
+    static const char* reason_name(LogReason reason);
+
+private:
+    static constexpr unsigned DRAIN_BURST = 32;
+
+    void run();
+    size_t drain();
+    void format(const PacketLogRecord_t& record);
+
+    std::array<rte_ring*, RTE_MAX_LCORE> _rings;
+    std::thread _thread;
+    std::atomic<bool> _running;
+
+    // Only touched by the logging thread
+    dpdk_packet_parser _packet_parser;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_PACKET_LOGGER_H
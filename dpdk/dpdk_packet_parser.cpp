@@ -2,10 +2,15 @@
 #include <sstream>
 #include <iomanip>
 #include <cctype>
+#include <cstring>
 #include <arpa/inet.h>
+#include <rte_prefetch.h>
 
 dpdk_packet_parser::dpdk_packet_parser()
-    : _network_proto(NetworkProtocol::NONE)
+    : _decapsulate(false)
+    , _rx_ptype(false)
+    , _rx_checksum(false)
+    , _network_proto(NetworkProtocol::NONE)
     , _l4_proto(L4Protocol::NONE)
     , _data(nullptr)
     , _len(0) {
@@ -16,6 +21,15 @@ dpdk_packet_parser::~dpdk_packet_parser() {
 
 }
 
+void dpdk_packet_parser::set_decapsulate(bool decapsulate) {
+    _decapsulate = decapsulate;
+}
+
+void dpdk_packet_parser::set_rx_metadata(bool ptype, bool checksum) {
+    _rx_ptype = ptype;
+    _rx_checksum = checksum;
+}
+
 std::string dpdk_packet_parser::mac_to_string(const uint8_t* mac) const {
     std::stringstream ss;
     ss << std::uppercase;
@@ -26,10 +40,21 @@ std::string dpdk_packet_parser::mac_to_string(const uint8_t* mac) const {
     return ss.str();
 }
 
-const uint8_t* dpdk_packet_parser::skip_ipv6_extension_headers(const uint8_t* data, uint16_t total_len, uint8_t& next_header, uint16_t& header_len) const {
+FragmentType dpdk_packet_parser::ipv4_fragment(const ipv4_hdr* ip4) {
+    const uint16_t frag_field = ntohs(ip4->fragment_offset);
+    if (frag_field & 0x1FFF) {
+        return FragmentType::LATER;
+    }
+    return (frag_field & 0x2000) ? FragmentType::FIRST : FragmentType::NONE;   // MF flag
+}
+
+const uint8_t* dpdk_packet_parser::skip_ipv6_extension_headers(const uint8_t* data, uint16_t total_len, uint8_t& next_header, uint16_t& header_len,
+                                                               FragmentType& fragment, uint32_t& frag_id) const {
     const uint8_t* ptr = data;
     uint16_t offset = sizeof(ipv6_hdr);
     next_header = reinterpret_cast<const ipv6_hdr*>(data)->next_header;
+    fragment = FragmentType::NONE;
+    frag_id = 0;
 
     int max_extensions = 8;
 
@@ -58,11 +83,21 @@ const uint8_t* dpdk_packet_parser::skip_ipv6_extension_headers(const uint8_t* da
                 if (offset + 8 > total_len) {
                     return nullptr;
                 }
-                const ipv6_ext_hdr* frag_hdr = reinterpret_cast<const ipv6_ext_hdr*>(ptr + offset);
+                const ipv6_frag_hdr* frag_hdr = reinterpret_cast<const ipv6_frag_hdr*>(ptr + offset);
                 next_header = frag_hdr->next_header;
                 offset += 8;
-                if (offset > total_len) {
-                    return nullptr;
+
+                const uint16_t frag_data = ntohs(frag_hdr->frag_data);
+                if (frag_data & 0xFFF8) {
+                    // Later fragment: what follows is payload, not the next header
+                    fragment = FragmentType::LATER;
+                    frag_id = ntohl(frag_hdr->id);
+                    header_len = offset;
+                    return ptr + offset;
+                }
+                if (frag_data & 0x0001) {   // M flag on offset 0
+                    fragment = FragmentType::FIRST;
+                    frag_id = ntohl(frag_hdr->id);
                 }
                 break;
             }
@@ -84,6 +119,14 @@ bool dpdk_packet_parser::parse(const uint8_t* data, uint16_t len) {
     _eth = reinterpret_cast<const ether_hdr*>(data);
 
     uint16_t eth_type = ntohs(_eth->ether_type);
+    uint16_t l3_offset = sizeof(ether_hdr);
+
+    // Tagged frames are logged by their payload, tunnels by their outer header
+    for (uint8_t tags = 0; tags < MAX_VLAN_TAGS && is_vlan_ether_type(eth_type); tags++) {
+        if (len < l3_offset + sizeof(vlan_hdr)) return false;
+        eth_type = ntohs(reinterpret_cast<const vlan_hdr*>(data + l3_offset)->ether_type);
+        l3_offset += sizeof(vlan_hdr);
+    }
 
     _ip4 = nullptr;
     _ip6 = nullptr;
@@ -92,19 +135,23 @@ bool dpdk_packet_parser::parse(const uint8_t* data, uint16_t len) {
     _network_proto = NetworkProtocol::NONE;
     _l4_proto = L4Protocol::NONE;
 
-    if (eth_type == 0x86DD) { // IPv6
-        if (len < sizeof(ether_hdr) + sizeof(ipv6_hdr)) return false;
-        _ip6 = reinterpret_cast<const ipv6_hdr*>(data + sizeof(ether_hdr));
+    if (eth_type == ETHER_TYPE_IPV6) { // IPv6
+        if (len < l3_offset + sizeof(ipv6_hdr)) return false;
+        _ip6 = reinterpret_cast<const ipv6_hdr*>(data + l3_offset);
         _network_proto = NetworkProtocol::IPv6;
 
         uint8_t next_header;
         uint16_t l4_offset = 0;
-        const uint8_t* l4_ptr = skip_ipv6_extension_headers(data + sizeof(ether_hdr), len - sizeof(ether_hdr), next_header, l4_offset);
+        FragmentType fragment;
+        uint32_t frag_id;
+        const uint8_t* l4_ptr = skip_ipv6_extension_headers(data + l3_offset, len - l3_offset, next_header, l4_offset,
+                                                            fragment, frag_id);
         if (!l4_ptr) return false;
 
-        uint16_t l4_len = len - (sizeof(ether_hdr) + l4_offset);
+        uint16_t l4_len = len - (l3_offset + l4_offset);
 
-        switch (next_header) {
+        // A non-first fragment has no L4 header, its payload must not be read as ports
+        switch (fragment == FragmentType::LATER ? 0 : next_header) {
             case 6: // TCP
                 if (l4_len >= sizeof(tcp_hdr)) {
                     _tcp = reinterpret_cast<const tcp_hdr*>(l4_ptr);
@@ -121,20 +168,22 @@ bool dpdk_packet_parser::parse(const uint8_t* data, uint16_t len) {
                 _l4_proto = L4Protocol::OTHER;
                 break;
         }
-    } else if (eth_type == 0x0800) { // IPv4
-        if (len < sizeof(ether_hdr) + sizeof(ipv4_hdr)) return false;
-        _ip4 = reinterpret_cast<const ipv4_hdr*>(data + sizeof(ether_hdr));
+    } else if (eth_type == ETHER_TYPE_IPV4) { // IPv4
+        if (len < l3_offset + sizeof(ipv4_hdr)) return false;
+        _ip4 = reinterpret_cast<const ipv4_hdr*>(data + l3_offset);
         _network_proto = NetworkProtocol::IPv4;
 
         uint8_t ihl = _ip4->version_ihl & 0x0F;
         uint16_t ip_header_len = ihl * 4;
-        if (len < sizeof(ether_hdr) + ip_header_len) return false;
+        if (len < l3_offset + ip_header_len) return false;
 
         uint8_t next_proto = _ip4->next_proto_id;
-        const uint8_t* l4_ptr = data + sizeof(ether_hdr) + ip_header_len;
-        uint16_t l4_len = len - (sizeof(ether_hdr) + ip_header_len);
+        const uint8_t* l4_ptr = data + l3_offset + ip_header_len;
+        uint16_t l4_len = len - (l3_offset + ip_header_len);
 
-        if (next_proto == 6 && l4_len >= sizeof(tcp_hdr)) {  // TCP
+        if (ipv4_fragment(_ip4) == FragmentType::LATER) {
+            _l4_proto = L4Protocol::OTHER;
+        } else if (next_proto == 6 && l4_len >= sizeof(tcp_hdr)) {  // TCP
             _tcp = reinterpret_cast<const tcp_hdr*>(l4_ptr);
             _l4_proto = L4Protocol::TCP;
         } else if (next_proto == 17 && l4_len >= sizeof(udp_hdr)) { // UDP
@@ -151,6 +200,388 @@ bool dpdk_packet_parser::parse(const uint8_t* data, uint16_t len) {
     return true;
 }
 
+ParseStatus dpdk_packet_parser::skip_l2_headers(const uint8_t* data, uint16_t len, uint16_t& offset, uint16_t& eth_type,
+                                                FlowKeyBurst_t& keys, uint16_t idx) const {
+    // 802.1Q / 802.1ad (QinQ) tags, the outermost one scopes the packet
+    for (uint8_t tags = 0; tags < MAX_VLAN_TAGS && is_vlan_ether_type(eth_type); tags++) {
+        if (offset + sizeof(vlan_hdr) > len) {
+            return ParseStatus::TRUNCATED;
+        }
+        const auto* vlan = reinterpret_cast<const vlan_hdr*>(data + offset);
+        if (keys.vlan[idx] == 0) {
+            keys.vlan[idx] = FLOW_KEY_VLAN_PRESENT | (ntohs(vlan->tci) & 0x0FFF);
+        }
+        eth_type = ntohs(vlan->ether_type);
+        offset += sizeof(vlan_hdr);
+    }
+    // A deeper stack would hide the IP header from every address rule
+    if (is_vlan_ether_type(eth_type)) {
+        return ParseStatus::MALFORMED;
+    }
+
+    if (eth_type != ETHER_TYPE_MPLS && eth_type != ETHER_TYPE_MPLS_MC) {
+        return ParseStatus::OK;
+    }
+
+    // MPLS carries no payload type: pop to the bottom of the stack and look at the IP version
+    for (uint8_t labels = 0; labels < MAX_MPLS_LABELS; labels++) {
+        if (offset + sizeof(uint32_t) + 1 > len) {
+            return ParseStatus::TRUNCATED;
+        }
+        const bool bottom_of_stack = data[offset + 2] & 0x01;
+        offset += sizeof(uint32_t);
+        if (bottom_of_stack) {
+            const uint8_t version = data[offset] >> 4;
+            if (version != 4 && version != 6) {
+                return ParseStatus::MALFORMED;  // pseudowires and the like carry no address to match
+            }
+            eth_type = version == 4 ? ETHER_TYPE_IPV4 : ETHER_TYPE_IPV6;
+            return ParseStatus::OK;
+        }
+    }
+    return ParseStatus::MALFORMED;  // deeper label stacks are not walked
+}
+
+ParseStatus dpdk_packet_parser::parse_l3_l4(const uint8_t* data, uint16_t len, uint16_t eth_type, FlowKeyBurst_t& keys,
+                                            uint16_t idx, const uint8_t*& l4_ptr, uint16_t& l4_len) const {
+    keys.family[idx] = NetworkProtocol::NONE;
+    keys.proto[idx] = 0;
+    keys.tcp_flags[idx] = 0;
+    keys.fragment[idx] = FragmentType::NONE;
+    keys.frag_id[idx] = 0;
+    keys.src_port[idx] = 0;
+    keys.dst_port[idx] = 0;
+    keys.src_addr[idx].u64[0] = keys.src_addr[idx].u64[1] = 0;
+    keys.dst_addr[idx].u64[0] = keys.dst_addr[idx].u64[1] = 0;
+
+    uint8_t l4_proto = 0;
+    uint16_t ip4_frag_offset = 0;
+
+    if (eth_type == ETHER_TYPE_IPV4) {
+        if (len < sizeof(ipv4_hdr)) {
+            return ParseStatus::TRUNCATED;
+        }
+        const auto* ip4 = reinterpret_cast<const ipv4_hdr*>(data);
+        const uint16_t ip_header_len = (ip4->version_ihl & 0x0F) * 4;
+        if (ip_header_len < sizeof(ipv4_hdr)) {
+            return ParseStatus::MALFORMED;
+        }
+        if (len < ip_header_len) {
+            return ParseStatus::TRUNCATED;
+        }
+
+        keys.family[idx] = NetworkProtocol::IPv4;
+        keys.src_addr[idx].v4 = ip4->src_addr;
+        keys.dst_addr[idx].v4 = ip4->dst_addr;
+        keys.fragment[idx] = ipv4_fragment(ip4);
+        keys.frag_id[idx] = ntohs(ip4->packet_id);
+        ip4_frag_offset = ntohs(ip4->fragment_offset) & 0x1FFF;
+
+        l4_proto = ip4->next_proto_id;
+        l4_ptr = data + ip_header_len;
+        l4_len = len - ip_header_len;
+    } else if (eth_type == ETHER_TYPE_IPV6) {
+        if (len < sizeof(ipv6_hdr)) {
+            return ParseStatus::TRUNCATED;
+        }
+        const auto* ip6 = reinterpret_cast<const ipv6_hdr*>(data);
+
+        keys.family[idx] = NetworkProtocol::IPv6;
+        std::memcpy(keys.src_addr[idx].v6, ip6->src_addr, sizeof(ip6->src_addr));
+        std::memcpy(keys.dst_addr[idx].v6, ip6->dst_addr, sizeof(ip6->dst_addr));
+
+        uint16_t l4_offset = 0;
+        l4_ptr = skip_ipv6_extension_headers(data, len, l4_proto, l4_offset, keys.fragment[idx], keys.frag_id[idx]);
+        if (!l4_ptr) {
+            return ParseStatus::MALFORMED;
+        }
+        l4_len = len - l4_offset;
+    } else {
+        return ParseStatus::OK;
+    }
+
+    keys.proto[idx] = l4_proto;
+    if (keys.fragment[idx] == FragmentType::LATER) {
+        // RFC 1858: an offset of 8 bytes can only serve to rewrite the TCP flags of the first fragment
+        if (l4_proto == 6 && ip4_frag_offset == 1) {
+            return ParseStatus::MALFORMED;
+        }
+        return ParseStatus::OK;
+    }
+    if (keys.fragment[idx] == FragmentType::FIRST &&
+        ((l4_proto == 6 && l4_len < sizeof(tcp_hdr)) || (l4_proto == 17 && l4_len < sizeof(udp_hdr)))) {
+        // Tiny first fragment: the ports would only show up in a later fragment
+        return ParseStatus::MALFORMED;
+    }
+    if (l4_proto == 6 && l4_len >= sizeof(tcp_hdr)) { // TCP
+        const auto* tcp = reinterpret_cast<const tcp_hdr*>(l4_ptr);
+        keys.src_port[idx] = ntohs(tcp->src_port);
+        keys.dst_port[idx] = ntohs(tcp->dst_port);
+        keys.tcp_flags[idx] = tcp->flags;
+    } else if (l4_proto == 17 && l4_len >= sizeof(udp_hdr)) { // UDP
+        const auto* udp = reinterpret_cast<const udp_hdr*>(l4_ptr);
+        keys.src_port[idx] = ntohs(udp->src_port);
+        keys.dst_port[idx] = ntohs(udp->dst_port);
+    }
+    return ParseStatus::OK;
+}
+
+bool dpdk_packet_parser::enter_tunnel(const uint8_t* data, uint16_t len, const uint8_t* l4_ptr, uint16_t l4_len,
+                                      FlowKeyBurst_t& keys, uint16_t idx, uint16_t& offset, uint16_t& eth_type) const {
+    uint16_t header_len = 0;
+    uint16_t inner_type = ETHER_TYPE_TEB;
+    uint32_t vni = 0;
+
+    if (keys.proto[idx] == 17 && keys.dst_port[idx] == VXLAN_PORT) {
+        header_len = sizeof(udp_hdr) + sizeof(vxlan_hdr);
+        if (l4_len < header_len) {
+            return false;
+        }
+        const auto* vxlan = reinterpret_cast<const vxlan_hdr*>(l4_ptr + sizeof(udp_hdr));
+        if (!(vxlan->flags & 0x08)) {   // I flag: VNI valid
+            return false;
+        }
+        vni = ntohl(vxlan->vni_reserved) >> 8;
+    } else if (keys.proto[idx] == 17 && keys.dst_port[idx] == GENEVE_PORT) {
+        if (l4_len < sizeof(udp_hdr) + sizeof(geneve_hdr)) {
+            return false;
+        }
+        const auto* geneve = reinterpret_cast<const geneve_hdr*>(l4_ptr + sizeof(udp_hdr));
+        if (geneve->ver_opt_len >> 6) {
+            return false;
+        }
+        header_len = sizeof(udp_hdr) + sizeof(geneve_hdr) + (geneve->ver_opt_len & 0x3F) * 4;
+        inner_type = ntohs(geneve->protocol);
+        vni = ntohl(geneve->vni_reserved) >> 8;
+    } else if (keys.proto[idx] == 47) { // GRE
+        if (l4_len < sizeof(gre_hdr)) {
+            return false;
+        }
+        const auto* gre = reinterpret_cast<const gre_hdr*>(l4_ptr);
+        const uint16_t flags = ntohs(gre->flags_version);
+        if (flags & 0x0007) {   // version 1 is PPTP, not a plain encapsulation
+            return false;
+        }
+        header_len = sizeof(gre_hdr);
+        if (flags & 0x8000) {   // checksum present
+            header_len += 4;
+        }
+        if (flags & 0x2000) {   // key present: NVGRE keeps its 24-bit VSID in the upper bits
+            if (l4_len < header_len + 4) {
+                return false;
+            }
+            uint32_t key;
+            std::memcpy(&key, l4_ptr + header_len, sizeof(key));
+            vni = ntohl(key) >> 8;
+            header_len += 4;
+        }
+        if (flags & 0x1000) {   // sequence number present
+            header_len += 4;
+        }
+        inner_type = ntohs(gre->protocol);
+    } else {
+        return false;
+    }
+
+    if (l4_len < header_len) {
+        return false;
+    }
+    offset = static_cast<uint16_t>(l4_ptr - data) + header_len;
+
+    if (inner_type == ETHER_TYPE_TEB) {
+        if (offset + sizeof(ether_hdr) > len) {
+            return false;
+        }
+        inner_type = ntohs(reinterpret_cast<const ether_hdr*>(data + offset)->ether_type);
+        offset += sizeof(ether_hdr);
+    } else if (inner_type != ETHER_TYPE_IPV4 && inner_type != ETHER_TYPE_IPV6) {
+        return false;
+    }
+
+    eth_type = inner_type;
+    keys.vni[idx] = FLOW_KEY_VNI_PRESENT | vni;
+    return true;
+}
+
+ParseStatus dpdk_packet_parser::parse_flow_key(const uint8_t* data, uint16_t len, FlowKeyBurst_t& keys, uint16_t idx,
+                                               TunnelKeyBurst_t* tunnels) const {
+    keys.vlan[idx] = 0;
+    keys.vni[idx] = 0;
+
+    if (len < sizeof(ether_hdr)) {
+        keys.family[idx] = NetworkProtocol::NONE;
+        return ParseStatus::TRUNCATED;
+    }
+
+    const auto* eth = reinterpret_cast<const ether_hdr*>(data);
+    uint16_t eth_type = ntohs(eth->ether_type);
+    uint16_t offset = sizeof(ether_hdr);
+
+    for (uint8_t depth = 0;; depth++) {
+        // Plain untagged IP skips the L2 walk entirely
+        if (unlikely(eth_type != ETHER_TYPE_IPV4 && eth_type != ETHER_TYPE_IPV6)) {
+            const ParseStatus status = skip_l2_headers(data, len, offset, eth_type, keys, idx);
+            if (status != ParseStatus::OK) {
+                keys.family[idx] = NetworkProtocol::NONE;
+                return status;
+            }
+        }
+
+        const uint8_t* l4_ptr = nullptr;
+        uint16_t l4_len = 0;
+        const ParseStatus status = parse_l3_l4(data + offset, len - offset, eth_type, keys, idx, l4_ptr, l4_len);
+
+        // Fragmented outer packets stay on the outer tuple, the fragment table keys on it
+        if (status != ParseStatus::OK || !_decapsulate || depth == MAX_TUNNEL_DEPTH ||
+            keys.fragment[idx] != FragmentType::NONE || !l4_ptr) {
+            return status;
+        }
+        if (likely(keys.proto[idx] != 47 && keys.dst_port[idx] != VXLAN_PORT && keys.dst_port[idx] != GENEVE_PORT)) {
+            return status;
+        }
+        const uint32_t outer_vni = keys.vni[idx];
+        if (!enter_tunnel(data, len, l4_ptr, l4_len, keys, idx, offset, eth_type)) {
+            return status;
+        }
+
+        // Keep the headers being stepped over, the inner parse overwrites them in keys
+        if (tunnels) {
+            FlowKeyBurst_t& outer = tunnels->keys;
+            if (outer.count == FLOW_KEY_BURST_MAX) {
+                keys.family[idx] = NetworkProtocol::NONE;
+                return ParseStatus::MALFORMED;
+            }
+            copy_flow_key(keys, idx, outer, outer.count);
+            outer.status[outer.count] = ParseStatus::OK;
+            outer.vni[outer.count] = outer_vni;
+            tunnels->packet[outer.count++] = static_cast<uint8_t>(idx);
+        }
+    }
+}
+
+bool dpdk_packet_parser::parse_flow_key_ptype(const rte_mbuf* pkt, FlowKeyBurst_t& keys, uint16_t idx) const {
+    const uint32_t ptype = pkt->packet_type;
+    // Tunnels, fragments, IPv6 extension headers, MPLS and anything unclassified take the byte walk
+    if (ptype & (RTE_PTYPE_TUNNEL_MASK | RTE_PTYPE_INNER_L2_MASK)) {
+        return false;
+    }
+
+    uint16_t l2_len;
+    switch (ptype & RTE_PTYPE_L2_MASK) {
+        case RTE_PTYPE_L2_ETHER: l2_len = sizeof(ether_hdr); break;
+        case RTE_PTYPE_L2_ETHER_VLAN: l2_len = sizeof(ether_hdr) + sizeof(vlan_hdr); break;
+        case RTE_PTYPE_L2_ETHER_QINQ: l2_len = sizeof(ether_hdr) + 2 * sizeof(vlan_hdr); break;
+        default: return false;
+    }
+
+    const uint32_t l3_type = ptype & RTE_PTYPE_L3_MASK;
+    uint16_t l3_len;
+    if (l3_type == RTE_PTYPE_L3_IPV4) {
+        l3_len = sizeof(ipv4_hdr);  // RTE_PTYPE_L3_IPV4 guarantees no options
+    } else if (l3_type == RTE_PTYPE_L3_IPV6) {
+        l3_len = sizeof(ipv6_hdr);  // and RTE_PTYPE_L3_IPV6 no extension headers
+    } else {
+        return false;
+    }
+    // Offsets come from packet_type alone: mbuf l2_len/l3_len are TX offload fields that RX
+    // PMDs do not reset, so a recycled mbuf may still carry another packet's lengths
+
+    const uint32_t l4_type = ptype & RTE_PTYPE_L4_MASK;
+    uint16_t l4_len;
+    if (l4_type == RTE_PTYPE_L4_TCP) {
+        l4_len = sizeof(tcp_hdr);
+    } else if (l4_type == RTE_PTYPE_L4_UDP) {
+        l4_len = sizeof(udp_hdr);
+    } else {
+        return false;
+    }
+    if (l2_len + l3_len + l4_len > rte_pktmbuf_data_len(pkt)) {
+        return false;   // the byte walk reports the truncation
+    }
+
+    const uint8_t* data = rte_pktmbuf_mtod(pkt, const uint8_t*);
+    const uint8_t* l3 = data + l2_len;
+    const uint8_t* l4 = l3 + l3_len;
+
+    if (l3_type == RTE_PTYPE_L3_IPV4) {
+        const auto* ip4 = reinterpret_cast<const ipv4_hdr*>(l3);
+        keys.family[idx] = NetworkProtocol::IPv4;
+        keys.src_addr[idx].u64[0] = keys.src_addr[idx].u64[1] = 0;
+        keys.dst_addr[idx].u64[0] = keys.dst_addr[idx].u64[1] = 0;
+        keys.src_addr[idx].v4 = ip4->src_addr;
+        keys.dst_addr[idx].v4 = ip4->dst_addr;
+    } else {
+        const auto* ip6 = reinterpret_cast<const ipv6_hdr*>(l3);
+        keys.family[idx] = NetworkProtocol::IPv6;
+        std::memcpy(keys.src_addr[idx].v6, ip6->src_addr, sizeof(ip6->src_addr));
+        std::memcpy(keys.dst_addr[idx].v6, ip6->dst_addr, sizeof(ip6->dst_addr));
+    }
+
+    // TCP and UDP share the port layout
+    const auto* ports = reinterpret_cast<const udp_hdr*>(l4);
+    keys.src_port[idx] = ntohs(ports->src_port);
+    keys.dst_port[idx] = ntohs(ports->dst_port);
+    if (l4_type == RTE_PTYPE_L4_TCP) {
+        keys.proto[idx] = 6;
+        keys.tcp_flags[idx] = reinterpret_cast<const tcp_hdr*>(l4)->flags;
+    } else {
+        keys.proto[idx] = 17;
+        keys.tcp_flags[idx] = 0;
+        // A PMD without tunnel ptypes reports VXLAN and Geneve as plain UDP
+        if (_decapsulate && (keys.dst_port[idx] == VXLAN_PORT || keys.dst_port[idx] == GENEVE_PORT)) {
+            return false;
+        }
+    }
+
+    keys.fragment[idx] = FragmentType::NONE;
+    keys.frag_id[idx] = 0;
+    keys.vlan[idx] = l2_len > sizeof(ether_hdr)
+            ? FLOW_KEY_VLAN_PRESENT | (ntohs(reinterpret_cast<const vlan_hdr*>(data + sizeof(ether_hdr))->tci) & 0x0FFF)
+            : 0;
+    keys.vni[idx] = 0;
+    return true;
+}
+
+uint16_t dpdk_packet_parser::parse_burst(rte_mbuf* const* pkts, uint16_t count, FlowKeyBurst_t& keys,
+                                         TunnelKeyBurst_t* tunnels) const {
+    constexpr uint16_t prefetch_offset = 4;
+    if (count > FLOW_KEY_BURST_MAX) {
+        count = FLOW_KEY_BURST_MAX;
+    }
+    if (tunnels) {
+        tunnels->keys.count = 0;
+    }
+
+    for (uint16_t i = 0; i < count && i < prefetch_offset; i++) {
+        rte_prefetch0(rte_pktmbuf_mtod(pkts[i], void*));
+    }
+
+    uint16_t from_ptype = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (i + prefetch_offset < count) {
+            rte_prefetch0(rte_pktmbuf_mtod(pkts[i + prefetch_offset], void*));
+        }
+
+        // Bad checksums are dropped before any header is looked at
+        if (_rx_checksum && unlikely(has_bad_checksum(pkts[i]))) {
+            keys.family[i] = NetworkProtocol::NONE;
+            keys.status[i] = ParseStatus::BAD_CHECKSUM;
+            continue;
+        }
+        if (_rx_ptype && parse_flow_key_ptype(pkts[i], keys, i)) {
+            keys.status[i] = ParseStatus::OK;
+            from_ptype++;
+            continue;
+        }
+
+        // Headers must sit in the first segment, so bound the walk by data_len
+        const uint8_t* data = rte_pktmbuf_mtod(pkts[i], const uint8_t*);
+        keys.status[i] = parse_flow_key(data, rte_pktmbuf_data_len(pkts[i]), keys, i, tunnels);
+    }
+    keys.count = count;
+    return from_ptype;
+}
+
 void dpdk_packet_parser::print_packet_hex_ascii(const uint8_t* data, uint16_t len) const {
     constexpr size_t line_width = 16;
     size_t max_len = len < 64 ? len : 64;
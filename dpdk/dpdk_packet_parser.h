@@ -5,8 +5,11 @@
 #include <string>
 #include <netinet/in.h>  // ntohs, ntohl
 #include <arpa/inet.h>   // inet_ntop
+#include <rte_mbuf.h>
 #include <spdlog/spdlog.h>
 
+#include "dpdk_flow_key.h"
+
 // Ethernet header
 struct ether_hdr {
     uint8_t  dst_addr[6];
@@ -44,6 +47,14 @@ struct ipv6_ext_hdr {
     uint8_t hdr_ext_len;    // length in 8-octet units, not including first 8 octets
 } __attribute__((packed));
 
+// IPv6 Fragment header
+struct ipv6_frag_hdr {
+    uint8_t  next_header;
+    uint8_t  reserved;
+    uint16_t frag_data;     // fragment offset (13 bits, 8-octet units), reserved (2 bits), M flag (1 bit)
+    uint32_t id;
+} __attribute__((packed));
+
 // TCP header
 struct tcp_hdr {
     uint16_t src_port;
@@ -65,11 +76,44 @@ struct udp_hdr {
     uint16_t checksum;
 } __attribute__((packed));
 
-enum class NetworkProtocol {
-    NONE,
-    IPv4,
-    IPv6
-};
+// 802.1Q / 802.1ad tag, follows the MAC addresses in place of the EtherType
+struct vlan_hdr {
+    uint16_t tci;           // PCP (3 bits), DEI (1 bit), VLAN ID (12 bits)
+    uint16_t ether_type;
+} __attribute__((packed));
+
+// VXLAN header (RFC 7348), inner Ethernet frame follows
+struct vxlan_hdr {
+    uint8_t  flags;         // I flag (0x08) set when the VNI is valid
+    uint8_t  reserved[3];
+    uint32_t vni_reserved;  // VNI (24 bits), reserved (8 bits)
+} __attribute__((packed));
+
+// Geneve header (RFC 8926), options and then the protocol_type payload follow
+struct geneve_hdr {
+    uint8_t  ver_opt_len;   // version (2 bits), options length in 4-octet units (6 bits)
+    uint8_t  flags;
+    uint16_t protocol;
+    uint32_t vni_reserved;  // VNI (24 bits), reserved (8 bits)
+} __attribute__((packed));
+
+// GRE base header (RFC 2784/2890), optional checksum, key and sequence words follow
+struct gre_hdr {
+    uint16_t flags_version; // C (0x8000), K (0x2000), S (0x1000), version (3 bits)
+    uint16_t protocol;
+} __attribute__((packed));
+
+constexpr uint16_t ETHER_TYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHER_TYPE_IPV6 = 0x86DD;
+constexpr uint16_t ETHER_TYPE_VLAN = 0x8100;
+constexpr uint16_t ETHER_TYPE_QINQ = 0x88A8;
+constexpr uint16_t ETHER_TYPE_QINQ_OLD = 0x9100;
+constexpr uint16_t ETHER_TYPE_MPLS = 0x8847;
+constexpr uint16_t ETHER_TYPE_MPLS_MC = 0x8848;
+constexpr uint16_t ETHER_TYPE_TEB = 0x6558;     // transparent Ethernet bridging (NVGRE, Geneve)
+
+constexpr uint16_t VXLAN_PORT = 4789;
+constexpr uint16_t GENEVE_PORT = 6081;
 
 enum class L4Protocol {
     NONE,
@@ -83,7 +127,18 @@ public:
     explicit dpdk_packet_parser();
     virtual ~dpdk_packet_parser();
 
+    // Whether parse_burst looks through VXLAN, Geneve and GRE to the inner 5-tuple (off by default)
+    void set_decapsulate(bool decapsulate);
+    // Whether parse_burst trusts the PMD's packet_type and RX checksum flags (off by default)
+    void set_rx_metadata(bool ptype, bool checksum);
+
     bool parse(const uint8_t* data, uint16_t len);
+    // Extracts flow keys for a whole rx burst without touching member state.
+    // With decapsulation on, callers that classify must pass tunnels and classify those
+    // outer tuples too; a tunnel that no longer fits there fails to parse.
+    // Returns how many packets were parsed from packet_type instead of their bytes.
+    uint16_t parse_burst(rte_mbuf* const* pkts, uint16_t count, FlowKeyBurst_t& keys,
+                         TunnelKeyBurst_t* tunnels = nullptr) const;
     void print_packet_hex_ascii(const uint8_t* data, uint16_t len) const;
     void print_summary() const;
     uint32_t get_src_ip() const;
@@ -92,9 +147,43 @@ public:
     std::string ipv4_to_string(uint32_t ip);
 
 private:
-    const uint8_t* skip_ipv6_extension_headers(const uint8_t* data, uint16_t total_len, uint8_t& next_header, uint16_t& header_len) const;
+    static constexpr uint8_t MAX_VLAN_TAGS = 2;
+    static constexpr uint8_t MAX_MPLS_LABELS = 4;
+    static constexpr uint8_t MAX_TUNNEL_DEPTH = 2;
+
+    static bool is_vlan_ether_type(uint16_t eth_type) {
+        return eth_type == ETHER_TYPE_VLAN || eth_type == ETHER_TYPE_QINQ || eth_type == ETHER_TYPE_QINQ_OLD;
+    }
+
+    ParseStatus parse_flow_key(const uint8_t* data, uint16_t len, FlowKeyBurst_t& keys, uint16_t idx,
+                               TunnelKeyBurst_t* tunnels) const;
+    // Plain Ethernet/VLAN + IPv4/IPv6 + TCP/UDP at the offsets packet_type implies, false to fall back
+    bool parse_flow_key_ptype(const rte_mbuf* pkt, FlowKeyBurst_t& keys, uint16_t idx) const;
+    static inline bool has_bad_checksum(const rte_mbuf* pkt) {
+        const uint64_t flags = pkt->ol_flags;
+        return (flags & RTE_MBUF_F_RX_IP_CKSUM_MASK) == RTE_MBUF_F_RX_IP_CKSUM_BAD ||
+               (flags & RTE_MBUF_F_RX_L4_CKSUM_MASK) == RTE_MBUF_F_RX_L4_CKSUM_BAD ||
+               (flags & RTE_MBUF_F_RX_OUTER_IP_CKSUM_BAD);
+    }
+    // Stops at the Fragment header of a non-first fragment, whose payload is no header at all
+    const uint8_t* skip_ipv6_extension_headers(const uint8_t* data, uint16_t total_len, uint8_t& next_header, uint16_t& header_len,
+                                               FragmentType& fragment, uint32_t& frag_id) const;
+    static FragmentType ipv4_fragment(const ipv4_hdr* ip4);
+    // Walks VLAN tags and an MPLS label stack, leaving offset and eth_type at the L3 header
+    ParseStatus skip_l2_headers(const uint8_t* data, uint16_t len, uint16_t& offset, uint16_t& eth_type,
+                                FlowKeyBurst_t& keys, uint16_t idx) const;
+    // Fills the IP and L4 fields from the L3 header at data; l4_ptr stays null for non-IP
+    ParseStatus parse_l3_l4(const uint8_t* data, uint16_t len, uint16_t eth_type, FlowKeyBurst_t& keys,
+                            uint16_t idx, const uint8_t*& l4_ptr, uint16_t& l4_len) const;
+    // Steps into a VXLAN, Geneve or GRE payload, false when the packet is no tunnel we can enter
+    bool enter_tunnel(const uint8_t* data, uint16_t len, const uint8_t* l4_ptr, uint16_t l4_len,
+                      FlowKeyBurst_t& keys, uint16_t idx, uint16_t& offset, uint16_t& eth_type) const;
     std::string mac_to_string(const uint8_t* mac) const;
 
+    bool _decapsulate;
+    bool _rx_ptype;
+    bool _rx_checksum;
+
     const uint8_t* _data;
     uint16_t _len;
 
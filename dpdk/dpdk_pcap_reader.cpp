@@ -0,0 +1,139 @@
+#include "dpdk_pcap_reader.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+    constexpr uint32_t PCAP_MAGIC_USEC = 0xa1b2c3d4;
+    constexpr uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;
+    constexpr uint32_t PCAP_LINKTYPE_ETHERNET = 1;
+
+    typedef struct PcapFileHeader {
+        uint32_t magic;
+        uint16_t version_major;
+        uint16_t version_minor;
+        int32_t  thiszone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t linktype;
+    } PcapFileHeader_t;
+
+    typedef struct PcapRecordHeader {
+        uint32_t ts_sec;
+        uint32_t ts_frac;
+        uint32_t incl_len;
+        uint32_t orig_len;
+    } PcapRecordHeader_t;
+}
+
+dpdk_pcap_reader::dpdk_pcap_reader()
+    : _map(nullptr)
+    , _map_size(0)
+    , _total_bytes(0) {
+
+}
+
+dpdk_pcap_reader::~dpdk_pcap_reader() {
+    close();
+}
+
+bool dpdk_pcap_reader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        spdlog::error("Failed to open pcap file: {}", path);
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(PcapFileHeader_t)) {
+        spdlog::error("Invalid pcap file: {}", path);
+        ::close(fd);
+        return false;
+    }
+
+    _map_size = static_cast<size_t>(st.st_size);
+    _map = mmap(nullptr, _map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (_map == MAP_FAILED) {
+        spdlog::error("Failed to mmap pcap file: {}", path);
+        _map = nullptr;
+        return false;
+    }
+
+    const auto* base = static_cast<const uint8_t*>(_map);
+    PcapFileHeader_t header{};
+    std::memcpy(&header, base, sizeof(header));
+
+    if (header.magic != PCAP_MAGIC_USEC && header.magic != PCAP_MAGIC_NSEC) {
+        spdlog::error("Unsupported pcap format (magic 0x{:08x}); only native-endian classic pcap is read", header.magic);
+        close();
+        return false;
+    }
+    if (header.linktype != PCAP_LINKTYPE_ETHERNET) {
+        spdlog::error("Unsupported pcap link type {}; Ethernet captures only", header.linktype);
+        close();
+        return false;
+    }
+
+    size_t offset = sizeof(PcapFileHeader_t);
+    while (offset + sizeof(PcapRecordHeader_t) <= _map_size) {
+        PcapRecordHeader_t record{};
+        std::memcpy(&record, base + offset, sizeof(record));
+        offset += sizeof(PcapRecordHeader_t);
+
+        if (offset + record.incl_len > _map_size) {
+            spdlog::warn("Truncated pcap record at offset {}, stopping", offset);
+            break;
+        }
+
+        rte_mbuf mbuf{};
+        mbuf.buf_addr = const_cast<uint8_t*>(base + offset);
+        mbuf.data_off = 0;
+        mbuf.nb_segs = 1;
+        mbuf.data_len = static_cast<uint16_t>(record.incl_len > UINT16_MAX ? UINT16_MAX : record.incl_len);
+        mbuf.pkt_len = mbuf.data_len;
+        _mbufs.push_back(mbuf);
+        _total_bytes += mbuf.pkt_len;
+
+        offset += record.incl_len;
+    }
+
+    // Pointers are taken only after the vector stops growing
+    _packets.reserve(_mbufs.size());
+    for (auto& mbuf : _mbufs) {
+        _packets.push_back(&mbuf);
+    }
+
+    spdlog::info("Loaded {} packets ({} bytes) from {}", _packets.size(), _total_bytes, path);
+    return true;
+}
+
+void dpdk_pcap_reader::close() {
+    _packets.clear();
+    _mbufs.clear();
+    _total_bytes = 0;
+
+    if (_map) {
+        munmap(_map, _map_size);
+        _map = nullptr;
+        _map_size = 0;
+    }
+}
+
+rte_mbuf** dpdk_pcap_reader::packets() {
+    return _packets.data();
+}
+
+size_t dpdk_pcap_reader::count() const {
+    return _packets.size();
+}
+
+uint64_t dpdk_pcap_reader::total_bytes() const {
+    return _total_bytes;
+}
@@ -0,0 +1,35 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_PCAP_READER_H
+#define DPDK_FASTDROP_AGENT_DPDK_PCAP_READER_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <rte_mbuf.h>
+
+// Memory-maps a classic pcap capture and exposes every frame as a read-only,
+// single-segment rte_mbuf pointing into the mapping. No EAL or mempool needed,
+// so offline tools can drive the datapath code with real captures.
+class dpdk_pcap_reader : public std::enable_shared_from_this<dpdk_pcap_reader> {
+public:
+    explicit dpdk_pcap_reader();
+    virtual ~dpdk_pcap_reader();
+
+    bool open(const std::string& path);
+    void close();
+
+    rte_mbuf** packets();
+    size_t count() const;
+    uint64_t total_bytes() const;
+
+private:
+    void* _map;
+    size_t _map_size;
+    std::vector<rte_mbuf> _mbufs;
+    std::vector<rte_mbuf*> _packets;
+    uint64_t _total_bytes;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_PCAP_READER_H
@@ -0,0 +1,324 @@
+#include "dpdk_pipeline.h"
+
+#include <algorithm>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_ethdev.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_pause.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk_worker_context.h"
+
+namespace {
+    constexpr uint16_t stage_burst_size = dpdk_worker_context::BURST_SIZE;
+
+    void free_ring_contents(rte_ring* ring) {
+        rte_mbuf* bufs[stage_burst_size];
+        unsigned count;
+        while ((count = rte_ring_dequeue_burst(ring, reinterpret_cast<void**>(bufs), stage_burst_size, nullptr)) > 0) {
+            rte_pktmbuf_free_bulk(bufs, count);
+        }
+    }
+}
+
+dpdk_pipeline::dpdk_pipeline()
+    : _ring_size(0)
+    , _distribution(PipelineDistribution::SHARED) {
+
+}
+
+dpdk_pipeline::~dpdk_pipeline() {
+    for (rte_ring* ring : _rx_rings) {
+        rte_ring_free(ring);
+    }
+    for (rte_ring* ring : _classifier_rings) {
+        rte_ring_free(ring);
+    }
+    for (rte_ring* ring : _tx_rings) {
+        rte_ring_free(ring);
+    }
+}
+
+bool dpdk_pipeline::parse_mode(const std::string& name, PipelineMode& mode) {
+    if (name == "run_to_completion") {
+        mode = PipelineMode::RUN_TO_COMPLETION;
+    } else if (name == "pipeline") {
+        mode = PipelineMode::PIPELINE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_pipeline::parse_distribution(const std::string& name, PipelineDistribution& distribution) {
+    if (name == "shared") {
+        distribution = PipelineDistribution::SHARED;
+    } else if (name == "flow") {
+        distribution = PipelineDistribution::FLOW;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_pipeline::plan(const std::vector<unsigned>& worker_lcores, uint16_t rx_lcores, uint16_t tx_lcores) {
+    if (rx_lcores == 0 || tx_lcores == 0 || worker_lcores.size() < static_cast<size_t>(rx_lcores) + tx_lcores + 1) {
+        spdlog::error("Pipeline needs {} RX + {} TX + at least 1 classifier lcore, only {} worker lcores",
+                      rx_lcores, tx_lcores, worker_lcores.size());
+        return false;
+    }
+
+    const auto classifier_end = worker_lcores.end() - tx_lcores;
+    _rx_lcores.assign(worker_lcores.begin(), worker_lcores.begin() + rx_lcores);
+    _classifier_lcores.assign(worker_lcores.begin() + rx_lcores, classifier_end);
+    _tx_lcores.assign(classifier_end, worker_lcores.end());
+
+    spdlog::info("Pipeline topology: {} RX, {} classifier, {} TX lcores",
+                 _rx_lcores.size(), _classifier_lcores.size(), _tx_lcores.size());
+    return true;
+}
+
+bool dpdk_pipeline::create_rings(uint32_t ring_size, PipelineDistribution distribution) {
+    _ring_size = rte_align32pow2(ring_size);
+    _distribution = distribution;
+
+    // Each ring lives on the socket of its single producer (RX) or single consumer (classifier, TX)
+    if (_distribution == PipelineDistribution::SHARED) {
+        for (unsigned lcore_id : _rx_lcores) {
+            if (!create_ring("pipeline_rx_", lcore_id, RING_F_SP_ENQ, _rx_rings)) {
+                return false;
+            }
+        }
+    } else {
+        const unsigned flags = RING_F_SC_DEQ | (_rx_lcores.size() == 1 ? RING_F_SP_ENQ : 0);
+        for (unsigned lcore_id : _classifier_lcores) {
+            if (!create_ring("pipeline_cls_", lcore_id, flags, _classifier_rings)) {
+                return false;
+            }
+        }
+    }
+
+    for (unsigned lcore_id : _tx_lcores) {
+        if (!create_ring("pipeline_tx_", lcore_id, RING_F_SC_DEQ, _tx_rings)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dpdk_pipeline::create_ring(const std::string& prefix, unsigned lcore_id, unsigned flags, std::vector<rte_ring*>& rings) {
+    const std::string name = prefix + std::to_string(lcore_id);
+    rte_ring* ring = rte_ring_create(name.c_str(), _ring_size, static_cast<int>(rte_lcore_to_socket_id(lcore_id)), flags);
+    if (!ring) {
+        spdlog::error("Failed to create pipeline ring {}: {}", name, rte_strerror(rte_errno));
+        return false;
+    }
+    rings.push_back(ring);
+    return true;
+}
+
+bool dpdk_pipeline::init_distributors(FlowHash hash, const std::vector<uint8_t>& rss_key, bool decapsulate) {
+    if (_distribution != PipelineDistribution::FLOW) {
+        return true;
+    }
+
+    for (size_t i = 0; i < _rx_lcores.size(); i++) {
+        auto distributor = std::make_unique<dpdk_flow_distributor>();
+        if (!distributor->init(hash, rss_key, _classifier_rings, decapsulate)) {
+            return false;
+        }
+        _distributors.push_back(std::move(distributor));
+    }
+    spdlog::info("Pipeline distributes flows over {} classifier rings ({})", _classifier_rings.size(),
+                 hash == FlowHash::TOEPLITZ ? "toeplitz" : "crc32");
+    return true;
+}
+
+void dpdk_pipeline::attach(dpdk_worker_context& classifier, size_t classifier_index) const {
+    rte_ring* tx_ring = _tx_rings[classifier_index % _tx_rings.size()];
+    if (_distribution == PipelineDistribution::FLOW) {
+        classifier.attach_rings(&_classifier_rings[classifier_index], 1, tx_ring);
+    } else {
+        classifier.attach_rings(_rx_rings.data(), static_cast<uint16_t>(_rx_rings.size()), tx_ring);
+    }
+}
+
+void dpdk_pipeline::launch(uint16_t port_id, const rte_atomic32_t* running) {
+    // Sized up front, the stage lcores hold pointers into it
+    _stages.clear();
+    _stages.reserve(_rx_lcores.size() + _tx_lcores.size());
+
+    for (size_t i = 0; i < _rx_lcores.size(); i++) {
+        rte_ring* ring = i < _rx_rings.size() ? _rx_rings[i] : nullptr;
+        dpdk_flow_distributor* distributor = i < _distributors.size() ? _distributors[i].get() : nullptr;
+        _stages.push_back(StageContext_t{_rx_lcores[i], port_id, static_cast<uint16_t>(i), ring, distributor, running, {}});
+    }
+    for (size_t i = 0; i < _tx_lcores.size(); i++) {
+        _stages.push_back(StageContext_t{_tx_lcores[i], port_id, static_cast<uint16_t>(i), _tx_rings[i], nullptr,
+                                         running, {}});
+    }
+
+    for (size_t i = 0; i < _stages.size(); i++) {
+        auto* stage_fn = i < _rx_lcores.size() ? run_rx_stage : run_tx_stage;
+        rte_eal_remote_launch(stage_fn, &_stages[i], _stages[i].lcore_id);
+    }
+}
+
+int dpdk_pipeline::run_rx_stage(void* arg) {
+    auto* stage = static_cast<StageContext_t*>(arg);
+    PipelineStageStats_t& stats = stage->stats;
+    rte_mbuf* bufs[stage_burst_size];
+
+    spdlog::info("Starting pipeline RX stage on lcore {} with RX queue {}", stage->lcore_id, stage->queue_id);
+    while (rte_atomic32_read(stage->running) != 0) {
+        const uint64_t start = rte_rdtsc();
+        const uint16_t nb_rx = rte_eth_rx_burst(stage->port_id, stage->queue_id, bufs, stage_burst_size);
+        if (nb_rx == 0) {
+            stats.empty_polls++;
+            rte_pause();
+            continue;
+        }
+
+        for (uint16_t i = 0; i < nb_rx; i++) {
+            stats.bytes += rte_pktmbuf_pkt_len(bufs[i]);
+        }
+        stats.packets += nb_rx;
+
+        if (stage->distributor) {
+            stage->distributor->distribute(bufs, nb_rx);
+            stats.busy_cycles += rte_rdtsc() - start;
+            continue;
+        }
+
+        const unsigned enqueued = rte_ring_sp_enqueue_burst(stage->ring, reinterpret_cast<void* const*>(bufs),
+                                                            nb_rx, nullptr);
+        if (unlikely(enqueued < nb_rx)) {
+            rte_pktmbuf_free_bulk(&bufs[enqueued], nb_rx - enqueued);
+            stats.ring_full_drops += nb_rx - enqueued;
+        }
+        stats.busy_cycles += rte_rdtsc() - start;
+    }
+    return 0;
+}
+
+int dpdk_pipeline::run_tx_stage(void* arg) {
+    auto* stage = static_cast<StageContext_t*>(arg);
+    PipelineStageStats_t& stats = stage->stats;
+    rte_mbuf* bufs[stage_burst_size];
+
+    spdlog::info("Starting pipeline TX stage on lcore {} with TX queue {}", stage->lcore_id, stage->queue_id);
+    while (rte_atomic32_read(stage->running) != 0) {
+        const uint64_t start = rte_rdtsc();
+        const unsigned count = rte_ring_sc_dequeue_burst(stage->ring, reinterpret_cast<void**>(bufs),
+                                                         stage_burst_size, nullptr);
+        if (count == 0) {
+            stats.empty_polls++;
+            rte_pause();
+            continue;
+        }
+
+        const uint16_t nb_tx = rte_eth_tx_burst(stage->port_id, stage->queue_id, bufs, static_cast<uint16_t>(count));
+        for (uint16_t i = 0; i < nb_tx; i++) {
+            stats.bytes += rte_pktmbuf_pkt_len(bufs[i]);
+        }
+        stats.packets += nb_tx;
+
+        if (unlikely(nb_tx < count)) {
+            rte_pktmbuf_free_bulk(&bufs[nb_tx], count - nb_tx);
+            stats.tx_full_drops += count - nb_tx;
+        }
+        stats.busy_cycles += rte_rdtsc() - start;
+    }
+    return 0;
+}
+
+void dpdk_pipeline::flush() {
+    for (rte_ring* ring : _rx_rings) {
+        free_ring_contents(ring);
+    }
+    for (rte_ring* ring : _classifier_rings) {
+        free_ring_contents(ring);
+    }
+    for (rte_ring* ring : _tx_rings) {
+        free_ring_contents(ring);
+    }
+}
+
+void dpdk_pipeline::print_report() const {
+    if (_stages.empty()) {
+        return;
+    }
+
+    spdlog::info("==== Pipeline stages ====");
+    for (size_t i = 0; i < _stages.size(); i++) {
+        const StageContext_t& stage = _stages[i];
+        const bool is_rx = i < _rx_lcores.size();
+        spdlog::info("- {} lcore {} (queue {}): {} packets, {} bytes, {} dropped ({}), {} empty polls, {} busy cycles",
+                     is_rx ? "RX" : "TX", stage.lcore_id, stage.queue_id, stage.stats.packets, stage.stats.bytes,
+                     is_rx ? stage.stats.ring_full_drops : stage.stats.tx_full_drops,
+                     is_rx ? "ring full" : "TX queue full", stage.stats.empty_polls, stage.stats.busy_cycles);
+    }
+    print_distribution_report();
+    spdlog::info("=========================");
+}
+
+void dpdk_pipeline::print_distribution_report() const {
+    if (_distributors.empty()) {
+        return;
+    }
+
+    // Summed over all RX stages: the share of packets each classifier was given
+    std::vector<DistributionStats_t> totals(_classifier_lcores.size(), DistributionStats_t{});
+    for (const auto& distributor : _distributors) {
+        const auto& stats = distributor->stats();
+        for (size_t target = 0; target < totals.size(); target++) {
+            totals[target].packets += stats[target].packets;
+            totals[target].ring_full_drops += stats[target].ring_full_drops;
+        }
+    }
+
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    for (const auto& total : totals) {
+        sum += total.packets;
+        max = std::max(max, total.packets);
+    }
+    if (sum == 0) {
+        return;
+    }
+
+    for (size_t target = 0; target < totals.size(); target++) {
+        spdlog::info("- classifier lcore {}: {} packets ({:.1f}%), {} dropped (ring full)", _classifier_lcores[target],
+                     totals[target].packets, 100.0 * totals[target].packets / sum, totals[target].ring_full_drops);
+    }
+    // 1.0 is a perfect spread; N means one classifier got everything
+    const double mean = static_cast<double>(sum) / totals.size();
+    spdlog::info("- flow distribution imbalance (max / mean): {:.2f}", max / mean);
+}
+
+bool dpdk_pipeline::enabled() const {
+    return !_classifier_lcores.empty();
+}
+
+PipelineDistribution dpdk_pipeline::distribution() const {
+    return _distribution;
+}
+
+const std::vector<unsigned>& dpdk_pipeline::rx_lcores() const {
+    return _rx_lcores;
+}
+
+const std::vector<unsigned>& dpdk_pipeline::classifier_lcores() const {
+    return _classifier_lcores;
+}
+
+const std::vector<unsigned>& dpdk_pipeline::tx_lcores() const {
+    return _tx_lcores;
+}
+
+uint32_t dpdk_pipeline::ring_slots() const {
+    return _ring_size * static_cast<uint32_t>(_rx_rings.size() + _classifier_rings.size() + _tx_rings.size());
+}
@@ -0,0 +1,100 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_PIPELINE_H
+#define DPDK_FASTDROP_AGENT_DPDK_PIPELINE_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <rte_atomic.h>
+#include <rte_common.h>
+#include <rte_ring.h>
+
+#include "dpdk_flow_distributor.h"
+
+class dpdk_worker_context;
+
+enum class PipelineMode : uint8_t {
+    RUN_TO_COMPLETION,  // every worker polls its own queue pair end to end
+    PIPELINE            // RX lcores -> rings -> classifier lcores -> rings -> TX lcores
+};
+
+// How RX stage packets reach the classifiers
+enum class PipelineDistribution : uint8_t {
+    SHARED,     // any classifier dequeues from any RX ring, best balance, no flow affinity
+    FLOW        // the RX stage hashes the 5-tuple onto one ring per classifier
+};
+
+typedef struct PipelineStageStats {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t ring_full_drops;   // RX stage: freed because the classifiers fell behind
+    uint64_t tx_full_drops;     // TX stage: freed because the NIC queue was full
+    uint64_t empty_polls;
+    uint64_t busy_cycles;
+} PipelineStageStats_t;
+
+// Optional pipeline topology for ports where one hot RX queue would otherwise pin all
+// the work on a single core. Dedicated RX lcores move whole bursts from their RX queue
+// into an SP/MC ring; any classifier lcore dequeues from any RX ring, so classification
+// scales past the number of queues. Verdicted packets go through an MP/SC ring to a TX
+// lcore that owns a TX queue. Classifiers run the regular worker loop on ring I/O.
+// With shared distribution packets of one flow may be classified on different lcores and
+// leave out of order; flow distribution pins each flow to one classifier and TX ring.
+class dpdk_pipeline {
+public:
+    explicit dpdk_pipeline();
+    virtual ~dpdk_pipeline();
+
+    static bool parse_mode(const std::string& name, PipelineMode& mode);
+    static bool parse_distribution(const std::string& name, PipelineDistribution& distribution);
+
+    // Splits the worker lcores: the first rx_lcores poll, the last tx_lcores transmit, the rest classify
+    bool plan(const std::vector<unsigned>& worker_lcores, uint16_t rx_lcores, uint16_t tx_lcores);
+    bool create_rings(uint32_t ring_size, PipelineDistribution distribution);
+    // Flow distribution only: one distributor per RX lcore, hashing with rss_key
+    bool init_distributors(FlowHash hash, const std::vector<uint8_t>& rss_key, bool decapsulate);
+    void attach(dpdk_worker_context& classifier, size_t classifier_index) const;
+    void launch(uint16_t port_id, const rte_atomic32_t* running);
+    // Frees the mbufs still queued between stages; call once all lcores have stopped
+    void flush();
+    void print_report() const;
+
+    bool enabled() const;
+    PipelineDistribution distribution() const;
+    const std::vector<unsigned>& rx_lcores() const;
+    const std::vector<unsigned>& classifier_lcores() const;
+    const std::vector<unsigned>& tx_lcores() const;
+    uint32_t ring_slots() const;
+
+private:
+    typedef struct StageContext {
+        unsigned lcore_id;
+        uint16_t port_id;
+        uint16_t queue_id;
+        rte_ring* ring;
+        dpdk_flow_distributor* distributor;     // RX stage with flow distribution, ring is unused then
+        const rte_atomic32_t* running;
+        PipelineStageStats_t stats;
+    } __rte_cache_aligned StageContext_t;
+
+    bool create_ring(const std::string& prefix, unsigned lcore_id, unsigned flags, std::vector<rte_ring*>& rings);
+    void print_distribution_report() const;
+
+    static int run_rx_stage(void* arg);
+    static int run_tx_stage(void* arg);
+
+    std::vector<unsigned> _rx_lcores;
+    std::vector<unsigned> _classifier_lcores;
+    std::vector<unsigned> _tx_lcores;
+    std::vector<rte_ring*> _rx_rings;           // shared: one per RX lcore, SP/MC
+    std::vector<rte_ring*> _classifier_rings;   // flow: one per classifier, SC (SP with a single RX lcore)
+    std::vector<rte_ring*> _tx_rings;           // one per TX lcore, MP/SC
+    std::vector<std::unique_ptr<dpdk_flow_distributor>> _distributors;
+    std::vector<StageContext_t> _stages;
+    uint32_t _ring_size;
+    PipelineDistribution _distribution;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_PIPELINE_H
@@ -0,0 +1,169 @@
+#include "dpdk_power_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_ethdev.h>
+#include <rte_interrupts.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+    constexpr const char* idle_state_names[] = {"spin", "pause", "sleep"};
+}
+
+dpdk_power_manager::dpdk_power_manager()
+    : _policy{}
+    , _tsc_hz(0)
+    , _max_spin(0)
+    , _max_pause(0)
+    , _spin_limit(0)
+    , _pause_limit(0)
+    , _gap_ewma(0)
+    , _idle_start(0)
+    , _last_tsc(0)
+    , _ready_since(0)
+    , _state(IdleState::SPIN)
+    , _port_id(0)
+    , _queue_id(0)
+    , _rx_interrupts(false)
+    , _stats{} {
+
+}
+
+dpdk_power_manager::~dpdk_power_manager() {
+
+}
+
+bool dpdk_power_manager::parse_mode(const std::string& name, PowerMode& mode) {
+    if (name == "poll") {
+        mode = PowerMode::POLL;
+    } else if (name == "adaptive") {
+        mode = PowerMode::ADAPTIVE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void dpdk_power_manager::init(uint16_t port_id, uint16_t queue_id, const PowerPolicy_t& policy, bool rx_interrupts,
+                              uint64_t tsc_hz) {
+    _policy = policy;
+    _tsc_hz = tsc_hz;
+    _port_id = port_id;
+    _queue_id = queue_id;
+    _max_spin = tsc_hz / 1000000 * policy.max_spin_us;
+    _max_pause = std::max(_max_spin, tsc_hz / 1000000 * policy.max_pause_us);
+    _spin_limit = _max_spin;
+    _pause_limit = _max_pause;
+    _rx_interrupts = policy.mode == PowerMode::ADAPTIVE && rx_interrupts;
+}
+
+void dpdk_power_manager::register_interrupt() {
+    if (!_rx_interrupts) {
+        return;
+    }
+
+    const int result = rte_eth_dev_rx_intr_ctl_q(_port_id, _queue_id, RTE_EPOLL_PER_THREAD, RTE_INTR_EVENT_ADD, nullptr);
+    if (result != 0) {
+        spdlog::warn("RX interrupt unavailable for queue {}, idle worker falls back to timed sleeps: {}",
+                     _queue_id, rte_strerror(-result));
+        _rx_interrupts = false;
+    }
+}
+
+IdleState dpdk_power_manager::on_empty_poll(uint64_t now) {
+    if (_idle_start == 0) {
+        _idle_start = now;
+        _last_tsc = now;
+        _state = IdleState::SPIN;
+    }
+
+    // The time since the previous poll went to whatever the previous poll decided
+    _stats.idle_cycles[static_cast<size_t>(_state)] += now - _last_tsc;
+    _last_tsc = now;
+    _ready_since = now;
+
+    const uint64_t idle = now - _idle_start;
+    if (_policy.mode == PowerMode::POLL || idle < _spin_limit) {
+        _state = IdleState::SPIN;
+    } else if (idle < _pause_limit) {
+        _state = IdleState::PAUSE;
+    } else {
+        _state = IdleState::SLEEP;
+    }
+    return _state;
+}
+
+void dpdk_power_manager::sleep() {
+    if (!_rx_interrupts) {
+        std::this_thread::sleep_for(std::chrono::microseconds(_policy.sleep_us));
+        return;
+    }
+
+    rte_eth_dev_rx_intr_enable(_port_id, _queue_id);
+    // Packets that landed between the last poll and arming raise no interrupt; without
+    // rx_queue_count support (negative result) the wait timeout bounds that case
+    if (rte_eth_rx_queue_count(_port_id, _queue_id) <= 0) {
+        rte_epoll_event event;
+        if (rte_epoll_wait(RTE_EPOLL_PER_THREAD, &event, 1, static_cast<int>(_policy.epoll_timeout_ms)) > 0) {
+            _ready_since = rte_rdtsc();
+        }
+    }
+    rte_eth_dev_rx_intr_disable(_port_id, _queue_id);
+}
+
+void dpdk_power_manager::end_idle(uint64_t now) {
+    const auto state = static_cast<size_t>(_state);
+    _stats.idle_cycles[state] += now - _last_tsc;
+    _stats.wakeups[state]++;
+    _stats.wake_latency_cycles[state] += now - _ready_since;
+
+    adapt(now - _idle_start);
+    _idle_start = 0;
+}
+
+void dpdk_power_manager::adapt(uint64_t gap) {
+    _gap_ewma = _gap_ewma ? _gap_ewma - _gap_ewma / 8 + gap / 8 : gap;
+
+    if (_gap_ewma <= _max_spin) {
+        // Dense traffic: the next packet is typically due before the spin budget runs out
+        _spin_limit = _max_spin;
+        _pause_limit = _max_pause;
+    } else if (_gap_ewma <= _max_pause) {
+        // Gaps are bridged by pausing, spinning longer only burns power
+        _spin_limit = _max_spin / 8;
+        _pause_limit = _max_pause;
+    } else {
+        // Sparse traffic: staying awake rarely pays off, sleep almost at once
+        _spin_limit = _max_spin / 8;
+        _pause_limit = _spin_limit;
+    }
+}
+
+const IdleStats_t& dpdk_power_manager::stats() const {
+    return _stats;
+}
+
+void dpdk_power_manager::print_report(unsigned lcore_id) const {
+    uint64_t total = 0;
+    for (uint64_t cycles : _stats.idle_cycles) {
+        total += cycles;
+    }
+    if (total == 0 || _tsc_hz == 0) {
+        return;
+    }
+
+    const auto sleep = static_cast<size_t>(IdleState::SLEEP);
+    spdlog::info("==== idle report lcore {} ({} mode, RX interrupts {}) ====", lcore_id,
+                 _policy.mode == PowerMode::POLL ? "poll" : "adaptive", _rx_interrupts ? "on" : "off");
+    for (size_t state = 0; state < static_cast<size_t>(IdleState::COUNT); state++) {
+        const uint64_t wakeups = _stats.wakeups[state];
+        spdlog::info("  {:<6}: {:.3f} s idle, {} wakeups, mean wakeup latency {:.2f} us",
+                     idle_state_names[state], static_cast<double>(_stats.idle_cycles[state]) / _tsc_hz, wakeups,
+                     wakeups ? static_cast<double>(_stats.wake_latency_cycles[state]) / wakeups * 1e6 / _tsc_hz : 0.0);
+    }
+    spdlog::info("  idle time on CPU (spin + pause): {:.1f}%",
+                 100.0 * static_cast<double>(total - _stats.idle_cycles[sleep]) / total);
+}
@@ -0,0 +1,92 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_POWER_MANAGER_H
+#define DPDK_FASTDROP_AGENT_DPDK_POWER_MANAGER_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class PowerMode : uint8_t {
+    POLL,       // always busy-poll, lowest latency
+    ADAPTIVE    // spin, then pause, then sleep on the RX interrupt
+};
+
+// What an idle worker does between empty polls, in escalation order
+enum class IdleState : uint8_t {
+    SPIN = 0,   // poll again immediately
+    PAUSE,      // rte_pause() between polls
+    SLEEP,      // epoll-wait on the RX queue interrupt (timed sleep without interrupts)
+    COUNT
+};
+
+// "power" section of agent.json
+typedef struct PowerPolicy {
+    PowerMode mode;
+    uint32_t max_spin_us;       // longest spin phase, used while traffic gaps are short
+    uint32_t max_pause_us;      // idle time after which the worker sleeps
+    uint32_t sleep_us;          // timed sleep when RX interrupts are unavailable
+    uint32_t epoll_timeout_ms;  // upper bound on an interrupt wait
+} PowerPolicy_t;
+
+// Per idle state: cycles spent in it, idle periods it ended, and the summed wakeup latency.
+// Latency is measured from the last moment the queue was known empty (the last empty poll,
+// or the return of an interrupt wait) to the poll that found the packets.
+typedef struct IdleStats {
+    uint64_t idle_cycles[static_cast<size_t>(IdleState::COUNT)];
+    uint64_t wakeups[static_cast<size_t>(IdleState::COUNT)];
+    uint64_t wake_latency_cycles[static_cast<size_t>(IdleState::COUNT)];
+} IdleStats_t;
+
+// Per-lcore idle policy for one RX queue. Spin and pause thresholds follow an EWMA of the
+// idle gaps seen so far: while gaps are short enough to be spun or paused through the worker
+// stays awake, once traffic turns sparse it goes to sleep almost immediately.
+class dpdk_power_manager {
+public:
+    explicit dpdk_power_manager();
+    virtual ~dpdk_power_manager();
+
+    static bool parse_mode(const std::string& name, PowerMode& mode);
+
+    void init(uint16_t port_id, uint16_t queue_id, const PowerPolicy_t& policy, bool rx_interrupts, uint64_t tsc_hz);
+    // Adds the queue interrupt to the calling thread's epoll instance, so call it on the worker lcore
+    void register_interrupt();
+
+    inline void on_traffic(uint64_t now) {
+        if (_idle_start != 0) {
+            end_idle(now);
+        }
+    }
+
+    // Accounts the empty poll at "now" and returns what to do until the next one
+    IdleState on_empty_poll(uint64_t now);
+    // Blocks until the RX interrupt fires or the timeout expires (caller goes QSBR offline around it)
+    void sleep();
+
+    const IdleStats_t& stats() const;
+    void print_report(unsigned lcore_id) const;
+
+private:
+    void end_idle(uint64_t now);
+    void adapt(uint64_t gap);
+
+    PowerPolicy_t _policy;
+    uint64_t _tsc_hz;
+    uint64_t _max_spin;         // cycles
+    uint64_t _max_pause;
+    uint64_t _spin_limit;       // current thresholds, measured from the start of the idle period
+    uint64_t _pause_limit;
+    uint64_t _gap_ewma;
+
+    uint64_t _idle_start;       // 0 while busy
+    uint64_t _last_tsc;         // previous empty poll, for idle time accounting
+    uint64_t _ready_since;      // queue last known empty
+    IdleState _state;
+
+    uint16_t _port_id;
+    uint16_t _queue_id;
+    bool _rx_interrupts;
+
+    IdleStats_t _stats;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_POWER_MANAGER_H
@@ -0,0 +1,206 @@
+#include "dpdk_prefix_list.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <arpa/inet.h>
+#include <spdlog/spdlog.h>
+
+dpdk_prefix_list::dpdk_prefix_list()
+    : _stats{} {
+
+}
+
+dpdk_prefix_list::~dpdk_prefix_list() {
+
+}
+
+bool dpdk_prefix_list::parse_line(const std::string& line, IpPrefix_t& prefix, bool& blank) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    const char* token_end = p;
+    while (token_end < end && *token_end != ' ' && *token_end != '\t' && *token_end != '\r' &&
+           *token_end != '#' && *token_end != ';') {
+        token_end++;
+    }
+    blank = token_end == p;
+    if (blank) {
+        return false;
+    }
+
+    // Split "addr/len" into a terminated copy for inet_pton, no allocation per line
+    char addr[INET6_ADDRSTRLEN];
+    const char* slash = static_cast<const char*>(std::memchr(p, '/', token_end - p));
+    const char* addr_end = slash ? slash : token_end;
+    if (static_cast<size_t>(addr_end - p) >= sizeof(addr)) {
+        return false;
+    }
+    std::memcpy(addr, p, addr_end - p);
+    addr[addr_end - p] = '\0';
+
+    prefix = IpPrefix_t{};
+    int max_length;
+    if (inet_pton(AF_INET, addr, &prefix.addr.v4) == 1) {
+        prefix.family = NetworkProtocol::IPv4;
+        max_length = 32;
+    } else if (inet_pton(AF_INET6, addr, prefix.addr.v6) == 1) {
+        prefix.family = NetworkProtocol::IPv6;
+        max_length = 128;
+    } else {
+        return false;
+    }
+
+    int length = max_length;
+    if (slash) {
+        length = 0;
+        const char* digit = slash + 1;
+        if (digit == token_end || token_end - digit > 3) {
+            return false;
+        }
+        for (; digit < token_end; digit++) {
+            if (*digit < '0' || *digit > '9') {
+                return false;
+            }
+            length = length * 10 + (*digit - '0');
+        }
+        if (length > max_length) {
+            return false;
+        }
+    }
+    prefix.length = static_cast<uint8_t>(length);
+    return true;
+}
+
+dpdk_prefix_list::Range_t dpdk_prefix_list::to_range(const IpPrefix_t& prefix) {
+    Range_t range{0, prefix.length};
+    const unsigned bytes = prefix.family == NetworkProtocol::IPv4 ? 4 : 16;
+    for (unsigned i = 0; i < bytes; i++) {
+        range.addr = (range.addr << 8) | prefix.addr.v6[i];
+    }
+    // Feeds often carry host bits ("10.1.2.3/24"), clear them like parse_ip_prefix does
+    const unsigned host_bits = bytes * 8 - prefix.length;
+    if (host_bits >= 128) {
+        range.addr = 0;
+    } else if (host_bits > 0) {
+        range.addr &= ~((static_cast<unsigned __int128>(1) << host_bits) - 1);
+    }
+    return range;
+}
+
+IpPrefix_t dpdk_prefix_list::to_prefix(const Range_t& range, NetworkProtocol family) {
+    IpPrefix_t prefix{};
+    prefix.family = family;
+    prefix.length = range.length;
+    const unsigned bytes = family == NetworkProtocol::IPv4 ? 4 : 16;
+    unsigned __int128 addr = range.addr;
+    for (unsigned i = bytes; i-- > 0;) {
+        prefix.addr.v6[i] = static_cast<uint8_t>(addr);
+        addr >>= 8;
+    }
+    return prefix;
+}
+
+void dpdk_prefix_list::aggregate(std::vector<Range_t>& ranges, unsigned max_length) {
+    // Sorted by address, shorter first, a covering prefix always precedes what it covers
+    std::sort(ranges.begin(), ranges.end(), [](const Range_t& a, const Range_t& b) {
+        return a.addr != b.addr ? a.addr < b.addr : a.length < b.length;
+    });
+
+    auto covers = [max_length](const Range_t& outer, const Range_t& inner) {
+        return outer.length == 0 ||
+               (inner.length >= outer.length && ((outer.addr ^ inner.addr) >> (max_length - outer.length)) == 0);
+    };
+
+    size_t kept = 0;
+    for (const Range_t& range : ranges) {
+        if (kept > 0 && covers(ranges[kept - 1], range)) {
+            continue;
+        }
+        ranges[kept++] = range;
+
+        // Kept ranges are disjoint and ascending, so merges only ever involve the last two
+        while (kept >= 2) {
+            Range_t& left = ranges[kept - 2];
+            const Range_t& right = ranges[kept - 1];
+            if (left.length != right.length || left.length == 0) {
+                break;
+            }
+            const unsigned __int128 span = static_cast<unsigned __int128>(1) << (max_length - left.length);
+            if ((left.addr & ((span << 1) - 1)) != 0 || left.addr + span != right.addr) {
+                break;
+            }
+            left.length--;
+            kept--;
+        }
+    }
+    ranges.resize(kept);
+}
+
+bool dpdk_prefix_list::load(const std::string& path) {
+    const auto start = std::chrono::steady_clock::now();
+    _prefixes.clear();
+    _stats = PrefixListStats_t{};
+
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        spdlog::error("Failed to open prefix list: {}", path);
+        return false;
+    }
+
+    std::vector<Range_t> ranges4;
+    std::vector<Range_t> ranges6;
+    std::string line;
+    while (std::getline(f, line)) {
+        _stats.lines++;
+        _stats.bytes += line.size() + 1;
+
+        IpPrefix_t prefix;
+        bool blank = false;
+        if (!parse_line(line, prefix, blank)) {
+            if (!blank) {
+                if (_stats.invalid < 10) {
+                    spdlog::warn("Invalid prefix at {}:{}: {}", path, _stats.lines, line);
+                }
+                _stats.invalid++;
+            }
+            continue;
+        }
+        _stats.parsed++;
+        (prefix.family == NetworkProtocol::IPv4 ? ranges4 : ranges6).push_back(to_range(prefix));
+    }
+    if (f.bad()) {
+        spdlog::error("Failed to read prefix list: {}", path);
+        return false;
+    }
+
+    aggregate(ranges4, 32);
+    aggregate(ranges6, 128);
+    _prefixes.reserve(ranges4.size() + ranges6.size());
+    for (const Range_t& range : ranges4) {
+        _prefixes.push_back(to_prefix(range, NetworkProtocol::IPv4));
+    }
+    for (const Range_t& range : ranges6) {
+        _prefixes.push_back(to_prefix(range, NetworkProtocol::IPv6));
+    }
+    _stats.aggregated = _prefixes.size();
+
+    _stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const double seconds = std::max(_stats.elapsed_ms, 1e-3) / 1000.0;
+    spdlog::info("Loaded prefix list {}: {} lines, {} prefixes ({} invalid), {} after aggregation, "
+                 "{:.1f} ms ({:.2f} M lines/s, {:.1f} MiB/s)",
+                 path, _stats.lines, _stats.parsed, _stats.invalid, _stats.aggregated, _stats.elapsed_ms,
+                 _stats.lines / seconds / 1e6, _stats.bytes / seconds / (1 << 20));
+    return true;
+}
+
+const std::vector<IpPrefix_t>& dpdk_prefix_list::prefixes() const {
+    return _prefixes;
+}
+
+const PrefixListStats_t& dpdk_prefix_list::stats() const {
+    return _stats;
+}
@@ -0,0 +1,51 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_PREFIX_LIST_H
+#define DPDK_FASTDROP_AGENT_DPDK_PREFIX_LIST_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dpdk_rule_match.h"
+
+typedef struct PrefixListStats {
+    uint64_t lines;
+    uint64_t bytes;
+    uint64_t parsed;        // valid addresses and prefixes
+    uint64_t invalid;
+    uint64_t aggregated;    // prefixes left after dropping covered ones and merging siblings
+    double elapsed_ms;
+} PrefixListStats_t;
+
+// Streaming reader for plain-text CIDR feeds: one address or prefix per line,
+// "#" or ";" starts a comment (so Spamhaus-style "a.b.c.d/n ; SBL123" lines work).
+// Lines are parsed in place without building a document, then each family is
+// aggregated: prefixes covered by a shorter one are dropped and sibling pairs
+// are merged into their parent, so the union of addresses is unchanged.
+class dpdk_prefix_list {
+public:
+    explicit dpdk_prefix_list();
+    virtual ~dpdk_prefix_list();
+
+    bool load(const std::string& path);
+
+    const std::vector<IpPrefix_t>& prefixes() const;
+    const PrefixListStats_t& stats() const;
+
+private:
+    typedef struct Range {
+        unsigned __int128 addr;     // host order, IPv4 in the low 32 bits
+        uint8_t length;
+    } Range_t;
+
+    static bool parse_line(const std::string& line, IpPrefix_t& prefix, bool& blank);
+    static Range_t to_range(const IpPrefix_t& prefix);
+    static IpPrefix_t to_prefix(const Range_t& range, NetworkProtocol family);
+    static void aggregate(std::vector<Range_t>& ranges, unsigned max_length);
+
+    std::vector<IpPrefix_t> _prefixes;
+    PrefixListStats_t _stats;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_PREFIX_LIST_H
@@ -0,0 +1,208 @@
+#include "dpdk_prefix_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+dpdk_prefix_table::dpdk_prefix_table(uint8_t addr_bytes, uint8_t root_bits)
+    : _root_data(nullptr)
+    , _groups_data(nullptr)
+    , _group_entries(0)
+    , _prefix_count(0)
+    , _addr_bytes(addr_bytes)
+    , _root_bits(root_bits) {
+
+}
+
+dpdk_prefix_table::~dpdk_prefix_table() {
+
+}
+
+void dpdk_prefix_table::clear() {
+    _pending.clear();
+    _root.clear();
+    _groups.clear();
+    _root_data = nullptr;
+    _groups_data = nullptr;
+    _group_entries = 0;
+    _prefix_count = 0;
+}
+
+void dpdk_prefix_table::add(const uint8_t* addr, uint8_t depth, uint32_t value) {
+    Prefix_t prefix{};
+    prefix.depth = std::min<uint8_t>(depth, _addr_bytes * 8);
+    prefix.value = value;
+
+    // Keep only the network bits so duplicates compare equal
+    for (unsigned i = 0; i < _addr_bytes; i++) {
+        const int bits = static_cast<int>(prefix.depth) - static_cast<int>(i * 8);
+        if (bits >= 8) {
+            prefix.addr[i] = addr[i];
+        } else if (bits > 0) {
+            prefix.addr[i] = addr[i] & static_cast<uint8_t>(0xFF << (8 - bits));
+        }
+    }
+    _pending.push_back(prefix);
+}
+
+void dpdk_prefix_table::build() {
+    _root.clear();
+    _groups.clear();
+    _root_data = nullptr;
+    _groups_data = nullptr;
+    _group_entries = 0;
+    _prefix_count = 0;
+    if (_pending.empty()) {
+        return;
+    }
+
+    // Shorter prefixes first; equal prefixes ordered by value so the first one is the minimum
+    std::sort(_pending.begin(), _pending.end(), [](const Prefix_t& a, const Prefix_t& b) {
+        if (a.depth != b.depth) {
+            return a.depth < b.depth;
+        }
+        const int cmp = std::memcmp(a.addr, b.addr, sizeof(a.addr));
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        return a.value < b.value;
+    });
+
+    _root.assign(static_cast<size_t>(1) << _root_bits, EMPTY);
+
+    const Prefix_t* previous = nullptr;
+    for (const auto& prefix : _pending) {
+        if (previous && previous->depth == prefix.depth &&
+            std::memcmp(previous->addr, prefix.addr, sizeof(prefix.addr)) == 0) {
+            continue;
+        }
+        previous = &prefix;
+
+        // Everything inserted so far is shorter, so this returns the folded value of the
+        // longest prefix covering this one
+        const uint32_t covering = walk(_root.data(), _groups.data(), prefix.addr);
+        insert(prefix.addr, prefix.depth, std::min(prefix.value, covering));
+        _prefix_count++;
+    }
+
+    _pending.clear();
+    _pending.shrink_to_fit();
+    _root_data = _root.data();
+    _groups_data = _groups.data();
+    _group_entries = _groups.size();
+}
+
+uint32_t dpdk_prefix_table::new_group(uint32_t fill) {
+    const auto group = static_cast<uint32_t>(_groups.size() >> 8);
+    _groups.resize(_groups.size() + 256, fill);
+    return group;
+}
+
+void dpdk_prefix_table::insert(const uint8_t* addr, uint8_t depth, uint32_t value) {
+    const size_t root = root_index(addr);
+
+    if (depth <= _root_bits) {
+        const size_t span = static_cast<size_t>(1) << (_root_bits - depth);
+        const size_t start = root & ~(span - 1);
+        std::fill(_root.begin() + start, _root.begin() + start + span, value);
+        return;
+    }
+
+    if (!is_group(_root[root])) {
+        _root[root] = new_group(_root[root]) | GROUP_FLAG;
+    }
+    uint32_t group = _root[root] & ~GROUP_FLAG;
+
+    for (unsigned bit = _root_bits; ; bit += 8) {
+        const uint8_t byte = addr[bit / 8];
+        const unsigned remaining = depth - bit;
+
+        if (remaining <= 8) {
+            const size_t span = static_cast<size_t>(1) << (8 - remaining);
+            const size_t start = (static_cast<size_t>(group) << 8) | (byte & ~(span - 1));
+            std::fill(_groups.begin() + start, _groups.begin() + start + span, value);
+            return;
+        }
+
+        const size_t slot = (static_cast<size_t>(group) << 8) | byte;
+        if (!is_group(_groups[slot])) {
+            const uint32_t child = new_group(_groups[slot]);
+            _groups[slot] = child | GROUP_FLAG;
+        }
+        group = _groups[slot] & ~GROUP_FLAG;
+    }
+}
+
+size_t dpdk_prefix_table::size() const {
+    return _prefix_count;
+}
+
+size_t dpdk_prefix_table::memory_bytes() const {
+    return _root_data ? ((static_cast<size_t>(1) << _root_bits) + _group_entries) * sizeof(uint32_t) : 0;
+}
+
+void dpdk_prefix_table::save(dpdk_rule_snapshot_writer& writer, SnapshotSection root_section,
+                             SnapshotSection group_section) const {
+    writer.add(root_section, _root_data, sizeof(uint32_t), _root_data ? static_cast<size_t>(1) << _root_bits : 0,
+               _prefix_count);
+    writer.add(group_section, _groups_data, sizeof(uint32_t), _group_entries, 0);
+}
+
+bool dpdk_prefix_table::attach(const dpdk_rule_snapshot& snapshot, SnapshotSection root_section,
+                               SnapshotSection group_section) {
+    clear();
+    uint64_t root_entries = 0;
+    uint64_t group_entries = 0;
+    uint64_t prefix_count = 0;
+    uint64_t unused = 0;
+    const void* root = snapshot.section(root_section, sizeof(uint32_t), root_entries, prefix_count);
+    const void* groups = snapshot.section(group_section, sizeof(uint32_t), group_entries, unused);
+    if (!root || !groups || group_entries % 256 != 0) {
+        return false;
+    }
+    if (root_entries == 0) {
+        return true;
+    }
+    // The root stride is part of the layout, an image built for another one can not be walked
+    if (root_entries != static_cast<size_t>(1) << _root_bits ||
+        !valid_groups(static_cast<const uint32_t*>(root), static_cast<const uint32_t*>(groups), group_entries)) {
+        return false;
+    }
+
+    _root_data = static_cast<const uint32_t*>(root);
+    _groups_data = static_cast<const uint32_t*>(groups);
+    _group_entries = group_entries;
+    _prefix_count = prefix_count;
+    return true;
+}
+
+bool dpdk_prefix_table::valid_groups(const uint32_t* root, const uint32_t* groups, size_t group_entries) const {
+    // A walk follows group links unchecked, so every link must land inside the group array
+    // and the deepest group must still index with the address's last byte. build() only
+    // links to newly appended groups, so a child always comes after its parent.
+    const size_t group_count = group_entries >> 8;
+    const unsigned max_depth = _addr_bytes - _root_bits / 8;
+    std::vector<uint8_t> depth(group_count, 0);
+
+    for (size_t i = 0; i < static_cast<size_t>(1) << _root_bits; i++) {
+        if (is_group(root[i])) {
+            const uint32_t group = root[i] & ~GROUP_FLAG;
+            if (group >= group_count || max_depth == 0) {
+                return false;
+            }
+            depth[group] = 1;
+        }
+    }
+    for (size_t group = 0; group < group_count; group++) {
+        for (size_t slot = group << 8; slot < (group + 1) << 8; slot++) {
+            if (!is_group(groups[slot])) {
+                continue;
+            }
+            const uint32_t child = groups[slot] & ~GROUP_FLAG;
+            if (child <= group || child >= group_count || depth[group] >= max_depth) {
+                return false;
+            }
+            depth[child] = std::max<uint8_t>(depth[child], depth[group] + 1);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_PREFIX_TABLE_H
+#define DPDK_FASTDROP_AGENT_DPDK_PREFIX_TABLE_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dpdk_rule_snapshot.h"
+
+// Multibit trie for longest-prefix lookup over network-order addresses
+// (DIR-style: one direct-indexed root of root_bits, then 8-bit stride groups).
+// Values are folded at build time so every prefix stores the minimum of its own
+// value and all shorter prefixes covering it; the longest match therefore returns
+// the smallest value among all matching prefixes (first-match over encoded rules).
+class dpdk_prefix_table {
+public:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    explicit dpdk_prefix_table(uint8_t addr_bytes, uint8_t root_bits);
+    virtual ~dpdk_prefix_table();
+
+    void clear();
+    void add(const uint8_t* addr, uint8_t depth, uint32_t value);
+    void build();
+
+    inline uint32_t lookup(const uint8_t* addr) const {
+        if (!_root_data) {
+            return EMPTY;
+        }
+        return walk(_root_data, _groups_data, addr);
+    }
+
+    inline void prefetch(const uint8_t* addr) const {
+        if (_root_data) {
+            __builtin_prefetch(&_root_data[root_index(addr)]);
+        }
+    }
+
+    size_t size() const;
+    size_t memory_bytes() const;
+
+    void save(dpdk_rule_snapshot_writer& writer, SnapshotSection root_section, SnapshotSection group_section) const;
+    // Serves lookups straight from the snapshot's arrays; add/build must not follow
+    bool attach(const dpdk_rule_snapshot& snapshot, SnapshotSection root_section, SnapshotSection group_section);
+
+    // True when check() accepts every stored value (group links excluded)
+    template<typename Check>
+    bool all_values(Check check) const {
+        const size_t root_entries = _root_data ? static_cast<size_t>(1) << _root_bits : 0;
+        for (size_t i = 0; i < root_entries; i++) {
+            if (_root_data[i] != EMPTY && !is_group(_root_data[i]) && !check(_root_data[i])) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < _group_entries; i++) {
+            if (_groups_data[i] != EMPTY && !is_group(_groups_data[i]) && !check(_groups_data[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t GROUP_FLAG = 0x80000000u;
+
+    typedef struct Prefix {
+        uint8_t addr[16];
+        uint8_t depth;
+        uint32_t value;
+    } Prefix_t;
+
+    static inline bool is_group(uint32_t entry) {
+        return (entry & GROUP_FLAG) && entry != EMPTY;
+    }
+
+    inline size_t root_index(const uint8_t* addr) const {
+        size_t index = 0;
+        for (unsigned i = 0; i < _root_bits / 8u; i++) {
+            index = (index << 8) | addr[i];
+        }
+        return index;
+    }
+
+    inline uint32_t walk(const uint32_t* root, const uint32_t* groups, const uint8_t* addr) const {
+        uint32_t entry = root[root_index(addr)];
+        unsigned byte = _root_bits / 8;
+        while (is_group(entry)) {
+            entry = groups[(static_cast<size_t>(entry & ~GROUP_FLAG) << 8) | addr[byte++]];
+        }
+        return entry;
+    }
+
+    void insert(const uint8_t* addr, uint8_t depth, uint32_t value);
+    bool valid_groups(const uint32_t* root, const uint32_t* groups, size_t group_entries) const;
+    uint32_t new_group(uint32_t fill);
+
+    std::vector<Prefix_t> _pending;
+    std::vector<uint32_t> _root;
+    std::vector<uint32_t> _groups;     // 256 entries per group
+    const uint32_t* _root_data;        // _root / _groups once built, or an attached snapshot's arrays
+    const uint32_t* _groups_data;
+    size_t _group_entries;
+    size_t _prefix_count;
+    uint8_t _addr_bytes;
+    uint8_t _root_bits;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_PREFIX_TABLE_H
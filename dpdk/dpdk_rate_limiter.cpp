@@ -0,0 +1,161 @@
+#include "dpdk_rate_limiter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <rte_ether.h>
+#include <rte_malloc.h>
+#include <rte_prefetch.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk_flat_hash.h"
+#include "dpdk_rule_set.h"
+
+dpdk_rate_limiter::dpdk_rate_limiter()
+    : _buckets(nullptr)
+    , _mask(0) {
+
+}
+
+dpdk_rate_limiter::~dpdk_rate_limiter() {
+    rte_free(_buckets);
+    _buckets = nullptr;
+}
+
+bool dpdk_rate_limiter::init(uint32_t entries, int socket_id) {
+    uint32_t capacity = PROBE_WINDOW;
+    while (capacity < entries) {
+        capacity <<= 1;
+    }
+
+    auto* buckets = static_cast<TokenBucket_t*>(
+            rte_zmalloc_socket("rate_limiter", sizeof(TokenBucket_t) * capacity, RTE_CACHE_LINE_SIZE, socket_id));
+    if (!buckets) {
+        spdlog::error("Failed to allocate {} rate limit buckets on socket {}", capacity, socket_id);
+        return false;
+    }
+
+    rte_free(_buckets);
+    _buckets = buckets;
+    _mask = capacity - 1;
+    return true;
+}
+
+RatePolicy_t dpdk_rate_limiter::compile(const RateLimit_t& limit, uint64_t tsc_hz) {
+    RatePolicy_t policy{};
+    const uint64_t burst_cycles = tsc_hz * limit.burst_ms / 1000;
+
+    if (limit.pps) {
+        policy.packet_cost = std::max<uint64_t>(1, tsc_hz / limit.pps);
+        policy.packet_tolerance = std::max(burst_cycles, policy.packet_cost);
+    }
+    if (limit.bps) {
+        const uint64_t bytes_per_second = std::max<uint64_t>(1, limit.bps / 8);
+        policy.byte_cost = std::max<uint64_t>(1, (tsc_hz << 16) / bytes_per_second);
+        // Always room for at least one full-size frame
+        policy.byte_tolerance = std::max(burst_cycles, (RTE_ETHER_MAX_LEN * policy.byte_cost) >> 16);
+    }
+    policy.prefix_v4 = limit.prefix_v4;
+    policy.prefix_v6 = limit.prefix_v6;
+    return policy;
+}
+
+dpdk_rate_limiter::TokenBucket_t* dpdk_rate_limiter::find(const uint64_t* addr, uint32_t rule_id, uint32_t generation,
+                                                           size_t start, uint64_t now, bool& evicted) {
+    TokenBucket_t* reusable = nullptr;
+    TokenBucket_t* oldest = nullptr;
+    uint64_t oldest_tat = UINT64_MAX;
+
+    for (uint32_t k = 0; k < PROBE_WINDOW; k++) {
+        TokenBucket_t* bucket = &_buckets[(start + k) & _mask];
+        if (bucket->rule_id == rule_id && bucket->generation == generation &&
+            bucket->addr[0] == addr[0] && bucket->addr[1] == addr[1]) {
+            return bucket;
+        }
+
+        const uint64_t tat = std::max(bucket->packet_tat, bucket->byte_tat);
+        if (!reusable && tat <= now) {
+            reusable = bucket;
+        }
+        if (tat < oldest_tat) {
+            oldest_tat = tat;
+            oldest = bucket;
+        }
+    }
+
+    TokenBucket_t* victim = reusable ? reusable : oldest;
+    evicted = !reusable;
+    victim->addr[0] = addr[0];
+    victim->addr[1] = addr[1];
+    victim->rule_id = rule_id;
+    victim->generation = generation;
+    victim->packet_tat = 0;
+    victim->byte_tat = 0;
+    return victim;
+}
+
+uint32_t dpdk_rate_limiter::police_burst(const dpdk_rule_set& rule_set, rte_mbuf* const* pkts, const FlowKeyBurst_t& keys,
+                                         uint32_t* results, uint64_t now) {
+    if (!_buckets) {
+        return 0;
+    }
+
+    // Generation 0 never exists, so zeroed buckets can not match
+    const auto generation = static_cast<uint32_t>(rule_set.generation());
+    uint64_t addrs[FLOW_KEY_BURST_MAX][2];
+    size_t slots[FLOW_KEY_BURST_MAX];
+    uint16_t pending[FLOW_KEY_BURST_MAX];
+    uint16_t count = 0;
+
+    // Pass 1: key and prefetch the bucket of every rate-limited packet
+    for (uint16_t i = 0; i < keys.count; i++) {
+        const uint32_t result = results[i];
+        if (result == dpdk_rule_classifier::NO_MATCH ||
+            dpdk_rule_classifier::action(result) != RuleAction::RATE_LIMIT) {
+            continue;
+        }
+
+        const uint32_t rule_id = dpdk_rule_classifier::rule_id(result);
+        const RatePolicy_t& policy = rule_set.rate_policy(rule_id);
+        const bool is_v4 = keys.family[i] == NetworkProtocol::IPv4;
+        const unsigned prefix = is_v4 ? policy.prefix_v4 : policy.prefix_v6;
+
+        uint8_t masked[16] = {};
+        std::memcpy(masked, keys.src_addr[i].v6, is_v4 ? 4 : 16);
+        for (unsigned b = prefix / 8; b < 16; b++) {
+            masked[b] &= b == prefix / 8 ? static_cast<uint8_t>(0xFF00 >> (prefix % 8)) : 0;
+        }
+        std::memcpy(addrs[i], masked, sizeof(masked));
+
+        slots[i] = dpdk_flat_hash_mix{}(addrs[i][0] ^ dpdk_flat_hash_mix{}(addrs[i][1] ^ rule_id)) & _mask;
+        rte_prefetch0(&_buckets[slots[i]]);
+        pending[count++] = i;
+    }
+
+    // Pass 2: GCRA conformance, a packet passes if its bucket is not ahead of now by more than the burst
+    uint32_t evictions = 0;
+    for (uint16_t j = 0; j < count; j++) {
+        const uint16_t i = pending[j];
+        const uint32_t rule_id = dpdk_rule_classifier::rule_id(results[i]);
+        const RatePolicy_t& policy = rule_set.rate_policy(rule_id);
+
+        bool evicted = false;
+        TokenBucket_t* bucket = find(addrs[i], rule_id, generation, slots[i], now, evicted);
+        evictions += evicted;
+
+        const uint64_t packet_tat = std::max(bucket->packet_tat, now);
+        const uint64_t byte_tat = std::max(bucket->byte_tat, now);
+        const bool conform = (!policy.packet_cost || packet_tat - now <= policy.packet_tolerance) &&
+                             (!policy.byte_cost || byte_tat - now <= policy.byte_tolerance);
+        if (conform) {
+            bucket->packet_tat = packet_tat + policy.packet_cost;
+            bucket->byte_tat = byte_tat + ((rte_pktmbuf_pkt_len(pkts[i]) * policy.byte_cost) >> 16);
+        } else {
+            results[i] = dpdk_rule_classifier::encode(rule_id, RuleAction::RATE_EXCEEDED);
+        }
+    }
+    return evictions;
+}
+
+uint32_t dpdk_rate_limiter::capacity() const {
+    return _buckets ? _mask + 1 : 0;
+}
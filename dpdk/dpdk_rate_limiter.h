@@ -0,0 +1,72 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RATE_LIMITER_H
+#define DPDK_FASTDROP_AGENT_DPDK_RATE_LIMITER_H
+
+#pragma once
+
+#include <cstdint>
+#include <rte_common.h>
+#include <rte_mbuf.h>
+
+#include "dpdk_flow_key.h"
+
+// "rate_limit" action parameters from block_list.json. 0 disables that dimension.
+typedef struct RateLimit {
+    uint64_t pps;
+    uint64_t bps;
+    uint32_t burst_ms;      // bucket depth, as time at the configured rate
+    uint8_t prefix_v4;      // sources are aggregated per prefix, 32/128 = per address
+    uint8_t prefix_v6;
+} RateLimit_t;
+
+// RateLimit_t compiled against the TSC: a GCRA (virtual scheduling) token bucket,
+// where "tokens" are TSC cycles of credit
+typedef struct RatePolicy {
+    uint64_t packet_cost;       // cycles per packet, 0 = unlimited
+    uint64_t byte_cost;         // cycles per byte in 16.16 fixed point, 0 = unlimited
+    uint64_t packet_tolerance;  // burst credit in cycles
+    uint64_t byte_tolerance;
+    uint8_t prefix_v4;
+    uint8_t prefix_v6;
+} RatePolicy_t;
+
+class dpdk_rule_set;
+
+// Per-lcore token buckets keyed by (rule, source or source prefix).
+// One bucket per cache line in a fixed open-addressing table with a short probe window.
+// Aging is lazy: a bucket whose virtual times have fallen behind "now" is full again and
+// indistinguishable from a new one, so it is simply reused. Idle sources cost nothing,
+// and under churn the least recently active bucket in the window is evicted.
+class dpdk_rate_limiter {
+public:
+    static constexpr uint32_t PROBE_WINDOW = 4;
+
+    explicit dpdk_rate_limiter();
+    virtual ~dpdk_rate_limiter();
+
+    bool init(uint32_t entries, int socket_id);
+    static RatePolicy_t compile(const RateLimit_t& limit, uint64_t tsc_hz);
+
+    // Rewrites RATE_LIMIT results of non-conforming packets to RATE_EXCEEDED.
+    // Returns the number of buckets evicted to make room.
+    uint32_t police_burst(const dpdk_rule_set& rule_set, rte_mbuf* const* pkts, const FlowKeyBurst_t& keys,
+                          uint32_t* results, uint64_t now);
+
+    uint32_t capacity() const;
+
+private:
+    typedef struct TokenBucket {
+        uint64_t addr[2];           // masked source, network order
+        uint32_t rule_id;
+        uint32_t generation;        // low bits of the rule set generation it was created under
+        uint64_t packet_tat;        // theoretical arrival time, TSC
+        uint64_t byte_tat;
+    } __rte_cache_aligned TokenBucket_t;
+
+    TokenBucket_t* find(const uint64_t* addr, uint32_t rule_id, uint32_t generation, size_t start,
+                        uint64_t now, bool& evicted);
+
+    TokenBucket_t* _buckets;
+    uint32_t _mask;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RATE_LIMITER_H
@@ -0,0 +1,285 @@
+#include "dpdk_rule_classifier.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace {
+    template<typename Table>
+    void save_table(dpdk_rule_snapshot_writer& writer, SnapshotSection section, const Table& table) {
+        writer.add(section, table.slots(), Table::slot_size(), table.capacity(), table.size());
+    }
+
+    template<typename Table>
+    bool attach_table(const dpdk_rule_snapshot& snapshot, SnapshotSection section, Table& table) {
+        uint64_t capacity = 0;
+        uint64_t size = 0;
+        const void* slots = snapshot.section(section, Table::slot_size(), capacity, size);
+        return table.attach(slots, capacity, size);
+    }
+}
+
+dpdk_rule_classifier::dpdk_rule_classifier()
+    : _ip_prefix_table(4, 24)
+    , _ip6_prefix_table(16, 16)
+    , _port_table(UINT16_MAX + 1, NO_MATCH)
+    , _ports(_port_table.data())
+    , _wildcard(NO_MATCH)
+    , _acl4(NetworkProtocol::IPv4)
+    , _acl6(NetworkProtocol::IPv6)
+    , _prefilter_rate(0.0) {
+
+}
+
+dpdk_rule_classifier::~dpdk_rule_classifier() {
+
+}
+
+void dpdk_rule_classifier::clear() {
+    _ip_port_table.clear();
+    _ip_table.clear();
+    _ip_prefix_table.clear();
+    _ip6_port_table.clear();
+    _ip6_table.clear();
+    _ip6_prefix_table.clear();
+    _port_table.assign(UINT16_MAX + 1, NO_MATCH);
+    _ports = _port_table.data();
+    _wildcard = NO_MATCH;
+    _acl4.clear();
+    _acl6.clear();
+    _prefilter.clear();
+}
+
+void dpdk_rule_classifier::reserve(size_t rule_count) {
+    _ip_port_table.reserve(rule_count);
+    _ip_table.reserve(rule_count);
+}
+
+void dpdk_rule_classifier::set_prefilter(double false_positive_rate) {
+    _prefilter_rate = false_positive_rate;
+}
+
+bool dpdk_rule_classifier::is_source_only(const RuleMatch_t& match) {
+    if (match.dst_ip || match.dst_port || match.proto || match.vlan || match.vni) {
+        return false;
+    }
+    if (match.src_port && match.src_port->low != match.src_port->high) {
+        return false;
+    }
+    if (!match.src_ip) {
+        return true;
+    }
+    // The prefix tries carry no port
+    return match.src_ip->length == (match.src_ip->family == NetworkProtocol::IPv4 ? 32 : 128) || !match.src_port;
+}
+
+bool dpdk_rule_classifier::add_rule(uint32_t rule_id, const RuleMatch_t& match, RuleAction action) {
+    const uint32_t value = encode(rule_id, action);
+
+    if (!is_source_only(match)) {
+        if (match.src_ip && match.dst_ip && match.src_ip->family != match.dst_ip->family) {
+            return false;
+        }
+        const IpPrefix_t* prefix = match.src_ip ? &*match.src_ip : match.dst_ip ? &*match.dst_ip : nullptr;
+        if (!prefix || prefix->family == NetworkProtocol::IPv4) {
+            _acl4.add(match, rule_id, value);
+        }
+        if (!prefix || prefix->family == NetworkProtocol::IPv6) {
+            _acl6.add(match, rule_id, value);
+        }
+        return true;
+    }
+
+    const auto& ip = match.src_ip;
+    const std::optional<uint16_t> port = match.src_port ? std::optional<uint16_t>(match.src_port->low) : std::nullopt;
+
+    if (!ip) {
+        if (port) {
+            if (value < _port_table[*port]) {
+                _port_table[*port] = value;
+            }
+        } else if (value < _wildcard) {
+            _wildcard = value;
+        }
+        return true;
+    }
+
+    if (ip->family == NetworkProtocol::IPv4) {
+        if (ip->length < 32) {
+            _ip_prefix_table.add(reinterpret_cast<const uint8_t*>(&ip->addr.v4), ip->length, value);
+        } else if (port) {
+            _ip_port_table.insert_min(ip_port_key(ip->addr.v4, *port), value);
+        } else {
+            _ip_table.insert_min(ip->addr.v4, value);
+        }
+        return true;
+    }
+
+    if (ip->length == 128) {
+        if (port) {
+            _ip6_port_table.insert_min(Ip6PortKey_t{ip->addr.u64[0], ip->addr.u64[1], *port}, value);
+        } else {
+            _ip6_table.insert_min(Ip6Key_t{ip->addr.u64[0], ip->addr.u64[1]}, value);
+        }
+        return true;
+    }
+    _ip6_prefix_table.add(ip->addr.v6, ip->length, value);
+    return true;
+}
+
+bool dpdk_rule_classifier::build() {
+    _ip_prefix_table.build();
+    _ip6_prefix_table.build();
+    build_prefilter();
+    return _acl4.build() && _acl6.build();
+}
+
+void dpdk_rule_classifier::build_prefilter() {
+    _prefilter.clear();
+    if (_prefilter_rate <= 0.0) {
+        return;
+    }
+
+    // Keyed by source address alone, so an ip+port entry keeps every port of that address listed
+    _prefilter.init(_ip_table.size() + _ip_port_table.size() + _ip6_table.size() + _ip6_port_table.size(),
+                    _prefilter_rate);
+    _ip_table.for_each_key([this](uint32_t ip) {
+        _prefilter.insert(prefilter_hash(ip));
+    });
+    _ip_port_table.for_each_key([this](uint64_t key) {
+        _prefilter.insert(prefilter_hash(static_cast<uint32_t>(key >> 16)));
+    });
+    _ip6_table.for_each_key([this](const Ip6Key_t& key) {
+        _prefilter.insert(prefilter_hash(key.hi, key.lo));
+    });
+    _ip6_port_table.for_each_key([this](const Ip6PortKey_t& key) {
+        _prefilter.insert(prefilter_hash(key.hi, key.lo));
+    });
+}
+
+void dpdk_rule_classifier::save(dpdk_rule_snapshot_writer& writer) const {
+    writer.add(SnapshotSection::CLASSIFIER_META, &_wildcard, sizeof(_wildcard), 1, 0);
+    save_table(writer, SnapshotSection::IP_PORT_SLOTS, _ip_port_table);
+    save_table(writer, SnapshotSection::IP_SLOTS, _ip_table);
+    _ip_prefix_table.save(writer, SnapshotSection::IP_PREFIX_ROOT, SnapshotSection::IP_PREFIX_GROUPS);
+    save_table(writer, SnapshotSection::IP6_PORT_SLOTS, _ip6_port_table);
+    save_table(writer, SnapshotSection::IP6_SLOTS, _ip6_table);
+    _ip6_prefix_table.save(writer, SnapshotSection::IP6_PREFIX_ROOT, SnapshotSection::IP6_PREFIX_GROUPS);
+    writer.add(SnapshotSection::PORT_TABLE, _ports, sizeof(uint32_t), UINT16_MAX + 1, 0);
+    _acl4.save(writer, SnapshotSection::ACL4_RULES);
+    _acl6.save(writer, SnapshotSection::ACL6_RULES);
+}
+
+bool dpdk_rule_classifier::attach(const dpdk_rule_snapshot& snapshot) {
+    clear();
+
+    uint64_t count = 0;
+    uint64_t aux = 0;
+    const void* meta = snapshot.section(SnapshotSection::CLASSIFIER_META, sizeof(uint32_t), count, aux);
+    if (!meta || count != 1) {
+        spdlog::error("Rule snapshot has no classifier metadata");
+        return false;
+    }
+    const void* ports = snapshot.section(SnapshotSection::PORT_TABLE, sizeof(uint32_t), count, aux);
+    if (!ports || count != UINT16_MAX + 1) {
+        spdlog::error("Rule snapshot has no port table");
+        return false;
+    }
+
+    if (!attach_table(snapshot, SnapshotSection::IP_PORT_SLOTS, _ip_port_table) ||
+        !attach_table(snapshot, SnapshotSection::IP_SLOTS, _ip_table) ||
+        !_ip_prefix_table.attach(snapshot, SnapshotSection::IP_PREFIX_ROOT, SnapshotSection::IP_PREFIX_GROUPS) ||
+        !attach_table(snapshot, SnapshotSection::IP6_PORT_SLOTS, _ip6_port_table) ||
+        !attach_table(snapshot, SnapshotSection::IP6_SLOTS, _ip6_table) ||
+        !_ip6_prefix_table.attach(snapshot, SnapshotSection::IP6_PREFIX_ROOT, SnapshotSection::IP6_PREFIX_GROUPS)) {
+        spdlog::error("Rule snapshot has a missing or malformed lookup table");
+        clear();
+        return false;
+    }
+
+    // The owned port table is not needed while the snapshot's copy is in use
+    std::vector<uint32_t>().swap(_port_table);
+    _ports = static_cast<const uint32_t*>(ports);
+    _wildcard = *static_cast<const uint32_t*>(meta);
+    build_prefilter();
+
+    if (!_acl4.attach(snapshot, SnapshotSection::ACL4_RULES) || !_acl6.attach(snapshot, SnapshotSection::ACL6_RULES)) {
+        spdlog::error("Failed to rebuild the ACL stages from the rule snapshot");
+        clear();
+        return false;
+    }
+    return true;
+}
+
+uint16_t dpdk_rule_classifier::lookup_burst(const FlowKeyBurst_t& keys, uint32_t* results) const {
+    uint32_t ips[FLOW_KEY_BURST_MAX];
+    bool listed[FLOW_KEY_BURST_MAX];
+
+    // Non-IP frames keep the historical ip=0 lookup
+    for (uint16_t i = 0; i < keys.count; i++) {
+        ips[i] = keys.family[i] == NetworkProtocol::IPv4 ? keys.src_addr[i].v4 : 0;
+    }
+
+    uint16_t ruled_out = 0;
+    if (_prefilter.enabled()) {
+        uint64_t hashes[FLOW_KEY_BURST_MAX];
+        for (uint16_t i = 0; i < keys.count; i++) {
+            hashes[i] = keys.family[i] == NetworkProtocol::IPv6
+                    ? prefilter_hash(keys.src_addr[i].u64[0], keys.src_addr[i].u64[1]) : prefilter_hash(ips[i]);
+        }
+        ruled_out = _prefilter.probe_burst(hashes, keys.count, listed);
+    } else {
+        std::fill(listed, listed + keys.count, true);
+    }
+
+    for (uint16_t i = 0; i < keys.count; i++) {
+        if (keys.family[i] == NetworkProtocol::IPv6) {
+            _ip6_prefix_table.prefetch(keys.src_addr[i].v6);
+            if (listed[i]) {
+                _ip6_table.prefetch(Ip6Key_t{keys.src_addr[i].u64[0], keys.src_addr[i].u64[1]});
+            }
+            continue;
+        }
+        _ip_prefix_table.prefetch(reinterpret_cast<const uint8_t*>(&ips[i]));
+        if (listed[i]) {
+            _ip_table.prefetch(ips[i]);
+            _ip_port_table.prefetch(ip_port_key(ips[i], keys.src_port[i]));
+        }
+    }
+
+    for (uint16_t i = 0; i < keys.count; i++) {
+        if (keys.family[i] == NetworkProtocol::IPv6) {
+            results[i] = lookup6(keys.src_addr[i], keys.src_port[i], listed[i]);
+        } else {
+            results[i] = lookup(ips[i], keys.src_port[i], listed[i]);
+        }
+    }
+
+    // Multi-field stages refine the whole burst in one call each
+    _acl4.classify_burst(keys, results);
+    _acl6.classify_burst(keys, results);
+    return ruled_out;
+}
+
+void dpdk_rule_classifier::print_stats() const {
+    size_t port_entries = 0;
+    for (size_t port = 0; port <= UINT16_MAX; port++) {
+        if (_ports[port] != NO_MATCH) {
+            ++port_entries;
+        }
+    }
+
+    spdlog::info("Classifier: ip+port={} ({} KiB), ip={} ({} KiB), ip prefix={} ({} KiB), ip6+port={} ({} KiB), "
+                 "ip6={} ({} KiB), ip6 prefix={} ({} KiB), port={} ({} KiB), wildcard={}, acl4={}, acl6={}",
+                 _ip_port_table.size(), _ip_port_table.memory_bytes() / 1024,
+                 _ip_table.size(), _ip_table.memory_bytes() / 1024,
+                 _ip_prefix_table.size(), _ip_prefix_table.memory_bytes() / 1024,
+                 _ip6_port_table.size(), _ip6_port_table.memory_bytes() / 1024,
+                 _ip6_table.size(), _ip6_table.memory_bytes() / 1024,
+                 _ip6_prefix_table.size(), _ip6_prefix_table.memory_bytes() / 1024,
+                 port_entries, (UINT16_MAX + 1) * sizeof(uint32_t) / 1024,
+                 _wildcard != NO_MATCH ? "yes" : "no", _acl4.size(), _acl6.size());
+    if (_prefilter.enabled()) {
+        spdlog::info("Pre-filter: {} KiB, expected false positive rate {:.3f}% (target {:.3f}%)",
+                     _prefilter.memory_bytes() / 1024, _prefilter.false_positive_rate() * 100.0, _prefilter_rate * 100.0);
+    }
+}
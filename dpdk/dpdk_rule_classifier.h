@@ -0,0 +1,204 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RULE_CLASSIFIER_H
+#define DPDK_FASTDROP_AGENT_DPDK_RULE_CLASSIFIER_H
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "dpdk_acl_table.h"
+#include "dpdk_bloom_filter.h"
+#include "dpdk_flat_hash.h"
+#include "dpdk_flow_key.h"
+#include "dpdk_prefix_table.h"
+#include "dpdk_rule_match.h"
+#include "dpdk_rule_snapshot.h"
+
+enum class RuleAction : uint8_t {
+    ALLOW = 0,
+    BLOCK = 1,
+    RATE_LIMIT = 2,
+    RATE_EXCEEDED = 3   // set by the rate limiter on a RATE_LIMIT match, never in a rule
+};
+
+// Compiled form of the rule list.
+// Every stage stores an encoded match (rule id << 2 | action), so the smallest value
+// across all stages is the first rule in file order that matches the packet.
+// Source-only rules land in constant-time hash/direct tables and prefix tries (IPv4
+// prefixes in a DIR-24-8 layout, one or two memory accesses); anything involving
+// destination, protocol, ranges or a prefix with a port goes to the per-family rte_acl stage.
+// An optional Bloom filter over the exact-address keys lets unlisted sources skip the
+// exact hash stages.
+class dpdk_rule_classifier {
+public:
+    static constexpr uint32_t NO_MATCH = UINT32_MAX;
+    static constexpr uint32_t ACTION_BITS = 2;
+
+    explicit dpdk_rule_classifier();
+    virtual ~dpdk_rule_classifier();
+
+    void clear();
+    void reserve(size_t rule_count);
+    // Target false positive rate of the exact-address pre-filter, 0 disables it; applies from the next build
+    void set_prefilter(double false_positive_rate);
+    bool add_rule(uint32_t rule_id, const RuleMatch_t& match, RuleAction action);
+    bool build();
+
+    // Writes the built tables; attach() serves lookups from a snapshot's image without
+    // rebuilding anything but the rte_acl tries
+    void save(dpdk_rule_snapshot_writer& writer) const;
+    bool attach(const dpdk_rule_snapshot& snapshot);
+
+    // True when check() accepts every match any stage can return (NO_MATCH excluded), so an
+    // attached snapshot can be checked against the rules it claims to hold
+    template<typename Check>
+    bool all_matches(Check check) const {
+        const auto stored = [&check](uint32_t match) { return match == NO_MATCH || check(match); };
+        if (!stored(_wildcard)) {
+            return false;
+        }
+        for (uint32_t port = 0; _ports && port <= UINT16_MAX; port++) {
+            if (!stored(_ports[port])) {
+                return false;
+            }
+        }
+        return _ip_port_table.all_values(stored) && _ip_table.all_values(stored) &&
+               _ip_prefix_table.all_values(stored) && _ip6_port_table.all_values(stored) &&
+               _ip6_table.all_values(stored) && _ip6_prefix_table.all_values(stored) &&
+               _acl4.all_values(stored) && _acl6.all_values(stored);
+    }
+
+    // listed = false skips the exact-address stages, for sources the pre-filter ruled out
+    inline uint32_t lookup(uint32_t ip, uint16_t port, bool listed = true) const {
+        uint32_t best = lookup_port(port);
+
+        const uint32_t by_prefix = _ip_prefix_table.lookup(reinterpret_cast<const uint8_t*>(&ip));
+        if (by_prefix < best) {
+            best = by_prefix;
+        }
+
+        if (!listed) {
+            return best;
+        }
+
+        const uint32_t by_ip = _ip_table.lookup(ip);
+        if (by_ip < best) {
+            best = by_ip;
+        }
+
+        const uint32_t by_ip_port = _ip_port_table.lookup(ip_port_key(ip, port));
+        if (by_ip_port < best) {
+            best = by_ip_port;
+        }
+        return best;
+    }
+
+    inline uint32_t lookup6(const IpAddr_t& ip, uint16_t port, bool listed = true) const {
+        uint32_t best = lookup_port(port);
+
+        const uint32_t by_prefix = _ip6_prefix_table.lookup(ip.v6);
+        if (by_prefix < best) {
+            best = by_prefix;
+        }
+
+        if (!listed) {
+            return best;
+        }
+
+        const Ip6Key_t key{ip.u64[0], ip.u64[1]};
+        const uint32_t by_ip = _ip6_table.lookup(key);
+        if (by_ip < best) {
+            best = by_ip;
+        }
+
+        const uint32_t by_ip_port = _ip6_port_table.lookup(Ip6PortKey_t{ip.u64[0], ip.u64[1], port});
+        if (by_ip_port < best) {
+            best = by_ip_port;
+        }
+        return best;
+    }
+
+    // Bulk lookup over a parsed burst; hash slots for every key are prefetched first.
+    // Returns how many keys the pre-filter kept away from the exact stages.
+    uint16_t lookup_burst(const FlowKeyBurst_t& keys, uint32_t* results) const;
+
+    void print_stats() const;
+
+    static constexpr uint32_t encode(uint32_t rule_id, RuleAction action) {
+        return (rule_id << ACTION_BITS) | static_cast<uint32_t>(action);
+    }
+
+    static constexpr uint32_t rule_id(uint32_t match) {
+        return match >> ACTION_BITS;
+    }
+
+    static constexpr RuleAction action(uint32_t match) {
+        return static_cast<RuleAction>(match & ((1u << ACTION_BITS) - 1));
+    }
+
+private:
+    typedef struct Ip6Key {
+        uint64_t hi;
+        uint64_t lo;
+
+        bool operator==(const Ip6Key& other) const {
+            return hi == other.hi && lo == other.lo;
+        }
+    } Ip6Key_t;
+
+    typedef struct Ip6PortKey {
+        uint64_t hi;
+        uint64_t lo;
+        uint16_t port;
+
+        bool operator==(const Ip6PortKey& other) const {
+            return hi == other.hi && lo == other.lo && port == other.port;
+        }
+    } Ip6PortKey_t;
+
+    struct Ip6KeyHash {
+        uint64_t operator()(const Ip6Key_t& key) const {
+            return dpdk_flat_hash_mix{}(key.hi ^ dpdk_flat_hash_mix{}(key.lo));
+        }
+        uint64_t operator()(const Ip6PortKey_t& key) const {
+            return dpdk_flat_hash_mix{}(key.hi ^ dpdk_flat_hash_mix{}(key.lo ^ key.port));
+        }
+    };
+
+    static bool is_source_only(const RuleMatch_t& match);
+    void build_prefilter();
+
+    static inline uint64_t prefilter_hash(uint32_t ip) {
+        return dpdk_flat_hash_mix{}(ip);
+    }
+
+    static inline uint64_t prefilter_hash(uint64_t hi, uint64_t lo) {
+        return dpdk_flat_hash_mix{}(hi ^ dpdk_flat_hash_mix{}(lo ^ 0x9e3779b97f4a7c15ULL));
+    }
+
+    static constexpr uint64_t ip_port_key(uint32_t ip, uint16_t port) {
+        return (static_cast<uint64_t>(ip) << 16) | port;
+    }
+
+    inline uint32_t lookup_port(uint16_t port) const {
+        const uint32_t by_port = _ports[port];
+        return by_port < _wildcard ? by_port : _wildcard;
+    }
+
+    dpdk_flat_hash<uint64_t> _ip_port_table;   // exact ip + port
+    dpdk_flat_hash<uint32_t> _ip_table;        // exact ip, any port
+    dpdk_prefix_table _ip_prefix_table;        // ipv4 prefixes shorter than /32, any port (DIR-24-8)
+    dpdk_flat_hash<Ip6PortKey_t, Ip6KeyHash> _ip6_port_table;  // exact ipv6 + port
+    dpdk_flat_hash<Ip6Key_t, Ip6KeyHash> _ip6_table;           // exact ipv6 (/128), any port
+    dpdk_prefix_table _ip6_prefix_table;       // ipv6 prefixes shorter than /128, any port
+    std::vector<uint32_t> _port_table;         // 64K direct-indexed, any ip
+    const uint32_t* _ports;                    // _port_table, or an attached snapshot's copy
+    uint32_t _wildcard;                        // neither ip nor port
+    dpdk_acl_table _acl4;                      // multi-field rules, IPv4
+    dpdk_acl_table _acl6;                      // multi-field rules, IPv6
+    dpdk_bloom_filter _prefilter;              // source addresses of the four exact tables
+    double _prefilter_rate;                    // target false positive rate, 0 = no pre-filter
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RULE_CLASSIFIER_H
@@ -0,0 +1,35 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RULE_MATCH_H
+#define DPDK_FASTDROP_AGENT_DPDK_RULE_MATCH_H
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "dpdk_flow_key.h"
+
+// Address (network order, host bits cleared) plus prefix length
+typedef struct IpPrefix {
+    NetworkProtocol family;
+    IpAddr_t addr;
+    uint8_t length;
+} IpPrefix_t;
+
+// Inclusive, host order
+typedef struct PortRange {
+    uint16_t low;
+    uint16_t high;
+} PortRange_t;
+
+// Match part of a rule; an unset field matches anything
+typedef struct RuleMatch {
+    std::optional<IpPrefix_t> src_ip;
+    std::optional<IpPrefix_t> dst_ip;
+    std::optional<PortRange_t> src_port;
+    std::optional<PortRange_t> dst_port;
+    std::optional<uint8_t> proto;      // IP protocol number
+    std::optional<uint16_t> vlan;      // outermost VLAN ID, untagged packets never match
+    std::optional<uint32_t> vni;       // VXLAN/Geneve VNI or NVGRE VSID, untunnelled packets never match
+} RuleMatch_t;
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RULE_MATCH_H
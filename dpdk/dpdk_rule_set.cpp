@@ -0,0 +1,562 @@
+#include "dpdk_rule_set.h"
+
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <arpa/inet.h>
+#include <rte_cycles.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk_prefix_list.h"
+
+dpdk_rule_set::dpdk_rule_set(uint64_t generation)
+    : _rule_count(0)
+    , _generation(generation) {
+
+}
+
+dpdk_rule_set::~dpdk_rule_set() {
+
+}
+
+void dpdk_rule_set::set_prefilter(double false_positive_rate) {
+    _classifier.set_prefilter(false_positive_rate);
+}
+
+bool dpdk_rule_set::load(const std::string& path, SnapshotMemory memory) {
+    if (dpdk_rule_snapshot::is_snapshot(path)) {
+        return load_snapshot(path, memory);
+    }
+
+    _rules.clear();
+    return parse_json(path) && compile();
+}
+
+bool dpdk_rule_set::parse_json(const std::string& path) {
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        spdlog::error("Failed to open rule file: {}", path);
+        return false;
+    }
+
+    nlohmann::json json;
+    try {
+        f >> json;
+    } catch (const std::exception& e) {
+        spdlog::error("JSON parse error: {}", e.what());
+        return false;
+    }
+
+    if (!json.is_array()) {
+        spdlog::error("Rule file {} must hold a JSON array of rules", path);
+        return false;
+    }
+
+    // A mistyped field makes get()/value() throw; such a rule counts as invalid like a bad
+    // value, and any invalid rule fails the load so a reload keeps the previous generation
+    size_t index = 0;
+    size_t invalid = 0;
+    _rules.reserve(_rules.size() + json.size());
+    for (const auto& item : json) {
+        index++;
+        try {
+            Rule_t rule;
+            bool valid = true;
+
+            // "ip" / "port" are the source side, as in the original schema
+            for (const auto& [key, field] : { std::pair{"ip", &rule.match.src_ip}, std::pair{"dst_ip", &rule.match.dst_ip} }) {
+                if (!item.contains(key)) {
+                    continue;
+                }
+                const std::string ip_str = item[key].get<std::string>();
+                IpPrefix_t prefix{};
+                if (parse_ip_prefix(ip_str, prefix)) {
+                    *field = prefix;
+                } else {
+                    spdlog::warn("Invalid IP in rule: {}", ip_str);
+                    valid = false;
+                }
+            }
+            if (rule.match.src_ip && rule.match.dst_ip && rule.match.src_ip->family != rule.match.dst_ip->family) {
+                spdlog::warn("Rule mixes IPv4 and IPv6 in ip and dst_ip");
+                valid = false;
+            }
+
+            for (const auto& [key, field] : { std::pair{"port", &rule.match.src_port}, std::pair{"dst_port", &rule.match.dst_port} }) {
+                if (!item.contains(key)) {
+                    continue;
+                }
+                // 80 or "53-60"
+                const auto& value = item[key];
+                const std::string port_str = value.is_number() ? std::to_string(value.get<int>()) : value.get<std::string>();
+                PortRange_t range{};
+                if (parse_port_range(port_str, range)) {
+                    *field = range;
+                } else {
+                    spdlog::warn("Invalid port in rule: {}", port_str);
+                    valid = false;
+                }
+            }
+
+            if (item.contains("proto")) {
+                const auto& value = item["proto"];
+                const std::string proto_str = value.is_number() ? std::to_string(value.get<int>()) : value.get<std::string>();
+                uint8_t proto = 0;
+                if (parse_proto(proto_str, proto)) {
+                    rule.match.proto = proto;
+                } else {
+                    spdlog::warn("Invalid protocol in rule: {}", proto_str);
+                    valid = false;
+                }
+            }
+
+            // Scope to a VLAN ID or a tunnel VNI, matched alongside the inner 5-tuple
+            auto parse_scope = [&item, &valid](const char* key, uint32_t max, auto& field) {
+                if (!item.contains(key)) {
+                    return;
+                }
+                const auto& value = item[key];
+                if (value.is_number_unsigned() && value.get<uint32_t>() <= max) {
+                    field = value.get<uint32_t>();
+                } else {
+                    spdlog::warn("Invalid {} in rule: {}", key, value.dump());
+                    valid = false;
+                }
+            };
+            parse_scope("vlan", 4095, rule.match.vlan);
+            parse_scope("vni", 16777215, rule.match.vni);
+
+            // Source prefixes from a CIDR feed, relative paths are taken from this file's directory
+            if (item.contains("prefix_list")) {
+                std::filesystem::path list_path = item["prefix_list"].get<std::string>();
+                if (list_path.is_relative()) {
+                    list_path = std::filesystem::path(path).parent_path() / list_path;
+                }
+                rule.prefix_list = list_path.string();
+                if (rule.match.src_ip) {
+                    spdlog::warn("Rule has both ip and prefix_list: {}", rule.prefix_list);
+                    valid = false;
+                }
+            }
+
+            if (!valid) {
+                invalid++;
+                continue;
+            }
+
+            // "action": "allow" | "block" | "rate_limit", or the older "block": true/false
+            rule.action = item.value("block", true) ? RuleAction::BLOCK : RuleAction::ALLOW;
+            rule.rate_limit = RateLimit_t{};
+            const std::string action = item.value("action", std::string());
+            if (action == "allow") {
+                rule.action = RuleAction::ALLOW;
+            } else if (action == "block") {
+                rule.action = RuleAction::BLOCK;
+            } else if (action == "rate_limit" || (action.empty() && item.contains("rate_limit"))) {
+                const auto limit = item.value("rate_limit", nlohmann::json::object());
+                if (!limit.is_object()) {
+                    spdlog::warn("Invalid rate_limit in rule: {}", limit.dump());
+                    invalid++;
+                    continue;
+                }
+                // Unsigned and in range; a negative prefix would wrap into a per-address limit
+                auto parse_limit = [&limit, &valid](const char* key, uint64_t max, uint64_t fallback) -> uint64_t {
+                    if (!limit.contains(key)) {
+                        return fallback;
+                    }
+                    const auto& value = limit[key];
+                    if (value.is_number_unsigned() && value.get<uint64_t>() <= max) {
+                        return value.get<uint64_t>();
+                    }
+                    spdlog::warn("Invalid rate_limit {} in rule: {}", key, value.dump());
+                    valid = false;
+                    return fallback;
+                };
+                rule.action = RuleAction::RATE_LIMIT;
+                rule.rate_limit.pps = parse_limit("pps", UINT64_MAX, 0);
+                rule.rate_limit.bps = parse_limit("bps", UINT64_MAX, 0);
+                rule.rate_limit.burst_ms = static_cast<uint32_t>(parse_limit("burst_ms", UINT32_MAX, 100));
+                rule.rate_limit.prefix_v4 = static_cast<uint8_t>(parse_limit("prefix_v4", 32, 32));
+                rule.rate_limit.prefix_v6 = static_cast<uint8_t>(parse_limit("prefix_v6", 128, 128));
+                if (!valid) {
+                    invalid++;
+                    continue;
+                }
+                if (!rule.rate_limit.pps && !rule.rate_limit.bps) {
+                    spdlog::warn("Rate limit rule without pps or bps, it will never limit");
+                }
+            } else if (!action.empty()) {
+                spdlog::warn("Invalid action in rule: {}", action);
+                invalid++;
+                continue;
+            }
+
+            if (item.contains("comment")) {
+                rule.comment = item["comment"].get<std::string>();
+            }
+
+            _rules.push_back(rule);
+        } catch (const nlohmann::json::exception& e) {
+            spdlog::warn("Invalid rule #{} in {}: {}", index, path, e.what());
+            invalid++;
+        }
+    }
+
+    if (invalid > 0) {
+        spdlog::error("{} of {} rules in {} are invalid", invalid, json.size(), path);
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_rule_set::parse_prefix_list(const std::string& path) {
+    // Read at compile time, like a "prefix_list" entry in block_list.json
+    Rule_t rule;
+    rule.action = RuleAction::BLOCK;
+    rule.rate_limit = RateLimit_t{};
+    rule.comment = "prefix list " + path;
+    rule.prefix_list = path;
+    _rules.push_back(rule);
+    return true;
+}
+
+bool dpdk_rule_set::compile() {
+    // Compile into lookup tables, rule id = position in file (first match wins)
+    _classifier.clear();
+    _classifier.reserve(_rules.size());
+    _rate_policies.assign(_rules.size(), RatePolicy_t{});
+    const uint64_t tsc_hz = rte_get_tsc_hz();
+    for (size_t id = 0; id < _rules.size(); ++id) {
+        const auto& rule = _rules[id];
+        if (rule.action == RuleAction::RATE_LIMIT) {
+            _rate_policies[id] = dpdk_rate_limiter::compile(rule.rate_limit, tsc_hz);
+        }
+        if (!rule.prefix_list.empty()) {
+            if (!compile_prefix_list(static_cast<uint32_t>(id), rule)) {
+                return false;
+            }
+            continue;
+        }
+        if (!_classifier.add_rule(static_cast<uint32_t>(id), rule.match, rule.action)) {
+            spdlog::error("Rule {} mixes IPv4 and IPv6 addresses", id);
+            return false;
+        }
+    }
+    if (!_classifier.build()) {
+        spdlog::error("Failed to compile {} filtering rules", _rules.size());
+        return false;
+    }
+
+    _rule_count = _rules.size();
+    spdlog::info("Loaded {} filtering rules (generation {})", _rules.size(), _generation);
+    _classifier.print_stats();
+    return true;
+}
+
+bool dpdk_rule_set::compile_prefix_list(uint32_t rule_id, const Rule_t& rule) {
+    // Streamed and aggregated, then every prefix is inserted under the one rule id;
+    // the rule's other fields still apply to each of them
+    dpdk_prefix_list list;
+    if (!list.load(rule.prefix_list)) {
+        return false;
+    }
+
+    RuleMatch_t match = rule.match;
+    size_t skipped = 0;
+    for (const IpPrefix_t& prefix : list.prefixes()) {
+        match.src_ip = prefix;
+        if (!_classifier.add_rule(rule_id, match, rule.action)) {
+            skipped++;
+        }
+    }
+    // Loading the rest would publish a generation that silently lets those sources through
+    if (skipped > 0) {
+        spdlog::error("Rule {}: {} prefixes of {} do not match the family of dst_ip", rule_id, skipped,
+                      rule.prefix_list);
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_rule_set::save_snapshot(const std::string& path) const {
+    std::vector<SnapshotRateLimit_t> rate_limits;
+    for (size_t id = 0; id < _rules.size(); ++id) {
+        if (_rules[id].action == RuleAction::RATE_LIMIT) {
+            rate_limits.push_back(SnapshotRateLimit_t{ static_cast<uint32_t>(id), 0, _rules[id].rate_limit });
+        }
+    }
+
+    dpdk_rule_snapshot_writer writer;
+    _classifier.save(writer);
+    // Stored unconverted, the TSC rate is only known on the machine that loads it
+    writer.add(SnapshotSection::RATE_LIMITS, rate_limits.data(), sizeof(SnapshotRateLimit_t), rate_limits.size(), 0);
+    return writer.write(path, _rules.size());
+}
+
+bool dpdk_rule_set::load_snapshot(const std::string& path, SnapshotMemory memory) {
+    const uint64_t start = rte_rdtsc();
+    _snapshot = std::make_unique<dpdk_rule_snapshot>();
+    if (!_snapshot->open(path, memory) || !_classifier.attach(*_snapshot)) {
+        spdlog::error("Failed to load rule snapshot: {}", path);
+        return false;
+    }
+
+    uint64_t count = 0;
+    uint64_t aux = 0;
+    const auto* rate_limits = static_cast<const SnapshotRateLimit_t*>(
+            _snapshot->section(SnapshotSection::RATE_LIMITS, sizeof(SnapshotRateLimit_t), count, aux));
+    if (!rate_limits) {
+        spdlog::error("Rule snapshot {} has no rate limit section", path);
+        return false;
+    }
+
+    // Only RATE_LIMIT matches look their policy up, so the table ends at the last such rule
+    _rule_count = _snapshot->rule_count();
+    uint32_t policy_count = 0;
+    std::vector<bool> rate_limited(_rule_count, false);
+    for (uint64_t i = 0; i < count; i++) {
+        if (rate_limits[i].rule_id >= _rule_count) {
+            spdlog::error("Rule snapshot {} rate limits rule {} of {}", path, rate_limits[i].rule_id, _rule_count);
+            return false;
+        }
+        policy_count = std::max(policy_count, rate_limits[i].rule_id + 1);
+        rate_limited[rate_limits[i].rule_id] = true;
+    }
+
+    // Workers index by what the tables return, so every match must name one of the rules
+    // and a RATE_LIMIT match one that has a policy
+    const bool matches_valid = _classifier.all_matches([&](uint32_t match) {
+        const uint32_t rule_id = dpdk_rule_classifier::rule_id(match);
+        const RuleAction action = dpdk_rule_classifier::action(match);
+        return rule_id < _rule_count && action != RuleAction::RATE_EXCEEDED &&
+               (action != RuleAction::RATE_LIMIT || rate_limited[rule_id]);
+    });
+    if (!matches_valid) {
+        spdlog::error("Rule snapshot {} has a match outside its {} rules or a rate limit without a policy",
+                      path, _rule_count);
+        return false;
+    }
+    _rate_policies.assign(policy_count, RatePolicy_t{});
+    const uint64_t tsc_hz = rte_get_tsc_hz();
+    for (uint64_t i = 0; i < count; i++) {
+        _rate_policies[rate_limits[i].rule_id] = dpdk_rate_limiter::compile(rate_limits[i].limit, tsc_hz);
+    }
+
+    spdlog::info("Loaded {} filtering rules from snapshot {} ({} MiB, {}, {:.1f} ms, generation {})",
+                 _rule_count, path, _snapshot->size() >> 20, memory == SnapshotMemory::HUGEPAGE ? "hugepage" : "mmap",
+                 static_cast<double>(rte_rdtsc() - start) * 1000.0 / rte_get_tsc_hz(), _generation);
+    _classifier.print_stats();
+    return true;
+}
+
+bool dpdk_rule_set::parse_ip_prefix(const std::string& text, IpPrefix_t& prefix) {
+    // "a.b.c.d", "x::y" or "x::/len"
+    const size_t slash = text.find('/');
+    const std::string addr_str = text.substr(0, slash);
+
+    prefix = IpPrefix_t{};
+    int max_length = 0;
+    if (inet_pton(AF_INET, addr_str.c_str(), &prefix.addr.v4) == 1) {
+        prefix.family = NetworkProtocol::IPv4;
+        max_length = 32;
+    } else if (inet_pton(AF_INET6, addr_str.c_str(), prefix.addr.v6) == 1) {
+        prefix.family = NetworkProtocol::IPv6;
+        max_length = 128;
+    } else {
+        return false;
+    }
+
+    int length = max_length;
+    if (slash != std::string::npos) {
+        try {
+            length = std::stoi(text.substr(slash + 1));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (length < 0 || length > max_length) {
+            return false;
+        }
+    }
+    prefix.length = static_cast<uint8_t>(length);
+
+    // Clear host bits
+    for (int i = 0; i < max_length / 8; i++) {
+        const int bits = length - i * 8;
+        if (bits <= 0) {
+            prefix.addr.v6[i] = 0;
+        } else if (bits < 8) {
+            prefix.addr.v6[i] &= static_cast<uint8_t>(0xFF << (8 - bits));
+        }
+    }
+    return true;
+}
+
+bool dpdk_rule_set::parse_port_range(const std::string& text, PortRange_t& range) {
+    // "80" or "53-60"
+    const size_t dash = text.find('-');
+    try {
+        size_t used = 0;
+        const int low = std::stoi(text.substr(0, dash), &used);
+        if (used != (dash == std::string::npos ? text.size() : dash)) {
+            return false;
+        }
+        int high = low;
+        if (dash != std::string::npos) {
+            high = std::stoi(text.substr(dash + 1), &used);
+            if (used != text.size() - dash - 1) {
+                return false;
+            }
+        }
+        if (low < 0 || high > UINT16_MAX || low > high) {
+            return false;
+        }
+        range.low = static_cast<uint16_t>(low);
+        range.high = static_cast<uint16_t>(high);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_rule_set::parse_proto(const std::string& text, uint8_t& proto) {
+    if (text == "tcp") {
+        proto = 6;
+    } else if (text == "udp") {
+        proto = 17;
+    } else if (text == "icmp") {
+        proto = 1;
+    } else if (text == "icmpv6") {
+        proto = 58;
+    } else {
+        try {
+            const int number = std::stoi(text);
+            if (number < 0 || number > UINT8_MAX) {
+                return false;
+            }
+            proto = static_cast<uint8_t>(number);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t dpdk_rule_set::lookup_tunnels(const TunnelKeyBurst_t& tunnels, uint32_t* results) const {
+    if (tunnels.keys.count == 0) {
+        return 0;
+    }
+
+    uint32_t outer_results[FLOW_KEY_BURST_MAX];
+    const uint16_t ruled_out = _classifier.lookup_burst(tunnels.keys, outer_results);
+    for (uint16_t i = 0; i < tunnels.keys.count; i++) {
+        uint32_t& result = results[tunnels.packet[i]];
+        result = std::min(result, outer_results[i]);
+    }
+    return ruled_out;
+}
+
+bool dpdk_rule_set::enable_rule_stats(unsigned slots) {
+    if (!_rule_stats.init(_rule_count, slots)) {
+        return false;
+    }
+    spdlog::info("Rule hit counters: {} rules x {} lcores ({} KiB)", _rule_count, slots,
+                 _rule_stats.memory_bytes() / 1024);
+    return true;
+}
+
+bool dpdk_rule_set::write_rule_stats(const std::string& path) const {
+    if (path.empty() || _rule_stats.rule_count() == 0) {
+        return false;
+    }
+
+    // Streamed rule by rule, a DOM of a large rule set would cost more than the counters
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::trunc);
+        if (!f.is_open()) {
+            spdlog::warn("Failed to open rule statistics file: {}", tmp_path);
+            return false;
+        }
+
+        const uint64_t now = rte_rdtsc();
+        const double tsc_hz = static_cast<double>(rte_get_tsc_hz());
+        f << "{\"generation\": " << _generation << ", \"rules\": [\n";
+        for (size_t id = 0; id < _rule_stats.rule_count(); id++) {
+            const RuleCounters_t c = _rule_stats.total(id);
+            f << "  {\"id\": " << id << ", \"hits\": " << c.packets << ", \"bytes\": " << c.bytes
+              << ", \"last_hit_seconds_ago\": ";
+            if (c.last_tsc) {
+                f << (now > c.last_tsc ? static_cast<double>(now - c.last_tsc) / tsc_hz : 0.0);
+            } else {
+                f << "null";
+            }
+            if (id < _rules.size() && !_rules[id].comment.empty()) {
+                f << ", \"comment\": " << nlohmann::json(_rules[id].comment).dump();
+            }
+            if (id < _rules.size() && !_rules[id].prefix_list.empty()) {
+                f << ", \"prefix_list\": " << nlohmann::json(_rules[id].prefix_list).dump();
+            }
+            f << (id + 1 < _rule_stats.rule_count() ? "},\n" : "}\n");
+        }
+        f << "]}\n";
+        if (!f) {
+            spdlog::warn("Failed to write rule statistics file: {}", tmp_path);
+            return false;
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        spdlog::warn("Failed to publish rule statistics file: {}", path);
+        return false;
+    }
+    return true;
+}
+
+void dpdk_rule_set::print_rule_stats() const {
+    if (_rule_stats.rule_count() == 0) {
+        return;
+    }
+
+    size_t matched = 0;
+    uint64_t packets = 0;
+    for (size_t id = 0; id < _rule_stats.rule_count(); id++) {
+        const RuleCounters_t c = _rule_stats.total(id);
+        matched += c.packets > 0;
+        packets += c.packets;
+    }
+    spdlog::info("Rule set generation {}: {} of {} rules matched {} packets, {} never matched",
+                 _generation, matched, _rule_stats.rule_count(), packets, _rule_stats.rule_count() - matched);
+}
+
+void dpdk_rule_set::print_rules_comments() const {
+    if (_snapshot) {
+        spdlog::info("==== Packet Filter Rules: {} from a snapshot, comments are not stored ====", _rule_count);
+        return;
+    }
+    spdlog::info("==== Packet Filter Rules Comments (Total: {}) ====", _rules.size());
+    int idx = 0;
+    for (const auto& rule : _rules) {
+        if (!rule.comment.empty()) {
+            spdlog::info("- Rule {}: {}", idx++, rule.comment);
+        } else if (!rule.prefix_list.empty()) {
+            spdlog::info("- Rule {}: (prefix list {})", idx++, rule.prefix_list);
+        } else {
+            spdlog::info("- Rule {}: (No comment)", idx++);
+        }
+    }
+    spdlog::info("===============================================================");
+}
+
+const std::vector<dpdk_rule_set::Rule_t>& dpdk_rule_set::rules() const {
+    return _rules;
+}
+
+size_t dpdk_rule_set::rule_count() const {
+    return _rule_count;
+}
+
+uint64_t dpdk_rule_set::generation() const {
+    return _generation;
+}
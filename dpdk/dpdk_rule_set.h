@@ -0,0 +1,108 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RULE_SET_H
+#define DPDK_FASTDROP_AGENT_DPDK_RULE_SET_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "dpdk_rate_limiter.h"
+#include "dpdk_rule_classifier.h"
+#include "dpdk_rule_snapshot.h"
+#include "dpdk_rule_stats.h"
+
+// One immutable, fully compiled generation of the block list.
+// Built on the control thread, then published to the workers as a whole.
+// Loaded either from block_list.json or from a binary snapshot written by the
+// offline compiler, whose tables are used in place without parsing or rebuilding.
+class dpdk_rule_set {
+public:
+    typedef struct Rule {
+        RuleMatch_t match;
+        RuleAction action;
+        RateLimit_t rate_limit;     // RATE_LIMIT only
+        std::string comment;
+        std::string prefix_list;    // CIDR feed supplying the source prefixes, match.src_ip is then unset
+    } Rule_t;
+
+    explicit dpdk_rule_set(uint64_t generation);
+    virtual ~dpdk_rule_set();
+
+    // Target false positive rate of the classifier's pre-filter, 0 disables it; set before load
+    void set_prefilter(double false_positive_rate);
+    // A snapshot is recognised by its magic bytes, anything else is parsed as JSON
+    bool load(const std::string& path, SnapshotMemory memory = SnapshotMemory::MMAP);
+
+    // Offline compiler steps: parse any number of inputs (rule ids continue across
+    // them), compile, then write the tables out. A prefix list becomes one block rule.
+    bool parse_json(const std::string& path);
+    bool parse_prefix_list(const std::string& path);
+    bool compile();
+    bool save_snapshot(const std::string& path) const;
+
+    inline uint16_t lookup_burst(const FlowKeyBurst_t& keys, uint32_t* results) const {
+        return _classifier.lookup_burst(keys, results);
+    }
+
+    // Tunnelled packets also answer for the headers that carried them: each result becomes the
+    // earliest rule matching any level, so a block on the outer source holds inside a tunnel too
+    uint16_t lookup_tunnels(const TunnelKeyBurst_t& tunnels, uint32_t* results) const;
+
+    inline const RatePolicy_t& rate_policy(uint32_t rule_id) const {
+        return _rate_policies[rule_id];
+    }
+
+    // Per-lcore hit counters, allocated once the set is loaded; slot is rte_lcore_index()
+    bool enable_rule_stats(unsigned slots);
+
+    inline RuleCounters_t* rule_counters(int slot) const {
+        return _rule_stats.slot(slot);
+    }
+
+    // NO_MATCH and the fragment table's UNMATCHED decode past the last rule id and are skipped
+    inline void count_hit(RuleCounters_t* counters, uint32_t result, uint32_t bytes, uint64_t now) const {
+        const uint32_t rule_id = dpdk_rule_classifier::rule_id(result);
+        if (rule_id < _rule_stats.rule_count()) {
+            RuleCounters_t& c = counters[rule_id];
+            c.packets++;
+            c.bytes += bytes;
+            c.last_tsc = now;
+        }
+    }
+
+    // Control thread: merged counters with each rule's comment, written then renamed
+    bool write_rule_stats(const std::string& path) const;
+    void print_rule_stats() const;
+
+    void print_rules_comments() const;
+    static bool parse_ip_prefix(const std::string& text, IpPrefix_t& prefix);
+    static bool parse_port_range(const std::string& text, PortRange_t& range);
+    static bool parse_proto(const std::string& text, uint8_t& proto);
+    // Empty for a set loaded from a snapshot, which keeps only the compiled tables
+    const std::vector<Rule_t>& rules() const;
+    size_t rule_count() const;
+    uint64_t generation() const;
+
+private:
+    typedef struct SnapshotRateLimit {
+        uint32_t rule_id;
+        uint32_t pad;
+        RateLimit_t limit;
+    } SnapshotRateLimit_t;
+
+    bool compile_prefix_list(uint32_t rule_id, const Rule_t& rule);
+    bool load_snapshot(const std::string& path, SnapshotMemory memory);
+
+    std::unique_ptr<dpdk_rule_snapshot> _snapshot;  // declared first, so it outlives the tables viewing it
+    std::vector<Rule_t> _rules;
+    std::vector<RatePolicy_t> _rate_policies;  // indexed by rule id
+    dpdk_rule_classifier _classifier;
+    dpdk_rule_stats _rule_stats;
+    size_t _rule_count;
+    uint64_t _generation;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RULE_SET_H
@@ -0,0 +1,312 @@
+#include "dpdk_rule_snapshot.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <rte_errno.h>
+#include <rte_hash_crc.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+    constexpr char SNAPSHOT_MAGIC[8] = {'F', 'D', 'R', 'U', 'L', 'E', 'S', '\0'};
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr size_t SECTION_ALIGN = 64;    // tables start on a cache line
+
+    typedef struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;        // BYTE_ORDER_MARK as the writer stored it
+        uint64_t file_size;
+        uint64_t rule_count;
+        uint32_t section_count;
+        uint32_t payload_crc;       // rte_hash_crc over everything after the header
+        uint8_t reserved[24];
+    } SnapshotHeader_t;
+
+    typedef struct SnapshotSectionEntry {
+        uint32_t id;
+        uint32_t elem_size;
+        uint64_t offset;            // from the start of the file, SECTION_ALIGN aligned
+        uint64_t count;
+        uint64_t aux;
+    } SnapshotSectionEntry_t;
+
+    static_assert(sizeof(SnapshotHeader_t) == 64, "snapshot header layout");
+    static_assert(sizeof(SnapshotSectionEntry_t) == 32, "snapshot section entry layout");
+
+    // rte_hash_crc takes a 32-bit length; CRC32-C chains across calls byte for byte
+    uint32_t crc_update(uint32_t crc, const void* data, size_t len) {
+        constexpr size_t chunk = 1u << 30;
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            const size_t n = len < chunk ? len : chunk;
+            crc = rte_hash_crc(bytes, static_cast<uint32_t>(n), crc);
+            bytes += n;
+            len -= n;
+        }
+        return crc;
+    }
+
+    size_t align_up(size_t value) {
+        return (value + SECTION_ALIGN - 1) & ~(SECTION_ALIGN - 1);
+    }
+}
+
+dpdk_rule_snapshot_writer::dpdk_rule_snapshot_writer() {
+
+}
+
+dpdk_rule_snapshot_writer::~dpdk_rule_snapshot_writer() {
+
+}
+
+void dpdk_rule_snapshot_writer::add(SnapshotSection id, const void* data, uint32_t elem_size, uint64_t count, uint64_t aux) {
+    _sections.push_back(Pending_t{ id, data, elem_size, count, aux });
+}
+
+bool dpdk_rule_snapshot_writer::write(const std::string& path, uint64_t rule_count) const {
+    // Lay the sections out after the header and the section table
+    std::vector<SnapshotSectionEntry_t> entries;
+    size_t offset = align_up(sizeof(SnapshotHeader_t) + _sections.size() * sizeof(SnapshotSectionEntry_t));
+    for (const auto& section : _sections) {
+        entries.push_back(SnapshotSectionEntry_t{ static_cast<uint32_t>(section.id), section.elem_size, offset,
+                                                  section.count, section.aux });
+        offset = align_up(offset + section.count * section.elem_size);
+    }
+
+    SnapshotHeader_t header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = dpdk_rule_snapshot::VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.file_size = offset;
+    header.rule_count = rule_count;
+    header.section_count = static_cast<uint32_t>(entries.size());
+
+    // Written beside the target and renamed, so a watching agent never maps a partial image
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        spdlog::error("Failed to create rule snapshot: {}", tmp_path);
+        return false;
+    }
+
+    static const uint8_t padding[SECTION_ALIGN] = {};
+    uint32_t crc = 0;
+    size_t written = sizeof(SnapshotHeader_t);
+    auto emit = [&f, &crc, &written](const void* data, size_t len) {
+        f.write(static_cast<const char*>(data), static_cast<std::streamsize>(len));
+        crc = crc_update(crc, data, len);
+        written += len;
+    };
+
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));  // crc is patched in below
+    emit(entries.data(), entries.size() * sizeof(SnapshotSectionEntry_t));
+    for (size_t i = 0; i < _sections.size(); i++) {
+        emit(padding, entries[i].offset - written);
+        emit(_sections[i].data, _sections[i].count * _sections[i].elem_size);
+    }
+    emit(padding, header.file_size - written);
+
+    header.payload_crc = crc;
+    f.seekp(0);
+    f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    f.close();
+    if (!f) {
+        spdlog::error("Failed to write rule snapshot: {}", tmp_path);
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        spdlog::error("Failed to publish rule snapshot: {}", path);
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    spdlog::info("Wrote rule snapshot {} ({} rules, {} sections, {} MiB, crc 0x{:08x})",
+                 path, rule_count, entries.size(), header.file_size >> 20, crc);
+    return true;
+}
+
+dpdk_rule_snapshot::dpdk_rule_snapshot()
+    : _base(nullptr)
+    , _size(0)
+    , _map(nullptr)
+    , _memzone(nullptr) {
+
+}
+
+dpdk_rule_snapshot::~dpdk_rule_snapshot() {
+    close();
+}
+
+bool dpdk_rule_snapshot::parse_memory(const std::string& name, SnapshotMemory& memory) {
+    if (name == "mmap") {
+        memory = SnapshotMemory::MMAP;
+    } else if (name == "hugepage") {
+        memory = SnapshotMemory::HUGEPAGE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_rule_snapshot::is_snapshot(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+    return f.read(magic, sizeof(magic)) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+bool dpdk_rule_snapshot::open(const std::string& path, SnapshotMemory memory) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        spdlog::error("Failed to open rule snapshot: {}", path);
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader_t)) {
+        spdlog::error("Invalid rule snapshot: {}", path);
+        ::close(fd);
+        return false;
+    }
+    _size = static_cast<size_t>(st.st_size);
+
+    const bool loaded = memory == SnapshotMemory::HUGEPAGE ? read_into_memzone(fd, path) : map_file(fd, path);
+    ::close(fd);
+    if (!loaded || !verify(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool dpdk_rule_snapshot::map_file(int fd, const std::string& path) {
+    // Prefaulted, so the first lookups after a reload do not take page faults
+    _map = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (_map == MAP_FAILED) {
+        spdlog::error("Failed to mmap rule snapshot: {}", path);
+        _map = nullptr;
+        return false;
+    }
+    _base = static_cast<const uint8_t*>(_map);
+    return true;
+}
+
+bool dpdk_rule_snapshot::read_into_memzone(int fd, const std::string& path) {
+    // The old generation's memzone lives until the reload's grace period ends, names must differ
+    static std::atomic<uint32_t> instance{0};
+    const std::string name = "rule_snapshot_" + std::to_string(instance.fetch_add(1));
+    _memzone = rte_memzone_reserve_aligned(name.c_str(), _size, SOCKET_ID_ANY, 0, RTE_CACHE_LINE_SIZE);
+    if (!_memzone) {
+        spdlog::error("Failed to reserve {} MiB of hugepage memory for rule snapshot {}: {}",
+                      _size >> 20, path, rte_strerror(rte_errno));
+        return false;
+    }
+
+    auto* dst = static_cast<uint8_t*>(_memzone->addr);
+    size_t done = 0;
+    while (done < _size) {
+        const ssize_t n = pread(fd, dst + done, _size - done, static_cast<off_t>(done));
+        if (n <= 0) {
+            spdlog::error("Failed to read rule snapshot {} at offset {}", path, done);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    _base = dst;
+    return true;
+}
+
+bool dpdk_rule_snapshot::verify(const std::string& path) const {
+    SnapshotHeader_t header{};
+    std::memcpy(&header, _base, sizeof(header));
+
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        spdlog::error("Not a rule snapshot: {}", path);
+        return false;
+    }
+    if (header.version != VERSION || header.byte_order != BYTE_ORDER_MARK) {
+        spdlog::error("Rule snapshot {} has version {} (byte order 0x{:08x}), this agent reads version {}; recompile it",
+                      path, header.version, header.byte_order, VERSION);
+        return false;
+    }
+    if (header.file_size != _size ||
+        header.section_count > (_size - sizeof(header)) / sizeof(SnapshotSectionEntry_t)) {
+        spdlog::error("Rule snapshot {} is truncated ({} of {} bytes)", path, _size, header.file_size);
+        return false;
+    }
+
+    const auto* entries = reinterpret_cast<const SnapshotSectionEntry_t*>(_base + sizeof(header));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        const auto& entry = entries[i];
+        if (entry.offset % SECTION_ALIGN != 0 || entry.offset > _size ||
+            (entry.elem_size && entry.count > (_size - entry.offset) / entry.elem_size)) {
+            spdlog::error("Rule snapshot {} has a corrupt section table (section {})", path, entry.id);
+            return false;
+        }
+    }
+
+    const uint32_t crc = crc_update(0, _base + sizeof(header), _size - sizeof(header));
+    if (crc != header.payload_crc) {
+        spdlog::error("Rule snapshot {} failed its checksum (0x{:08x}, expected 0x{:08x})", path, crc, header.payload_crc);
+        return false;
+    }
+    return true;
+}
+
+void dpdk_rule_snapshot::close() {
+    if (_map) {
+        munmap(_map, _size);
+        _map = nullptr;
+    }
+    if (_memzone) {
+        rte_memzone_free(_memzone);
+        _memzone = nullptr;
+    }
+    _base = nullptr;
+    _size = 0;
+}
+
+const void* dpdk_rule_snapshot::section(SnapshotSection id, uint32_t elem_size, uint64_t& count, uint64_t& aux) const {
+    if (!_base) {
+        return nullptr;
+    }
+
+    SnapshotHeader_t header{};
+    std::memcpy(&header, _base, sizeof(header));
+    const auto* entries = reinterpret_cast<const SnapshotSectionEntry_t*>(_base + sizeof(header));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        if (entries[i].id != static_cast<uint32_t>(id)) {
+            continue;
+        }
+        if (entries[i].elem_size != elem_size) {
+            spdlog::error("Rule snapshot section {} has {} byte entries, expected {}", entries[i].id,
+                          entries[i].elem_size, elem_size);
+            return nullptr;
+        }
+        count = entries[i].count;
+        aux = entries[i].aux;
+        return _base + entries[i].offset;
+    }
+    return nullptr;
+}
+
+uint64_t dpdk_rule_snapshot::rule_count() const {
+    if (!_base) {
+        return 0;
+    }
+    SnapshotHeader_t header{};
+    std::memcpy(&header, _base, sizeof(header));
+    return header.rule_count;
+}
+
+size_t dpdk_rule_snapshot::size() const {
+    return _size;
+}
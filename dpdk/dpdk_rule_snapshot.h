@@ -0,0 +1,92 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RULE_SNAPSHOT_H
+#define DPDK_FASTDROP_AGENT_DPDK_RULE_SNAPSHOT_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <rte_memzone.h>
+
+enum class SnapshotMemory : uint8_t {
+    MMAP,       // map the file read-only and prefault it from the page cache
+    HUGEPAGE    // read the file into a hugepage memzone, so table lookups take no 4K TLB misses
+};
+
+// Sections of a rule snapshot; numbers are part of the file format
+enum class SnapshotSection : uint32_t {
+    CLASSIFIER_META = 1,    // the wildcard match
+    IP_PORT_SLOTS = 2,
+    IP_SLOTS = 3,
+    IP6_PORT_SLOTS = 4,
+    IP6_SLOTS = 5,
+    IP6_PREFIX_ROOT = 6,
+    IP6_PREFIX_GROUPS = 7,
+    PORT_TABLE = 8,
+    ACL4_RULES = 9,
+    ACL6_RULES = 10,
+    RATE_LIMITS = 11,
+    IP_PREFIX_ROOT = 12,
+    IP_PREFIX_GROUPS = 13
+};
+
+// Collects the sections of a compiled rule set and writes them as one image.
+// Only pointers are kept, the data must stay valid until write() returns.
+class dpdk_rule_snapshot_writer {
+public:
+    explicit dpdk_rule_snapshot_writer();
+    virtual ~dpdk_rule_snapshot_writer();
+
+    // aux is a per-section value for the owner (e.g. used slots of a hash table)
+    void add(SnapshotSection id, const void* data, uint32_t elem_size, uint64_t count, uint64_t aux);
+    bool write(const std::string& path, uint64_t rule_count) const;
+
+private:
+    typedef struct Pending {
+        SnapshotSection id;
+        const void* data;
+        uint32_t elem_size;
+        uint64_t count;
+        uint64_t aux;
+    } Pending_t;
+
+    std::vector<Pending_t> _sections;
+};
+
+// A verified, read-only rule snapshot: versioned header, section table and the
+// lookup tables exactly as the classifier uses them, checksummed with rte_hash_crc.
+// Tables attached to it point into the image, so it must outlive them.
+// Native byte order and struct layout; the version and per-section element sizes
+// reject images written by an incompatible build.
+class dpdk_rule_snapshot {
+public:
+    static constexpr uint32_t VERSION = 2;
+
+    explicit dpdk_rule_snapshot();
+    virtual ~dpdk_rule_snapshot();
+
+    static bool parse_memory(const std::string& name, SnapshotMemory& memory);
+    // Cheap check of the magic bytes, to tell a snapshot from a JSON rule file
+    static bool is_snapshot(const std::string& path);
+
+    bool open(const std::string& path, SnapshotMemory memory);
+    void close();
+
+    // nullptr unless the section exists and was written with this element size
+    const void* section(SnapshotSection id, uint32_t elem_size, uint64_t& count, uint64_t& aux) const;
+    uint64_t rule_count() const;
+    size_t size() const;
+
+private:
+    bool map_file(int fd, const std::string& path);
+    bool read_into_memzone(int fd, const std::string& path);
+    bool verify(const std::string& path) const;
+
+    const uint8_t* _base;
+    size_t _size;
+    void* _map;                     // MMAP
+    const rte_memzone* _memzone;    // HUGEPAGE
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RULE_SNAPSHOT_H
@@ -0,0 +1,66 @@
+#include "dpdk_rule_stats.h"
+
+#include <algorithm>
+#include <rte_malloc.h>
+#include <spdlog/spdlog.h>
+
+dpdk_rule_stats::dpdk_rule_stats()
+    : _rule_count(0) {
+
+}
+
+dpdk_rule_stats::~dpdk_rule_stats() {
+    clear();
+}
+
+bool dpdk_rule_stats::init(size_t rule_count, unsigned slots) {
+    clear();
+    if (rule_count == 0) {
+        return true;
+    }
+
+    // Separate cache-line aligned arrays, so no two lcores ever write the same line
+    for (unsigned i = 0; i < slots; i++) {
+        auto* counters = static_cast<RuleCounters_t*>(
+                rte_zmalloc("rule_counters", sizeof(RuleCounters_t) * rule_count, RTE_CACHE_LINE_SIZE));
+        if (!counters) {
+            spdlog::warn("Failed to allocate hit counters for {} rules, rule statistics disabled", rule_count);
+            clear();
+            return false;
+        }
+        _slots.push_back(counters);
+    }
+    _rule_count = rule_count;
+    return true;
+}
+
+void dpdk_rule_stats::clear() {
+    for (RuleCounters_t* counters : _slots) {
+        rte_free(counters);
+    }
+    _slots.clear();
+    _rule_count = 0;
+}
+
+RuleCounters_t dpdk_rule_stats::total(size_t rule_id) const {
+    RuleCounters_t sum{};
+    if (rule_id >= _rule_count) {
+        return sum;
+    }
+
+    for (const RuleCounters_t* counters : _slots) {
+        const RuleCounters_t& c = counters[rule_id];
+        sum.packets += __atomic_load_n(&c.packets, __ATOMIC_RELAXED);
+        sum.bytes += __atomic_load_n(&c.bytes, __ATOMIC_RELAXED);
+        sum.last_tsc = std::max(sum.last_tsc, __atomic_load_n(&c.last_tsc, __ATOMIC_RELAXED));
+    }
+    return sum;
+}
+
+size_t dpdk_rule_stats::rule_count() const {
+    return _rule_count;
+}
+
+size_t dpdk_rule_stats::memory_bytes() const {
+    return _slots.size() * _rule_count * sizeof(RuleCounters_t);
+}
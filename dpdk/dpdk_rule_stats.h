@@ -0,0 +1,44 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_RULE_STATS_H
+#define DPDK_FASTDROP_AGENT_DPDK_RULE_STATS_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+typedef struct RuleCounters {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t last_tsc;      // TSC of the burst that last matched, 0 = never
+} RuleCounters_t;
+
+// Hit counters per compiled rule id, one cache-line aligned array per lcore.
+// Each worker writes only its own array with plain stores; the control thread merges
+// them with relaxed loads, the same contract as WorkerCounters_t.
+// Slots are lcore indices (rte_lcore_index), sized when the rule set is loaded.
+class dpdk_rule_stats {
+public:
+    explicit dpdk_rule_stats();
+    virtual ~dpdk_rule_stats();
+
+    bool init(size_t rule_count, unsigned slots);
+    void clear();
+
+    // nullptr when counting is off or the slot is out of range
+    inline RuleCounters_t* slot(int index) const {
+        return index >= 0 && static_cast<size_t>(index) < _slots.size() ? _slots[index] : nullptr;
+    }
+
+    // Sum over every lcore, last_tsc is the latest of them
+    RuleCounters_t total(size_t rule_id) const;
+
+    size_t rule_count() const;
+    size_t memory_bytes() const;
+
+private:
+    std::vector<RuleCounters_t*> _slots;
+    size_t _rule_count;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_RULE_STATS_H
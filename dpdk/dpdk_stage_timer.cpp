@@ -0,0 +1,92 @@
+#include "dpdk_stage_timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+
+namespace {
+    const char* const stage_names[] = {"rx", "parse", "filter", "verdict", "tx"};
+    static_assert(sizeof(stage_names) / sizeof(stage_names[0]) == static_cast<size_t>(WorkerStage::COUNT),
+                  "one name per worker stage");
+}
+
+dpdk_stage_timer::dpdk_stage_timer()
+#ifdef FASTDROP_STAGE_TIMING
+    : _histograms{}
+    , _last_tsc(0)
+#endif
+{
+
+}
+
+dpdk_stage_timer::~dpdk_stage_timer() {
+
+}
+
+const char* dpdk_stage_timer::stage_name(WorkerStage stage) {
+    return stage < WorkerStage::COUNT ? stage_names[static_cast<size_t>(stage)] : "unknown";
+}
+
+uint64_t dpdk_stage_timer::highest_value(unsigned bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    const unsigned shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t lowest = static_cast<uint64_t>(bucket - shift * SUB_BUCKETS) << shift;
+    return lowest + (1ull << shift) - 1;
+}
+
+uint64_t dpdk_stage_timer::percentile(const Histogram_t& histogram, uint64_t packets, double fraction) {
+    if (packets == 0) {
+        return 0;
+    }
+
+    // First bucket whose cumulative count reaches the rank, at least one sample in
+    const auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * packets)), 1);
+    uint64_t seen = 0;
+    for (unsigned bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += histogram.counts[bucket];
+        if (seen >= rank) {
+            return highest_value(bucket);
+        }
+    }
+    return highest_value(BUCKETS - 1);
+}
+
+StageLatency_t dpdk_stage_timer::latency(WorkerStage stage) const {
+    StageLatency_t result{};
+#ifdef FASTDROP_STAGE_TIMING
+    // The worker keeps recording meanwhile; the copy may straddle a burst, which only
+    // shifts a percentile by that burst's packets
+    const Histogram_t& live = _histograms[static_cast<size_t>(stage)];
+    Histogram_t copy;
+    for (unsigned bucket = 0; bucket < BUCKETS; bucket++) {
+        copy.counts[bucket] = __atomic_load_n(&live.counts[bucket], __ATOMIC_RELAXED);
+        result.packets += copy.counts[bucket];
+    }
+    result.cycles = __atomic_load_n(&live.cycles, __ATOMIC_RELAXED);
+    result.p50 = percentile(copy, result.packets, 0.5);
+    result.p99 = percentile(copy, result.packets, 0.99);
+    result.p999 = percentile(copy, result.packets, 0.999);
+#else
+    (void)stage;
+#endif
+    return result;
+}
+
+void dpdk_stage_timer::print_report(unsigned lcore_id) const {
+    if (!ENABLED) {
+        return;
+    }
+
+    spdlog::info("==== stage latency report lcore {} (TSC cycles per packet) ====", lcore_id);
+    for (size_t stage = 0; stage < static_cast<size_t>(WorkerStage::COUNT); stage++) {
+        const StageLatency_t latency = this->latency(static_cast<WorkerStage>(stage));
+        if (latency.packets == 0) {
+            continue;
+        }
+        spdlog::info("  {:<7}: p50 {:>6}, p99 {:>6}, p99.9 {:>6}, mean {:>8.1f} ({} packets)",
+                     stage_names[stage], latency.p50, latency.p99, latency.p999,
+                     static_cast<double>(latency.cycles) / latency.packets, latency.packets);
+    }
+}
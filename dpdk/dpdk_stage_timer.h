@@ -0,0 +1,109 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_STAGE_TIMER_H
+#define DPDK_FASTDROP_AGENT_DPDK_STAGE_TIMER_H
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <rte_cycles.h>
+
+// Stages of one non-empty burst in the worker loop, timed back to back
+enum class WorkerStage : uint8_t {
+    RX,         // rx_burst from the port or the pipeline rings
+    PARSE,      // parse_burst
+    FILTER,     // flow cache / rule lookup, fragments, rate limiting, table aging
+    VERDICT,    // per-packet counting, log sampling, TX enqueue or drop
+    TX,         // tx_flush
+    COUNT
+};
+
+typedef struct StageLatency {
+    uint64_t packets;
+    uint64_t cycles;
+    uint64_t p50;           // cycles per packet
+    uint64_t p99;
+    uint64_t p999;
+} StageLatency_t;
+
+// Per-lcore log-linear histograms (HdrHistogram style) of TSC cycles per packet for each
+// worker stage. A burst's stage time is divided by its packet count and recorded with
+// that many samples, so percentiles are per packet. 32 linear sub-buckets per power of
+// two keep every value within about 3% of its bucket.
+// Built with -DFASTDROP_STAGE_TIMING (CMake option FASTDROP_STAGE_TIMING); otherwise
+// start() and mark() are empty and the loop reads no extra timestamps.
+// Written only by the owning lcore; the control thread reads with relaxed loads.
+class dpdk_stage_timer {
+public:
+#ifdef FASTDROP_STAGE_TIMING
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    explicit dpdk_stage_timer();
+    virtual ~dpdk_stage_timer();
+
+    // now is the timestamp the burst was started with
+    inline void start(uint64_t now) {
+#ifdef FASTDROP_STAGE_TIMING
+        _last_tsc = now;
+#else
+        (void)now;
+#endif
+    }
+
+    // Charges the time since the previous mark (or start) to stage
+    inline void mark(WorkerStage stage, uint16_t packets) {
+#ifdef FASTDROP_STAGE_TIMING
+        const uint64_t now = rte_rdtsc();
+        Histogram_t& histogram = _histograms[static_cast<size_t>(stage)];
+        histogram.counts[bucket((now - _last_tsc) / packets)] += packets;
+        histogram.cycles += now - _last_tsc;
+        _last_tsc = now;
+#else
+        (void)stage;
+        (void)packets;
+#endif
+    }
+
+    // Control thread, cumulative since the worker started
+    StageLatency_t latency(WorkerStage stage) const;
+    void print_report(unsigned lcore_id) const;
+
+    static const char* stage_name(WorkerStage stage);
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_BIT = 39;        // values of 2^40 cycles and above share the last bucket
+    static constexpr unsigned BUCKETS = (MAX_BIT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    typedef struct Histogram {
+        uint64_t counts[BUCKETS];   // packets per bucket
+        uint64_t cycles;
+    } Histogram_t;
+
+    // Values below SUB_BUCKETS are exact, above that each power of two is split into SUB_BUCKETS
+    static inline unsigned bucket(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<unsigned>(value);
+        }
+        const unsigned bit = 63 - __builtin_clzll(value);
+        if (bit > MAX_BIT) {
+            return BUCKETS - 1;
+        }
+        const unsigned shift = bit - SUB_BUCKET_BITS;
+        return shift * SUB_BUCKETS + static_cast<unsigned>(value >> shift);
+    }
+
+    // Largest value that lands in the bucket, as HdrHistogram reports percentiles
+    static uint64_t highest_value(unsigned bucket);
+    static uint64_t percentile(const Histogram_t& histogram, uint64_t packets, double fraction);
+
+#ifdef FASTDROP_STAGE_TIMING
+    std::array<Histogram_t, static_cast<size_t>(WorkerStage::COUNT)> _histograms;
+    uint64_t _last_tsc;
+#endif
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_STAGE_TIMER_H
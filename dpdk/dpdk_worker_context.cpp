@@ -0,0 +1,222 @@
+#include "dpdk_worker_context.h"
+
+#include <new>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <spdlog/spdlog.h>
+
+dpdk_worker_context::dpdk_worker_context(unsigned lcore_id, uint16_t port_id, uint16_t rx_queue_id, uint16_t tx_queue_id,
+                                         const dpdk_packet_filter* packet_filter, const rte_atomic32_t* running)
+    : _counters{}
+    , _tx_bufs{}
+    , _tx_count(0)
+    , _flow_keys{}
+    , _tunnel_keys{}
+    , _match_results{}
+    , _packet_filter(packet_filter)
+    , _running(running)
+    , _rx_rings(nullptr)
+    , _tx_ring(nullptr)
+    , _rx_ring_count(0)
+    , _rx_ring_next(0)
+    , _lcore_id(lcore_id)
+    , _socket_id(static_cast<int>(rte_lcore_to_socket_id(lcore_id)))
+    , _port_id(port_id)
+    , _rx_queue_id(rx_queue_id)
+    , _tx_queue_id(tx_queue_id) {
+
+}
+
+dpdk_worker_context::~dpdk_worker_context() {
+    for (uint16_t i = 0; i < _tx_count; i++) {
+        rte_pktmbuf_free(_tx_bufs[i]);
+    }
+    _tx_count = 0;
+}
+
+dpdk_worker_context* dpdk_worker_context::create(unsigned lcore_id, uint16_t port_id, uint16_t rx_queue_id, uint16_t tx_queue_id,
+                                                 const dpdk_packet_filter* packet_filter, const rte_atomic32_t* running) {
+    const int socket_id = static_cast<int>(rte_lcore_to_socket_id(lcore_id));
+    void* mem = rte_zmalloc_socket("worker_context", sizeof(dpdk_worker_context), RTE_CACHE_LINE_SIZE, socket_id);
+    if (!mem) {
+        spdlog::error("Failed to allocate worker context for lcore {} on socket {}", lcore_id, socket_id);
+        return nullptr;
+    }
+    return new (mem) dpdk_worker_context(lcore_id, port_id, rx_queue_id, tx_queue_id, packet_filter, running);
+}
+
+void dpdk_worker_context::destroy(dpdk_worker_context* ctx) {
+    if (!ctx) {
+        return;
+    }
+    ctx->~dpdk_worker_context();
+    rte_free(ctx);
+}
+
+void dpdk_worker_context::tx_flush() {
+    if (_tx_count == 0) {
+        return;
+    }
+
+    const uint16_t nb_tx = likely(!_tx_ring)
+            ? rte_eth_tx_burst(_port_id, _tx_queue_id, _tx_bufs, _tx_count)
+            : static_cast<uint16_t>(rte_ring_mp_enqueue_burst(_tx_ring, reinterpret_cast<void* const*>(_tx_bufs),
+                                                              _tx_count, nullptr));
+
+    uint32_t total_tx_bytes = 0;
+    for (uint16_t j = 0; j < nb_tx; j++) {
+        total_tx_bytes += rte_pktmbuf_pkt_len(_tx_bufs[j]);
+    }
+
+    if (unlikely(nb_tx < _tx_count)) {
+        rte_pktmbuf_free_bulk(&_tx_bufs[nb_tx], _tx_count - nb_tx);
+        _counters.tx_full_drops += _tx_count - nb_tx;
+    }
+
+    _counters.tx_packets += nb_tx;
+    _counters.tx_bytes += total_tx_bytes;
+    _tx_count = 0;
+}
+
+void dpdk_worker_context::attach_rings(rte_ring* const* rx_rings, uint16_t rx_ring_count, rte_ring* tx_ring) {
+    _rx_rings = rx_rings;
+    _rx_ring_count = rx_ring_count;
+    _rx_ring_next = 0;
+    _tx_ring = tx_ring;
+}
+
+uint16_t dpdk_worker_context::ring_rx_burst(rte_mbuf** bufs, uint16_t count) {
+    // Round robin over the RX stage rings, so one busy RX lcore can not starve the others.
+    // Dequeue mode follows the ring: MC for shared RX rings, SC for a flow distribution ring.
+    for (uint16_t k = 0; k < _rx_ring_count; k++) {
+        rte_ring* ring = _rx_rings[_rx_ring_next];
+        _rx_ring_next = _rx_ring_next + 1 < _rx_ring_count ? _rx_ring_next + 1 : 0;
+
+        const unsigned nb_rx = rte_ring_dequeue_burst(ring, reinterpret_cast<void**>(bufs), count, nullptr);
+        if (nb_rx > 0) {
+            return static_cast<uint16_t>(nb_rx);
+        }
+    }
+    return 0;
+}
+
+dpdk_packet_parser& dpdk_worker_context::parser() {
+    return _packet_parser;
+}
+
+dpdk_rate_limiter& dpdk_worker_context::rate_limiter() {
+    return _rate_limiter;
+}
+
+dpdk_flow_cache& dpdk_worker_context::flow_cache() {
+    return _flow_cache;
+}
+
+dpdk_frag_table& dpdk_worker_context::frag_table() {
+    return _frag_table;
+}
+
+dpdk_log_sampler& dpdk_worker_context::log_sampler() {
+    return _log_sampler;
+}
+
+dpdk_power_manager& dpdk_worker_context::power() {
+    return _power_manager;
+}
+
+dpdk_stage_timer& dpdk_worker_context::stage_timer() {
+    return _stage_timer;
+}
+
+const dpdk_stage_timer& dpdk_worker_context::stage_timer() const {
+    return _stage_timer;
+}
+
+FlowKeyBurst_t& dpdk_worker_context::flow_keys() {
+    return _flow_keys;
+}
+
+TunnelKeyBurst_t& dpdk_worker_context::tunnel_keys() {
+    return _tunnel_keys;
+}
+
+uint32_t* dpdk_worker_context::match_results() {
+    return _match_results;
+}
+
+const dpdk_packet_filter& dpdk_worker_context::filter() const {
+    return *_packet_filter;
+}
+
+WorkerCounters_t& dpdk_worker_context::counters() {
+    return _counters;
+}
+
+const WorkerCounters_t& dpdk_worker_context::counters() const {
+    return _counters;
+}
+
+WorkerCounters_t dpdk_worker_context::read_counters() const {
+    // Single writer (the owning lcore); aligned 64-bit loads never tear
+    WorkerCounters_t snapshot{};
+    snapshot.rx_packets = __atomic_load_n(&_counters.rx_packets, __ATOMIC_RELAXED);
+    snapshot.rx_bytes = __atomic_load_n(&_counters.rx_bytes, __ATOMIC_RELAXED);
+    snapshot.tx_packets = __atomic_load_n(&_counters.tx_packets, __ATOMIC_RELAXED);
+    snapshot.tx_bytes = __atomic_load_n(&_counters.tx_bytes, __ATOMIC_RELAXED);
+    snapshot.dropped_packets = __atomic_load_n(&_counters.dropped_packets, __ATOMIC_RELAXED);
+    snapshot.dropped_bytes = __atomic_load_n(&_counters.dropped_bytes, __ATOMIC_RELAXED);
+    snapshot.parse_failures = __atomic_load_n(&_counters.parse_failures, __ATOMIC_RELAXED);
+    snapshot.checksum_drops = __atomic_load_n(&_counters.checksum_drops, __ATOMIC_RELAXED);
+    snapshot.ptype_parsed = __atomic_load_n(&_counters.ptype_parsed, __ATOMIC_RELAXED);
+    snapshot.rate_limited = __atomic_load_n(&_counters.rate_limited, __ATOMIC_RELAXED);
+    snapshot.rate_limit_evictions = __atomic_load_n(&_counters.rate_limit_evictions, __ATOMIC_RELAXED);
+    snapshot.prefilter_skips = __atomic_load_n(&_counters.prefilter_skips, __ATOMIC_RELAXED);
+    // Mirrored from the cache's own stats, which are plain single-writer fields as well
+    const FlowCacheStats_t& cache = _flow_cache.stats();
+    snapshot.flow_cache_hits = __atomic_load_n(&cache.hits, __ATOMIC_RELAXED);
+    snapshot.flow_cache_misses = __atomic_load_n(&cache.misses, __ATOMIC_RELAXED);
+    snapshot.flow_cache_expired = __atomic_load_n(&cache.expired, __ATOMIC_RELAXED);
+    snapshot.flow_cache_closed = __atomic_load_n(&cache.closed, __ATOMIC_RELAXED);
+    const FragTableStats_t& frag = _frag_table.stats();
+    snapshot.frag_tracked = __atomic_load_n(&frag.tracked, __ATOMIC_RELAXED);
+    snapshot.frag_matched = __atomic_load_n(&frag.matched, __ATOMIC_RELAXED);
+    snapshot.frag_unmatched = __atomic_load_n(&frag.unmatched, __ATOMIC_RELAXED);
+    const LogSamplerStats_t& log = _log_sampler.stats();
+    snapshot.log_records = __atomic_load_n(&log.records, __ATOMIC_RELAXED);
+    snapshot.log_drops = __atomic_load_n(&log.suppressed, __ATOMIC_RELAXED) +
+                         __atomic_load_n(&log.ring_full, __ATOMIC_RELAXED);
+    snapshot.tx_full_drops = __atomic_load_n(&_counters.tx_full_drops, __ATOMIC_RELAXED);
+    snapshot.empty_polls = __atomic_load_n(&_counters.empty_polls, __ATOMIC_RELAXED);
+    snapshot.busy_cycles = __atomic_load_n(&_counters.busy_cycles, __ATOMIC_RELAXED);
+
+    const IdleStats_t& idle = _power_manager.stats();
+    constexpr auto spin = static_cast<size_t>(IdleState::SPIN);
+    constexpr auto pause = static_cast<size_t>(IdleState::PAUSE);
+    constexpr auto sleep = static_cast<size_t>(IdleState::SLEEP);
+    snapshot.idle_spin_cycles = __atomic_load_n(&idle.idle_cycles[spin], __ATOMIC_RELAXED);
+    snapshot.idle_pause_cycles = __atomic_load_n(&idle.idle_cycles[pause], __ATOMIC_RELAXED);
+    snapshot.idle_sleep_cycles = __atomic_load_n(&idle.idle_cycles[sleep], __ATOMIC_RELAXED);
+    snapshot.wakeups_spin = __atomic_load_n(&idle.wakeups[spin], __ATOMIC_RELAXED);
+    snapshot.wakeups_pause = __atomic_load_n(&idle.wakeups[pause], __ATOMIC_RELAXED);
+    snapshot.wakeups_sleep = __atomic_load_n(&idle.wakeups[sleep], __ATOMIC_RELAXED);
+    snapshot.wake_latency_spin_cycles = __atomic_load_n(&idle.wake_latency_cycles[spin], __ATOMIC_RELAXED);
+    snapshot.wake_latency_pause_cycles = __atomic_load_n(&idle.wake_latency_cycles[pause], __ATOMIC_RELAXED);
+    snapshot.wake_latency_sleep_cycles = __atomic_load_n(&idle.wake_latency_cycles[sleep], __ATOMIC_RELAXED);
+    return snapshot;
+}
+
+unsigned dpdk_worker_context::lcore_id() const {
+    return _lcore_id;
+}
+
+int dpdk_worker_context::socket_id() const {
+    return _socket_id;
+}
+
+uint16_t dpdk_worker_context::rx_queue_id() const {
+    return _rx_queue_id;
+}
+
+uint16_t dpdk_worker_context::tx_queue_id() const {
+    return _tx_queue_id;
+}
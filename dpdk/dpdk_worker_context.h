@@ -0,0 +1,157 @@
+#ifndef DPDK_FASTDROP_AGENT_DPDK_WORKER_CONTEXT_H
+#define DPDK_FASTDROP_AGENT_DPDK_WORKER_CONTEXT_H
+
+#pragma once
+
+#include <cstdint>
+#include <rte_atomic.h>
+#include <rte_ethdev.h>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+
+#include "dpdk_flow_cache.h"
+#include "dpdk_frag_table.h"
+#include "dpdk_log_sampler.h"
+#include "dpdk_packet_filter.h"
+#include "dpdk_packet_parser.h"
+#include "dpdk_power_manager.h"
+#include "dpdk_rate_limiter.h"
+#include "dpdk_stage_timer.h"
+
+// Counters written only by the owning lcore; the control thread reads them
+// with relaxed loads, so the datapath never issues atomics or shared writes.
+typedef struct WorkerCounters {
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t dropped_packets;   // blocked by the filter
+    uint64_t dropped_bytes;
+    uint64_t parse_failures;
+    uint64_t checksum_drops;    // flagged bad by RX checksum offload
+    uint64_t ptype_parsed;      // parsed from the PMD's packet_type instead of packet bytes
+    uint64_t rate_limited;      // dropped for exceeding a rate_limit rule
+    uint64_t rate_limit_evictions;
+    uint64_t flow_cache_hits;
+    uint64_t flow_cache_misses;
+    uint64_t flow_cache_expired;
+    uint64_t flow_cache_closed;
+    uint64_t prefilter_skips;   // lookups the pre-filter kept away from the exact tables
+    uint64_t frag_tracked;      // first fragments whose verdict was recorded
+    uint64_t frag_matched;      // later fragments given that verdict
+    uint64_t frag_unmatched;    // later fragments dropped without a first fragment
+    uint64_t log_records;       // sampled packets handed to the logging thread
+    uint64_t log_drops;         // sampled but over the rate cap or the ring was full
+    uint64_t tx_full_drops;     // freed because the TX ring was full
+    uint64_t empty_polls;
+    uint64_t idle_spin_cycles;  // idle time per power state, spin and pause keep the core busy
+    uint64_t idle_pause_cycles;
+    uint64_t idle_sleep_cycles;
+    uint64_t wakeups_spin;      // idle periods ended in each state
+    uint64_t wakeups_pause;
+    uint64_t wakeups_sleep;
+    uint64_t wake_latency_spin_cycles;
+    uint64_t wake_latency_pause_cycles;
+    uint64_t wake_latency_sleep_cycles;
+    uint64_t busy_cycles;       // TSC cycles spent on non-empty bursts
+} __rte_cache_aligned WorkerCounters_t;
+
+// Per-lcore datapath state: parser scratch, TX buffer and counters.
+// Allocated on the lcore's NUMA socket and never shared with other workers.
+// The packet filter and the running flag are shared and only ever read here.
+class alignas(RTE_CACHE_LINE_SIZE) dpdk_worker_context {
+public:
+    static constexpr uint16_t BURST_SIZE = 32;
+    static_assert(BURST_SIZE <= FLOW_KEY_BURST_MAX, "rx burst must fit in one FlowKeyBurst");
+
+    explicit dpdk_worker_context(unsigned lcore_id, uint16_t port_id, uint16_t rx_queue_id, uint16_t tx_queue_id,
+                                 const dpdk_packet_filter* packet_filter, const rte_atomic32_t* running);
+    virtual ~dpdk_worker_context();
+
+    static dpdk_worker_context* create(unsigned lcore_id, uint16_t port_id, uint16_t rx_queue_id, uint16_t tx_queue_id,
+                                       const dpdk_packet_filter* packet_filter, const rte_atomic32_t* running);
+    static void destroy(dpdk_worker_context* ctx);
+
+    inline bool is_running() const {
+        return rte_atomic32_read(_running) != 0;
+    }
+
+    inline uint16_t rx_burst(rte_mbuf** bufs, uint16_t count) {
+        const uint16_t nb_rx = likely(_rx_ring_count == 0) ? rte_eth_rx_burst(_port_id, _rx_queue_id, bufs, count)
+                                                           : ring_rx_burst(bufs, count);
+        _counters.rx_packets += nb_rx;
+        return nb_rx;
+    }
+
+    inline void tx_enqueue(rte_mbuf* pkt) {
+        _tx_bufs[_tx_count++] = pkt;
+        if (_tx_count == BURST_SIZE) {
+            tx_flush();
+        }
+    }
+
+    inline void drop(rte_mbuf* pkt) {
+        _counters.dropped_packets++;
+        _counters.dropped_bytes += rte_pktmbuf_pkt_len(pkt);
+        rte_pktmbuf_free(pkt);
+    }
+
+    void tx_flush();
+    // Pipeline mode: receive from the RX stage rings and transmit through a TX stage ring instead of the port
+    void attach_rings(rte_ring* const* rx_rings, uint16_t rx_ring_count, rte_ring* tx_ring);
+
+    dpdk_packet_parser& parser();
+    dpdk_rate_limiter& rate_limiter();
+    dpdk_flow_cache& flow_cache();
+    dpdk_frag_table& frag_table();
+    dpdk_log_sampler& log_sampler();
+    dpdk_power_manager& power();
+    dpdk_stage_timer& stage_timer();
+    const dpdk_stage_timer& stage_timer() const;
+    FlowKeyBurst_t& flow_keys();
+    TunnelKeyBurst_t& tunnel_keys();
+    uint32_t* match_results();
+    const dpdk_packet_filter& filter() const;
+    WorkerCounters_t& counters();
+    const WorkerCounters_t& counters() const;
+    WorkerCounters_t read_counters() const;
+    unsigned lcore_id() const;
+    int socket_id() const;
+    uint16_t rx_queue_id() const;
+    uint16_t tx_queue_id() const;
+
+private:
+    uint16_t ring_rx_burst(rte_mbuf** bufs, uint16_t count);
+
+    WorkerCounters_t _counters;
+
+    rte_mbuf* _tx_bufs[BURST_SIZE];
+    uint16_t _tx_count;
+
+    FlowKeyBurst_t _flow_keys;
+    TunnelKeyBurst_t _tunnel_keys;
+    uint32_t _match_results[FLOW_KEY_BURST_MAX];
+
+    dpdk_packet_parser _packet_parser;
+    dpdk_rate_limiter _rate_limiter;
+    dpdk_flow_cache _flow_cache;
+    dpdk_frag_table _frag_table;
+    dpdk_log_sampler _log_sampler;
+    dpdk_power_manager _power_manager;
+    dpdk_stage_timer _stage_timer;
+    const dpdk_packet_filter* _packet_filter;
+    const rte_atomic32_t* _running;
+
+    rte_ring* const* _rx_rings;
+    rte_ring* _tx_ring;
+    uint16_t _rx_ring_count;
+    uint16_t _rx_ring_next;
+
+    unsigned _lcore_id;
+    int _socket_id;
+    uint16_t _port_id;
+    uint16_t _rx_queue_id;
+    uint16_t _tx_queue_id;
+};
+
+#endif // DPDK_FASTDROP_AGENT_DPDK_WORKER_CONTEXT_H
@@ -9,8 +9,14 @@
 #include "dpdk/dpdk_firewall.h"
 
 std::atomic<bool> running{true};
+std::atomic<bool> reload_requested{false};
 
-void signal_handler(int) {
+void signal_handler(int sig) {
+    // SIGHUP reloads the block list, everything else stops the agent
+    if (sig == SIGHUP) {
+        reload_requested = true;
+        return;
+    }
     running = false;
 }
 
@@ -28,11 +34,23 @@ void initialize() {
 int32_t main(int32_t argc, char *argv[]) {
     initialize();
 
-    const auto firewall = std::make_shared<dpdk_firewall>();
+    const std::string config_path = argc > 1 ? argv[1] : "../config/agent.json";
+    dpdk_agent_config config;
+    if (!config.load(config_path)) {
+        return EXIT_FAILURE;
+    }
+
+    const auto firewall = std::make_shared<dpdk_firewall>(config);
     firewall->launch_workers();
 
     while (running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        firewall->publish_metrics();
+
+        // Rebuilt here, off the datapath; workers switch over without pausing
+        if (reload_requested.exchange(false) || firewall->rules_changed()) {
+            firewall->reload_rules();
+        }
     }
 
     firewall->stop_workers();
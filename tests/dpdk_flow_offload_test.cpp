@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk/dpdk_flow_offload.h"
+
+// Checks which block list entries dpdk_flow_offload::eligible() hands to the NIC. The NIC
+// drops before software runs, so a rule shadowed by an earlier allow or rate limit, or a
+// port 0 rule that would also catch non-TCP/UDP packets, must stay in software.
+// Needs no EAL: eligible() only looks at the parsed rules.
+
+namespace {
+    typedef struct OffloadCase {
+        const char* rule;
+        bool eligible;
+        const char* reason;     // expected prefix of the reason when not eligible
+    } OffloadCase_t;
+
+    // Rule ids are positions in this list, shadowing looks at the earlier entries
+    const OffloadCase_t cases[] = {
+        {R"({"ip": "10.0.0.1", "block": true})", true, ""},
+        {R"({"port": 0, "block": true})", false, "port 0"},
+        {R"({"ip": "10.0.0.2", "port": 80, "block": true})", true, ""},
+        {R"({"ip": "10.0.0.0/24", "action": "allow"})", false, "not a block rule"},
+        {R"({"ip": "10.0.0.3", "block": true})", false, "shadowed by non-block rule 3"},
+        {R"({"ip": "10.0.1.3", "block": true})", true, ""},
+        {R"({"ip": "10.0.1.0/24", "port": 443, "action": "rate_limit", "rate_limit": {"pps": 10}})", false, "not a block rule"},
+        {R"({"ip": "10.0.1.4", "port": 443, "block": true})", false, "shadowed by non-block rule 6"},
+        {R"({"ip": "10.0.1.5", "port": 8443, "block": true})", true, ""},
+        {R"({"ip": "2001:db8::1", "block": true})", true, ""},
+        {R"({"ip": "10.0.2.0/24", "block": true})", false, "prefix match"},
+        {R"({"port": "53-60", "block": true})", false, "port range"},
+        {R"({"ip": "10.0.1.6", "proto": "tcp", "block": true})", false, "multi-field match"},
+    };
+}
+
+int32_t main() {
+    const auto dir = std::filesystem::temp_directory_path() / ("fastdrop_offload_test_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    const std::string rule_path = (dir / "block_list.json").string();
+    {
+        std::ofstream f(rule_path, std::ios::trunc);
+        f << "[\n";
+        for (size_t id = 0; id < std::size(cases); id++) {
+            f << "  " << cases[id].rule << (id + 1 < std::size(cases) ? ",\n" : "\n");
+        }
+        f << "]\n";
+    }
+
+    int failures = 0;
+    dpdk_rule_set rule_set(1);
+    if (!rule_set.parse_json(rule_path) || rule_set.rules().size() != std::size(cases)) {
+        spdlog::error("FAILED: parsing the test block list");
+        failures++;
+    } else {
+        for (size_t id = 0; id < std::size(cases); id++) {
+            std::string reason;
+            const bool eligible = dpdk_flow_offload::eligible(rule_set.rules(), id, reason);
+            if (eligible != cases[id].eligible || (!eligible && reason.rfind(cases[id].reason, 0) != 0)) {
+                spdlog::error("FAILED: rule {} {}: eligible {} ({}), expected {} ({})", id, cases[id].rule,
+                              eligible, reason, cases[id].eligible, cases[id].reason);
+                failures++;
+            }
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+
+    if (failures > 0) {
+        spdlog::error("{} flow offload checks failed", failures);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("All {} flow offload checks passed", std::size(cases));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <rte_eal.h>
+#include <rte_mbuf.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk/dpdk_packet_parser.h"
+
+// Feeds hand-built frames through parse_burst. L2 stacks deeper than the parser walks, or an
+// MPLS payload that is not IP, must fail to parse: reported as OK they would reach the rules
+// as non-IP and slip past every address rule. Starts a --no-huge EAL, so it needs no root,
+// hugepages or NIC.
+
+namespace {
+    typedef struct FrameCase {
+        const char* name;
+        std::vector<uint8_t> frame;
+        ParseStatus status;
+        NetworkProtocol family;
+    } FrameCase_t;
+
+    void put16(std::vector<uint8_t>& frame, uint16_t value) {
+        frame.push_back(static_cast<uint8_t>(value >> 8));
+        frame.push_back(static_cast<uint8_t>(value));
+    }
+
+    std::vector<uint8_t> ethernet(uint16_t ether_type) {
+        std::vector<uint8_t> frame(12, 0x02);
+        put16(frame, ether_type);
+        return frame;
+    }
+
+    void push_vlan(std::vector<uint8_t>& frame, uint16_t vlan_id, uint16_t next_type) {
+        put16(frame, vlan_id);
+        put16(frame, next_type);
+    }
+
+    void push_mpls(std::vector<uint8_t>& frame, uint32_t label, bool bottom_of_stack) {
+        const uint32_t word = (label << 12) | (bottom_of_stack ? 0x100 : 0) | 64;
+        put16(frame, static_cast<uint16_t>(word >> 16));
+        put16(frame, static_cast<uint16_t>(word));
+    }
+
+    // 10.0.0.1:1000 -> 10.0.0.2:53 over UDP
+    void push_ipv4_udp(std::vector<uint8_t>& frame) {
+        const uint8_t ip[] = {0x45, 0, 0, 28, 0, 1, 0, 0, 64, 17, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2};
+        frame.insert(frame.end(), std::begin(ip), std::end(ip));
+        put16(frame, 1000);
+        put16(frame, 53);
+        put16(frame, 8);
+        put16(frame, 0);
+    }
+
+    std::vector<uint8_t> vlan_frame(unsigned tags) {
+        std::vector<uint8_t> frame = ethernet(ETHER_TYPE_VLAN);
+        for (unsigned i = 0; i < tags; i++) {
+            push_vlan(frame, static_cast<uint16_t>(100 + i), i + 1 < tags ? ETHER_TYPE_VLAN : ETHER_TYPE_IPV4);
+        }
+        push_ipv4_udp(frame);
+        return frame;
+    }
+
+    std::vector<uint8_t> mpls_frame(unsigned labels) {
+        std::vector<uint8_t> frame = ethernet(ETHER_TYPE_MPLS);
+        for (unsigned i = 0; i < labels; i++) {
+            push_mpls(frame, 16 + i, i + 1 == labels);
+        }
+        push_ipv4_udp(frame);
+        return frame;
+    }
+
+    std::vector<uint8_t> mpls_control_word_frame() {
+        std::vector<uint8_t> frame = ethernet(ETHER_TYPE_MPLS);
+        push_mpls(frame, 16, true);
+        put16(frame, 0);    // pseudowire control word, then the carried Ethernet frame
+        put16(frame, 0);
+        const std::vector<uint8_t> inner = vlan_frame(0);
+        frame.insert(frame.end(), inner.begin() + 12, inner.end());
+        return frame;
+    }
+
+    bool initialize_eal() {
+        const char* eal_args[] = {
+            "dpdk-fastdrop-packet-parser-test",
+            "-l", "0",
+            "--no-huge",
+            "--no-pci",
+            "--in-memory",
+            "--log-level=4"
+        };
+        constexpr int eal_argc = std::size(eal_args);
+        return rte_eal_init(eal_argc, const_cast<char**>(eal_args)) >= 0;
+    }
+}
+
+int32_t main() {
+    if (!initialize_eal()) {
+        spdlog::error("Failed to initialize EAL");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> untagged = ethernet(ETHER_TYPE_IPV4);
+    push_ipv4_udp(untagged);
+    const FrameCase_t cases[] = {
+        {"untagged IPv4", untagged, ParseStatus::OK, NetworkProtocol::IPv4},
+        {"QinQ IPv4", vlan_frame(2), ParseStatus::OK, NetworkProtocol::IPv4},
+        {"third VLAN tag", vlan_frame(3), ParseStatus::MALFORMED, NetworkProtocol::NONE},
+        {"4 MPLS labels", mpls_frame(4), ParseStatus::OK, NetworkProtocol::IPv4},
+        {"5 MPLS labels", mpls_frame(5), ParseStatus::MALFORMED, NetworkProtocol::NONE},
+        {"MPLS pseudowire payload", mpls_control_word_frame(), ParseStatus::MALFORMED, NetworkProtocol::NONE},
+        {"ARP", ethernet(0x0806), ParseStatus::OK, NetworkProtocol::NONE},
+    };
+    constexpr uint16_t case_count = std::size(cases);
+
+    int failures = 0;
+    rte_mempool* pool = rte_pktmbuf_pool_create("parser_test_pool", 63, 0, 0, RTE_MBUF_DEFAULT_BUF_SIZE, SOCKET_ID_ANY);
+    if (!pool) {
+        spdlog::error("Failed to create mbuf pool");
+        rte_eal_cleanup();
+        return EXIT_FAILURE;
+    }
+
+    rte_mbuf* pkts[case_count] = {};
+    for (uint16_t i = 0; i < case_count; i++) {
+        pkts[i] = rte_pktmbuf_alloc(pool);
+        auto* data = pkts[i] ? reinterpret_cast<uint8_t*>(rte_pktmbuf_append(pkts[i], cases[i].frame.size())) : nullptr;
+        if (!data) {
+            spdlog::error("FAILED: {}: no mbuf for the frame", cases[i].name);
+            failures++;
+            continue;
+        }
+        std::memcpy(data, cases[i].frame.data(), cases[i].frame.size());
+    }
+
+    if (failures == 0) {
+        dpdk_packet_parser parser;
+        FlowKeyBurst_t keys{};
+        parser.parse_burst(pkts, case_count, keys);
+        for (uint16_t i = 0; i < case_count; i++) {
+            if (keys.status[i] != cases[i].status || keys.family[i] != cases[i].family) {
+                spdlog::error("FAILED: {}: status {} family {}, expected {} and {}", cases[i].name,
+                              static_cast<int>(keys.status[i]), static_cast<int>(keys.family[i]),
+                              static_cast<int>(cases[i].status), static_cast<int>(cases[i].family));
+                failures++;
+            }
+        }
+    }
+
+    for (rte_mbuf* pkt : pkts) {
+        rte_pktmbuf_free(pkt);
+    }
+    rte_mempool_free(pool);
+    rte_eal_cleanup();
+
+    if (failures > 0) {
+        spdlog::error("{} packet parser checks failed", failures);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("All {} packet parser checks passed", case_count);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <rte_eal.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk/dpdk_packet_filter.h"
+
+// Reloads an edited block list the way SIGHUP or the file watch does: a mistyped or
+// otherwise invalid file must fail the load without throwing and leave the previous
+// generation active. Starts a --no-huge EAL, so it needs no root, hugepages or NIC.
+
+namespace {
+    const char* const valid_rules = R"([
+        {"ip": "192.168.0.10", "port": 80, "block": true, "comment": "web"},
+        {"port": "53-60", "proto": "udp", "action": "rate_limit", "rate_limit": {"pps": 100, "burst_ms": 50, "prefix_v4": 24, "prefix_v6": 64}}
+    ])";
+
+    typedef struct InvalidCase {
+        const char* name;
+        const char* rules;
+    } InvalidCase_t;
+
+    const InvalidCase_t invalid_cases[] = {
+        {"ip is a number", R"([{"ip": 1, "block": true}])"},
+        {"dst_ip is an object", R"([{"dst_ip": {"addr": "10.0.0.1"}}])"},
+        {"ip and dst_ip of different families", R"([{"ip": "10.0.0.1", "dst_ip": "2001:db8::1"}])"},
+        {"prefix_list with IPv6 entries and an IPv4 dst_ip", R"([{"prefix_list": "feed.txt", "dst_ip": "10.0.0.1"}])"},
+        {"port is an array", R"([{"port": [80]}])"},
+        {"port range with trailing text", R"([{"port": "53-60xyz"}])"},
+        {"port with trailing text", R"([{"port": "80abc"}])"},
+        {"proto is a bool", R"([{"proto": true}])"},
+        {"block is a string", R"([{"ip": "10.0.0.1", "block": "yes"}])"},
+        {"action is a number", R"([{"ip": "10.0.0.1", "action": 1}])"},
+        {"rate_limit pps is a string", R"([{"ip": "10.0.0.1", "action": "rate_limit", "rate_limit": {"pps": "many"}}])"},
+        {"rate_limit is a number", R"([{"ip": "10.0.0.1", "rate_limit": 5}])"},
+        {"rate_limit pps is negative", R"([{"ip": "10.0.0.1", "rate_limit": {"pps": -100}}])"},
+        {"rate_limit burst_ms is negative", R"([{"ip": "10.0.0.1", "rate_limit": {"pps": 100, "burst_ms": -1}}])"},
+        {"rate_limit prefix_v4 is negative", R"([{"ip": "10.0.0.1", "rate_limit": {"pps": 100, "prefix_v4": -1}}])"},
+        {"rate_limit prefix_v4 is past 32", R"([{"ip": "10.0.0.1", "rate_limit": {"pps": 100, "prefix_v4": 33}}])"},
+        {"rate_limit prefix_v6 is past 128", R"([{"ip": "10.0.0.1", "rate_limit": {"pps": 100, "prefix_v6": 129}}])"},
+        {"prefix_list is a number", R"([{"prefix_list": 3}])"},
+        {"comment is a number", R"([{"ip": "10.0.0.1", "comment": 5}])"},
+        {"rule is not an object", R"([1])"},
+        {"file is not an array", R"({"ip": "10.0.0.1"})"},
+        {"one bad rule among good ones", R"([{"ip": "10.0.0.1"}, {"ip": 2}, {"ip": "10.0.0.3"}])"},
+    };
+
+    bool initialize_eal() {
+        const char* eal_args[] = {
+            "dpdk-fastdrop-rule-reload-test",
+            "-l", "0",
+            "--no-huge",
+            "--no-pci",
+            "--in-memory",
+            "--log-level=4"
+        };
+        constexpr int eal_argc = std::size(eal_args);
+        return rte_eal_init(eal_argc, const_cast<char**>(eal_args)) >= 0;
+    }
+
+    void write_file(const std::string& path, const char* text) {
+        std::ofstream f(path, std::ios::trunc);
+        f << text;
+    }
+}
+
+int32_t main() {
+    if (!initialize_eal()) {
+        spdlog::error("Failed to initialize EAL");
+        return EXIT_FAILURE;
+    }
+
+    const auto dir = std::filesystem::temp_directory_path() / ("fastdrop_reload_test_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    const std::string rule_path = (dir / "block_list.json").string();
+    write_file((dir / "feed.txt").string(), "192.0.2.0/24\n2001:db8::/32\n");
+
+    int failures = 0;
+    {
+        dpdk_packet_filter packet_filter;
+        write_file(rule_path, valid_rules);
+        if (!packet_filter.load_rules(rule_path) || packet_filter.generation() != 1) {
+            spdlog::error("FAILED: initial load of a valid rule file");
+            failures++;
+        }
+
+        for (const auto& test : invalid_cases) {
+            write_file(rule_path, test.rules);
+            bool loaded = true;
+            try {
+                loaded = packet_filter.load_rules(rule_path);
+            } catch (const std::exception& e) {
+                spdlog::error("FAILED: {}: reload threw {}", test.name, e.what());
+                failures++;
+                continue;
+            }
+            if (loaded || packet_filter.generation() != 1 || !packet_filter.active_rule_set()) {
+                spdlog::error("FAILED: {}: reload was accepted or dropped generation 1", test.name);
+                failures++;
+            }
+        }
+
+        write_file(rule_path, valid_rules);
+        if (!packet_filter.load_rules(rule_path) || packet_filter.generation() != 2) {
+            spdlog::error("FAILED: reload of a fixed rule file");
+            failures++;
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+    rte_eal_cleanup();
+
+    if (failures > 0) {
+        spdlog::error("{} rule reload checks failed", failures);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("All {} rule reload checks passed", std::size(invalid_cases) + 2);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <rte_eal.h>
+#include <spdlog/spdlog.h>
+
+#include "dpdk/dpdk_rule_set.h"
+#include "dpdk/dpdk_rule_snapshot.h"
+
+// Offline rule compiler: parses block lists once and writes the classifier's lookup
+// tables as a binary snapshot, which the agent maps (or copies into a hugepage memzone)
+// instead of parsing JSON at startup and on every reload.
+//
+//   dpdk-fastdrop-compile <output.snap> <input>...
+//
+// "*.json" inputs use the block_list.json schema, anything else is a CIDR list with one
+// address or prefix per line and "#" comments, aggregated into a single source block rule.
+// Rule ids follow the input order, so earlier files win like earlier rules do.
+// Point rules.path at the output; a rename replaces it atomically, so the watcher
+// picks up a recompiled snapshot like an edited JSON file.
+
+namespace {
+    bool initialize_eal() {
+        // rte_acl builds its tries from the DPDK heap
+        const char* eal_args[] = {
+            "dpdk-fastdrop-compile",
+            "-l", "0",
+            "--no-huge",
+            "--no-pci",
+            "--in-memory",
+            "--log-level=4"
+        };
+        constexpr int eal_argc = std::size(eal_args);
+        return rte_eal_init(eal_argc, const_cast<char**>(eal_args)) >= 0;
+    }
+
+    bool ends_with(const std::string& text, const std::string& suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    int compile(const std::string& output, char** inputs, int input_count) {
+        dpdk_rule_set rule_set(0);
+        for (int i = 0; i < input_count; i++) {
+            const std::string input = inputs[i];
+            const bool parsed = ends_with(input, ".json") ? rule_set.parse_json(input) : rule_set.parse_prefix_list(input);
+            if (!parsed) {
+                return EXIT_FAILURE;
+            }
+            spdlog::info("Parsed {} ({} rules so far)", input, rule_set.rules().size());
+        }
+
+        if (!rule_set.compile() || !rule_set.save_snapshot(output)) {
+            return EXIT_FAILURE;
+        }
+
+        // Read the image back the way the agent will, so a bad snapshot fails here and not on reload
+        dpdk_rule_snapshot check;
+        if (!check.open(output, SnapshotMemory::MMAP)) {
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+    if (argc < 3) {
+        spdlog::error("Usage: {} <output.snap> <block_list.json | cidr_list.txt>...", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!initialize_eal()) {
+        spdlog::error("Failed to initialize EAL");
+        return EXIT_FAILURE;
+    }
+
+    const int status = compile(argv[1], &argv[2], argc - 2);
+    rte_eal_cleanup();
+    return status;
+}